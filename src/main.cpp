@@ -30,7 +30,10 @@
 #include "types/files.h"
 #include "tools/text.h"
 #include "tools/record.h"
+#include "tools/replay.h"
 #include "tools/console.h"
+#include "tools/imageWriter.h"
+#include "tools/benchmark.h"
 
 #if defined(SUPPORT_NCURSES)
 #include <ncurses.h>
@@ -66,11 +69,23 @@ std::atomic<bool>           keepRunnig(true);
 bool                        screensaver = false;
 bool                        bTerminate = false;
 bool                        fullFps = false;
+std::atomic<bool>           offline(false);     // no vsync nor rest, time only moves with the recording
+bool                        replayOffline = false;  // offline state to go back to once a replay ends
+BenchmarkRun                benchmark;
+
+#if defined(SUPPORT_RECORDING_PIPE)
+int                         recordYUV = 0;          // 0 (RGB), 601 or 709
+bool                        recordYUVFull = false;
+#endif
 
 void                        commandsRun(const std::string &_cmd);
 void                        commandsRun(const std::string &_cmd, std::mutex &_mutex);
 void                        commandsInit();
 
+// How often the commands thread checks on a recording. Offline the render loop never rests,
+// so polling at its rest rate would just fight it for the commands mutex
+int                         progressRestMs() { return offline.load() ? 100 : ada::getRestMs(); }
+
 #if !defined(__EMSCRIPTEN__)
 void                        printUsage(char * executableName);
 void                        fileWatcherThread();
@@ -125,7 +140,14 @@ void loop() {
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
     #ifndef __EMSCRIPTEN__
-    if (!bTerminate && !fullFps && !sandbox.haveChange()) {
+    // offline can be switched from the commands thread, but the swap interval belongs to this one
+    static bool vsync = true;
+    if (vsync == offline.load()) {
+        vsync = !offline.load();
+        ada::setWindowVSync(vsync);
+    }
+
+    if (!bTerminate && !fullFps && !offline.load() && !sandbox.haveChange()) {
     // If nothing in the scene change skip the frame and try to keep it at 60fps
         std::this_thread::sleep_for(std::chrono::milliseconds( ada::getRestMs() ));
         return;
@@ -141,6 +163,9 @@ void loop() {
 
     #endif
 
+    if (isReplayRecording())
+        replayRecordFrame(sandbox.getFrame(), sandbox.getTime(), ada::getDelta(), ada::getMouseX(), ada::getMouseY());
+
     // Draw Scene
     sandbox.render();
 
@@ -168,6 +193,7 @@ void loop() {
 // Main program
 //============================================================================
 int main(int argc, char **argv) {
+    benchmark.start = std::chrono::high_resolution_clock::now();
 
     ada::WindowProperties window_properties;
 
@@ -310,6 +336,22 @@ int main(int argc, char **argv) {
                     argument.rfind("rtmp://", 0) == 0 ) {
             willLoadTextures = true;
         }
+        else if (   argument == "--benchmark" ) {
+            // Each entry runs on its own process, this one never opens a window
+            if (++i < argc)
+                return benchmarkSuite(std::string(argv[i]), std::string(argv[0]));
+            else
+                std::cout << "Argument '" << argument << "' should be followed by a <manifest.json>. Skipping argument." << std::endl;
+        }
+        else if (   argument == "--benchmark-run" ) {
+            if (++i < argc && benchmarkRunParse(std::string(argv[i]), benchmark)) {
+                fullFps = true;
+                offline = true;
+                ada::setFps(0);
+            }
+            else
+                std::cout << "Argument '" << argument << "' should be followed by <warmup>,<frames>,<file.json>. Skipping argument." << std::endl;
+        }
         else if ( argument == "-p" || argument == "--port" ) {
             if(++i < argc)
                 oscPort = ada::toInt(std::string(argv[i]));
@@ -353,7 +395,8 @@ int main(int argc, char **argv) {
                 argument == "-d" || argument == "--display" ||
                 argument == "--major" || argument == "--minor" ||
                 argument == "--mouse" || argument == "--fps" ||
-                argument == "-p" || argument == "--port" ) {
+                argument == "-p" || argument == "--port" ||
+                argument == "--benchmark-run" ) {
             i++;
         }
         else if (   argument == "-l" || argument == "--headless" ||
@@ -394,6 +437,22 @@ int main(int argc, char **argv) {
             fullFps = true;
             ada::setFps(0);
         }
+        else if (argument == "--offline" ) {
+            offline = true;
+            ada::setFps(0);
+        }
+        else if (argument == "--shard" ) {
+            if (++i < argc)
+                commandsArgs.insert(commandsArgs.begin(), "shard," + std::string(argv[i]));
+            else
+                std::cout << "Argument '" << argument << "' should be followed by <index>/<total>. Skipping argument." << std::endl;
+        }
+        else if (argument == "--shader-cache" ) {
+            if (++i < argc)
+                sandbox.uniforms.programCache.setFolder(std::string(argv[i]));
+            else
+                std::cout << "Argument '" << argument << "' should be followed by a <folder>. Skipping argument." << std::endl;
+        }
         else if ( sandbox.frag_index == -1 && (ada::haveExt(argument,"frag") || ada::haveExt(argument,"fs") ) ) {
             if ( stat(argument.c_str(), &st) != 0 ) {
                 std::cout << "File " << argv[i] << " not founded. Creating a default fragment shader with that name"<< std::endl;
@@ -608,7 +667,12 @@ int main(int argc, char **argv) {
     }
     #endif
 
+    benchmark.setupStart = std::chrono::high_resolution_clock::now();
     sandbox.setup(files, commands);
+    benchmark.setupEnd = std::chrono::high_resolution_clock::now();
+    benchmark.programCache = sandbox.uniforms.programCache.isEnabled();
+    benchmark.programCacheHits = sandbox.uniforms.programCache.getHits();
+    benchmark.programCacheMisses = sandbox.uniforms.programCache.getMisses();
 
 #if defined(__EMSCRIPTEN__)
     emscripten_request_animation_frame_loop(loop, 0);
@@ -676,6 +740,26 @@ int main(int argc, char **argv) {
     
     // Render Loop
     while ( ada::isGL() && keepRunnig.load() ){
+        // Replaying a session, apply what happened before this frame
+        if ( isReplaying() ) {
+            std::vector<ReplayEvent> events;
+            if ( replayPlayFrame(events) ) {
+                for (size_t i = 0; i < events.size(); i++) {
+                    const ReplayEvent& event = events[i];
+                    if (event.type == REPLAY_COMMAND)
+                        commandsRun(event.command);
+                    else if (event.type == REPLAY_MOUSE_DRAG)
+                        sandbox.onMouseDrag(event.values[0], event.values[1], event.values[2], event.values[3], event.ints[0]);
+                    else if (event.type == REPLAY_SCROLL)
+                        sandbox.onScroll(event.values[0]);
+                    else if (event.type == REPLAY_RESIZE)
+                        ada::setWindowSize(event.ints[0], event.ints[1]);
+                }
+            }
+            else
+                replayPlayStop();
+        }
+
         // Something change??
         if ( fileChanged != -1 ) {
             filesMutex.lock();
@@ -684,7 +768,17 @@ int main(int argc, char **argv) {
             filesMutex.unlock();
         }
 
+        // Programs compiled in the background are swapped in before this frame once all are ready
+        if ( sandbox.isCompiling() ) {
+            filesMutex.lock();
+            sandbox.updateCompile( files );
+            filesMutex.unlock();
+        }
+
         loop();
+
+        if (benchmark.isActive() && benchmarkRunFrame(benchmark, sandbox.uniforms.tracker, ada::getWindowWidth(), ada::getWindowHeight()))
+            keepRunnig.store(false);
     }
 
     
@@ -738,15 +832,49 @@ void ada::onMouseMove(float _x, float _y) {
 }
 void ada::onMousePress(float _x, float _y, int _button) { }
 void ada::onMouseRelease(float _x, float _y, int _button) { }
-void ada::onMouseDrag(float _x, float _y, int _button) { sandbox.onMouseDrag(_x, _y, _button); }
+void ada::onMouseDrag(float _x, float _y, int _button) { 
+    // while replaying the drags come from the log
+    if (isReplaying())
+        return;
+
+    if (isReplayRecording())
+        replayRecordMouseDrag(_x, _y, ada::getMouseVelX(), ada::getMouseVelY(), _button);
+    sandbox.onMouseDrag(_x, _y, _button); 
+}
 
-void ada::onScroll(float _yoffset) { sandbox.onScroll(_yoffset); }
-void ada::onViewportResize(int _newWidth, int _newHeight) { sandbox.onViewportResize(_newWidth, _newHeight); }
+void ada::onScroll(float _yoffset) { 
+    if (isReplaying())
+        return;
+
+    if (isReplayRecording())
+        replayRecordScroll(_yoffset);
+    sandbox.onScroll(_yoffset); 
+}
+
+void ada::onViewportResize(int _newWidth, int _newHeight) { 
+    if (isReplayRecording())
+        replayRecordResize(_newWidth, _newHeight);
+    sandbox.onViewportResize(_newWidth, _newHeight); 
+}
+
+// Commands that pace the session or wait for frames to be rendered are left out of replays,
+// frames are already paced by the log and the render loop can't wait on itself
+bool replayCommand(const std::string &_cmd) {
+    static const char* skip[] = { "replay", "wait", "sequence", "secs", "frames", "stream", "record", "track", "offline", "fullFps", "q", "quit", "exit" };
+    std::string trigger = _cmd.substr(0, _cmd.find(','));
+    for (size_t i = 0; i < sizeof(skip) / sizeof(skip[0]); i++)
+        if (trigger == skip[i])
+            return false;
+    return true;
+}
 
 void commandsRun(const std::string &_cmd) { commandsRun(_cmd, commandsMutex); }
 void commandsRun(const std::string &_cmd, std::mutex &_mutex) {
     bool resolve = false;
 
+    if (isReplayRecording() && replayCommand(_cmd))
+        replayRecordCommand(_cmd);
+
     // Check if _cmd is present in the list of commands
     for (size_t i = 0; i < commands.size(); i++) {
         if (ada::beginsWith(_cmd, commands[i].trigger)) {
@@ -1104,9 +1232,13 @@ void commandsInit() {
             sandbox.printDependencies(VERTEX);
             return true;
         }
+        else if (_line == "dependencies,stats") {
+            std::cout << sandbox.includes.logStats();
+            return true;
+        }
         return false;
     },
-    "dependencies[,<vert|frag>]", "returns all the dependencies of the vertex o fragment shader or both", false));
+    "dependencies[,<vert|frag|stats>]", "returns all the dependencies of the vertex o fragment shader or both, or include cache stats", false));
 
     commands.push_back(Command("update", [&](const std::string& _line){ 
         if (_line == "update") {
@@ -1152,6 +1284,27 @@ void commandsInit() {
     },
     "fullFps[,on|off]", "go to full FPS or not", false));
 
+    commands.push_back(Command("offline", [&](const std::string& _line){
+        if (_line == "offline") {
+            std::string rta = offline.load() ? "on" : "off";
+            std::cout <<  rta << std::endl; 
+            return true;
+        }
+        else {
+            std::vector<std::string> values = ada::split(_line,',');
+            if (values.size() == 2) {
+                commandsMutex.lock();
+                offline = (values[1] == "on");
+                if (offline.load())
+                    ada::setFps(0);
+                commandsMutex.unlock();
+                return true;
+            }
+        }
+        return false;
+    },
+    "offline[,on|off]", "render recordings as fast as possible, without vsync and with time moving only by the recording fps", false));
+
     commands.push_back(Command("cursor", [&](const std::string& _line){
         if (_line == "cursor") {
             std::string rta = sandbox.cursor ? "on" : "off";
@@ -1178,9 +1331,28 @@ void commandsInit() {
             commandsMutex.unlock();
             return true;
         }
+        else if (values.size() == 4) {
+            int width = ada::toInt(values[2]);
+            int height = ada::toInt(values[3]);
+            if (width <= 0 || height <= 0)
+                return false;
+
+            // Images bigger than the window are rendered in tiles and streamed to disk
+            if ((width != ada::getWindowWidth() || height != ada::getWindowHeight()) && !ImageWriter::isSupported(values[1])) {
+                std::cout << "Screenshots of a different size than the window can be saved as .png, .tif or .ppm" << std::endl;
+                return true;
+            }
+
+            commandsMutex.lock();
+            sandbox.screenshotWidth = width;
+            sandbox.screenshotHeight = height;
+            sandbox.screenshotFile = values[1];
+            commandsMutex.unlock();
+            return true;
+        }
         return false;
     },
-    "screenshot[,<filename>]", "saves a screenshot to a filename", false));
+    "screenshot[,<filename>[,<width>,<height>]]", "saves a screenshot to a filename, rendered in tiles when given a size other than the window", false));
 
     commands.push_back(Command("sequence", [&](const std::string& _line){ 
         std::vector<std::string> values = ada::split(_line,',');
@@ -1209,13 +1381,13 @@ void commandsInit() {
 
                 console_draw_pct(pct);
 
-                std::this_thread::sleep_for(std::chrono::milliseconds( ada::getRestMs() ));
+                std::this_thread::sleep_for(std::chrono::milliseconds( progressRestMs() ));
             }
             return true;
         }
         return false;
     },
-    "sequence,<from_sec>,<to_sec>[,<fps>]","save a PNG sequence <from_sec> <to_sec> at <fps> (default: 24)",false));
+    "sequence,<from_sec>,<to_sec>[,<fps>]","save a PNG (see sequence_format) sequence <from_sec> <to_sec> at <fps> (default: 24)",false));
 
     commands.push_back(Command("secs", [&](const std::string& _line){ 
         std::vector<std::string> values = ada::split(_line,',');
@@ -1244,7 +1416,7 @@ void commandsInit() {
 
                 console_draw_pct(pct);
 
-                std::this_thread::sleep_for(std::chrono::milliseconds( ada::getRestMs() ));
+                std::this_thread::sleep_for(std::chrono::milliseconds( progressRestMs() ));
             }
             return true;
         }
@@ -1279,7 +1451,7 @@ void commandsInit() {
                 
                 console_draw_pct(pct);
 
-                std::this_thread::sleep_for(std::chrono::milliseconds( ada::getRestMs() ));
+                std::this_thread::sleep_for(std::chrono::milliseconds( progressRestMs() ));
             }
             return true;
         }
@@ -1287,6 +1459,157 @@ void commandsInit() {
     },
     "frames,<A>,<B>[,<fps>]","saves a sequence of images from frame <A> to <B> at <fps> (default: 24)", false));
 
+    commands.push_back(Command("shard", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values.size() == 2) {
+            std::vector<std::string> shard = ada::split(values[1],'/');
+            if (shard.size() != 2 || ada::toInt(shard[1]) < 1)
+                return false;
+
+            commandsMutex.lock();
+            recordingSetShard( std::max(0, ada::toInt(shard[0])), ada::toInt(shard[1]) );
+            commandsMutex.unlock();
+            return true;
+        }
+        else {
+            std::cout << getRecordingShardIndex() << "/" << getRecordingShardTotal() << std::endl;
+            return true;
+        }
+        return false;
+    },
+    "shard[,<index>/<total>]","sequence, secs and frames only render every <total>th frame starting from <index>, so several processes can split them (default: 0/1)", false));
+
+    commands.push_back(Command("sequence_format", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values.size() == 2) {
+            std::string format = ada::toLower(values[1]);
+            if (format != "png" && format != "hdr" && format != "exr")
+                return false;
+
+            commandsMutex.lock();
+            recordingSetFrameFormat(format);
+            commandsMutex.unlock();
+            return true;
+        }
+        else {
+            std::cout << getRecordingFrameFormat() << std::endl;
+            return true;
+        }
+        return false;
+    },
+    "sequence_format[,png|hdr|exr]","image format of sequence, secs and frames. hdr and exr are read back as half floats (default: png)", false));
+
+    commands.push_back(Command("verify", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values.size() >= 4) {
+            size_t total = 0;
+            if (values[1] == "frames")
+                total = recordingCountFrames(ada::toInt(values[2]), ada::toInt(values[3]));
+            else if (values[1] == "sequence" || values[1] == "secs")
+                total = recordingCountSecs(ada::toFloat(values[2]), ada::toFloat(values[3]), (values.size() == 5) ? ada::toFloat(values[4]) : 24.0f);
+            else
+                return false;
+
+            size_t missing = 0;
+            for (size_t i = 0; i < total; i++) {
+                std::string file = recordingFrameFile(i);
+                if (!ada::urlExists(file)) {
+                    std::cout << "missing," << file << std::endl;
+                    missing++;
+                }
+            }
+            std::cout << (total - missing) << "/" << total << " frames" << std::endl;
+            return true;
+        }
+        return false;
+    },
+    "verify,<sequence|secs|frames>,<A>,<B>[,<fps>]","checks that every image of a sequence (rendered by one or many shards) is on the current folder", false));
+
+    #if defined(SUPPORT_RECORDING_PIPE)
+    commands.push_back(Command("record_yuv", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values.size() >= 2) {
+            if (values[1] == "601" || values[1] == "709")
+                recordYUV = ada::toInt(values[1]);
+            else 
+                recordYUV = 0;
+
+            if (values.size() > 2)
+                recordYUVFull = values[2] == "full";
+            return true;
+        }
+        else {
+            if (recordYUV)
+                std::cout << recordYUV << "," << (recordYUVFull ? "full" : "limited") << std::endl;
+            else
+                std::cout << "off" << std::endl;
+            return true;
+        }
+        return false;
+    },
+    "record_yuv[,off|601|709[,limited|full]]","converts recorded frames to YUV420 on the GPU with the BT.601 or BT.709 matrix before reading them back (default: off)", false));
+
+    commands.push_back(Command("stream", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values.size() >= 4) {
+            // ncurses draws on stdout, it would end up mixed with the frames
+            bool toStdout = values[1] == "-" || values[1] == "stdout";
+            if (toStdout && commands_ncurses) {
+                std::cerr << "Can't stream to stdout while the console uses it, start glslViewer with --noncurses" << std::endl;
+                return true;
+            }
+
+            RecordingSettings settings;
+            settings.trg_path = values[1];
+            settings.src_width = ada::getWindowWidth();
+            settings.src_height = ada::getWindowHeight();
+
+            float from = ada::toFloat(values[2]);
+            float to = ada::toFloat(values[3]);
+            if (from >= to)
+                from = 0.0;
+
+            if (from == 0.0)
+                sandbox.uniforms.setStreamsRestart();
+
+            settings.src_fps = 24.0f;
+            if (values.size() > 4)
+                settings.src_fps = ada::toFloat(values[4]);
+
+            // YUV4MPEG2 is always YUV, so convert it on the GPU when the size allows it. Raw frames are RGBA unless asked otherwise
+            bool y4m = ada::haveExt(values[1], "y4m");
+            int yuv = recordYUV ? recordYUV : (y4m ? 601 : 0);
+            if (yuv && settings.src_width % 8 == 0 && settings.src_height % 2 == 0) {
+                settings.src_yuv = yuv;
+                settings.src_yuv_full = recordYUVFull;
+            }
+            settings.src_channels = y4m ? 3 : 4;
+
+            commandsMutex.lock();
+            bool valid = recordingStreamOpen(settings, from, to);
+            commandsMutex.unlock();
+
+            float pct = 0.0f;
+            while (valid && pct < 1.0f) {
+                commandsMutex.lock();
+                pct = getRecordingPercentage();
+                commandsMutex.unlock();
+
+                console_draw_pct(pct);
+
+                std::this_thread::sleep_for(std::chrono::milliseconds( progressRestMs() ));
+            }
+
+            // std::cout was taken on this thread, it's given back here too
+            if (valid)
+                recordingStreamClose();
+            return true;
+        }
+        return false;
+    },
+    "stream,<file|->,<A>,<B>[,<fps>]","stream uncompressed frames from second <A> to <B> at <fps> (default: 24) to stdout (-), a named pipe or a file, as YUV4MPEG2 (.y4m) or raw rgba/yuv420p", false));
+    #endif
+
     #if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
     commands.push_back(Command("record", [&](const std::string& _line){ 
         std::vector<std::string> values = ada::split(_line,',');
@@ -1339,6 +1662,21 @@ void commandsInit() {
                 settings.trg_args += " -pix_fmt yuv420p";
                 settings.trg_args += " -vsync 1";
                 settings.trg_args += " -g 1";
+
+                settings.trg_codec = "libx264";
+                settings.trg_bitrate = 20000;
+                settings.trg_crf = 18;
+                settings.trg_gop = 1;
+            }
+            else if (ada::haveExt(values[1], "mkv") || ada::haveExt(values[1], "MKV") ) {
+                valid = true;
+                settings.trg_args = "-r " + ada::toString( settings.trg_fps );
+                settings.trg_args += " -c:v ffv1";
+                settings.trg_args += " -vf \"vflip,fps=" + ada::toString(settings.trg_fps) + "\"";
+                settings.trg_args += " -pix_fmt yuv444p";
+
+                settings.trg_codec = "ffv1";
+                settings.trg_pix_fmt = "yuv444p";
             }
             else if (ada::haveExt(values[1], "gif") || ada::haveExt(values[1], "GIF") ) {;
                 settings.trg_width = ada::roundTo( (int)((settings.trg_width/pd)/2), 2);
@@ -1352,6 +1690,16 @@ void commandsInit() {
                 settings.trg_args += " -loop 0";
             }
 
+            // the packed YUV420 readback needs 4 luma pixels per texel and a whole chroma pixel per 2x2 block
+            if (recordYUV) {
+                if (settings.src_width % 8 == 0 && settings.src_height % 2 == 0) {
+                    settings.src_yuv = recordYUV;
+                    settings.src_yuv_full = recordYUVFull;
+                }
+                else
+                    std::cout << "Window size is not a multiple of 8x2, frames will be converted to YUV on the CPU" << std::endl;
+            }
+
             if (valid) {
                 commandsMutex.lock();
                 recordingPipeOpen(settings, from, to);
@@ -1365,7 +1713,7 @@ void commandsInit() {
 
                     console_draw_pct(pct);
 
-                    std::this_thread::sleep_for(std::chrono::milliseconds( ada::getRestMs() ));
+                    std::this_thread::sleep_for(std::chrono::milliseconds( progressRestMs() ));
                 }
             }
 
@@ -1373,9 +1721,62 @@ void commandsInit() {
         }
         return false;
     },
-    "record,<file>,<A>,<B>[,<fps>]","record a video from second <A> to second <B> at <fps> (default: 24.0f)", false));
+    "record,<file>,<A>,<B>[,<fps>]","record a .mp4 (h264), .mkv (lossless ffv1) or .gif video from second <A> to second <B> at <fps> (default: 24.0f)", false));
     #endif
 
+    commands.push_back(Command("replay", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (_line == "replay") {
+            std::cout << "replay," << (isReplayRecording() ? "record" : isReplaying() ? "play" : "off") << std::endl;
+            return true;
+        }
+        else if (values.size() == 2 && values[1] == "stop") {
+            if (isReplayRecording())
+                std::cout << "// " << replayRecordStop() << " frames recorded" << std::endl;
+            else if (isReplaying())
+                replayPlayStop();
+            return true;
+        }
+        else if (values.size() == 3 && values[1] == "record") {
+            if (isReplayRecording() || isReplaying())
+                std::cout << "// Stop the current replay first" << std::endl;
+            else if (!replayRecordStart(values[2], sandbox.getFrame()))
+                std::cout << "// Can't write " << values[2] << std::endl;
+            return true;
+        }
+        else if (values.size() == 3 && values[1] == "play") {
+            if (isReplayRecording() || isReplaying()) {
+                std::cout << "// Stop the current replay first" << std::endl;
+                return true;
+            }
+
+            commandsMutex.lock();
+            replayOffline = offline.load();
+            bool valid = replayPlayStart(values[2]);
+            if (valid) {
+                // every frame of the log gets rendered, no matter how long it takes
+                offline = true;
+                ada::setFps(0);
+            }
+            commandsMutex.unlock();
+
+            if (!valid) {
+                std::cout << "// Can't play " << values[2] << std::endl;
+                return true;
+            }
+
+            while (isReplaying()) {
+                console_draw_pct( getReplayPercentage() );
+                std::this_thread::sleep_for(std::chrono::milliseconds( progressRestMs() ));
+            }
+
+            offline = replayOffline;
+            return true;
+        }
+        return false;
+    },
+    "replay[,record,<file>|play,<file>|stop]", "record the input and timing of a session to <file>, or play it back frame by frame", false));
+
     commands.push_back(Command("q", [&](const std::string& _line){ 
         if (_line == "q") {
             keepRunnig.store(false);
@@ -1437,6 +1838,11 @@ void printUsage(char * executableName) {
     std::cerr << "      --nocursor                  # hide cursor" << std::endl;
     std::cerr << "      --noncurses                 # disable ncurses command interface" << std::endl;
     std::cerr << "      --fps <fps>                 # fix the max FPS" << std::endl;
+    std::cerr << "      --offline                   # render recordings as fast as possible, without vsync" << std::endl;
+    std::cerr << "      --shard <i>/<N>             # render only every N frame of a sequence starting at i" << std::endl;
+    std::cerr << "      --shader-cache <folder>     # keep the linked programs on <folder> and load them from there next time" << std::endl;
+    std::cerr << "      --benchmark <manifest.json> # run the shaders/scenes of the manifest headless, save their timings as JSON and compare them with a baseline" << std::endl;
+    std::cerr << "      --benchmark-run <warmup>,<frames>,<file.json>  # render <warmup> frames, then time <frames> more and save their stats" << std::endl;
     std::cerr << "      --fxaa                      # set FXAA as postprocess filter" << std::endl;
     std::cerr << "      --quilt <0-7>               # quilt render (HoloPlay)" << std::endl;
     std::cerr << "      --lenticular [visual.json]  # lenticular calubration file, Looking Glass Model (HoloPlay)" << std::endl;
@@ -1451,16 +1857,18 @@ void printUsage(char * executableName) {
 
 void onExit() {
 
-    #if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
-    recordingPipeClose();
-    #endif
-
     // clear screen
     glClear( GL_COLOR_BUFFER_BIT );
 
-    // Delete the resources of Sandbox
+    replayRecordStop();
+
+    // Delete the resources of Sandbox (this also flush the frames pending on the readback ring)
     sandbox.clear();
 
+    #if defined(SUPPORT_RECORDING_PIPE)
+    recordingPipeClose();
+    #endif
+
     // close openGL instance
     ada::closeGL();
 }
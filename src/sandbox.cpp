@@ -4,12 +4,17 @@
 #include <algorithm>    // std::find
 #include <fstream>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <memory>
+#include <chrono>
 
 #include "tools/job.h"
 #include "tools/text.h"
 #include "tools/record.h"
+#include "tools/replay.h"
 #include "tools/console.h"
+#include "tools/imageWriter.h"
 
 #include "ada/window.h"
 #include "ada/draw.h"
@@ -23,16 +28,49 @@
 #include "glm/gtx/matrix_transform_2d.hpp"
 #include "glm/gtx/rotate_vector.hpp"
 
-#define TRACK_BEGIN(A) if (uniforms.tracker.isRunning()) uniforms.tracker.begin(A); 
-#define TRACK_END(A) if (uniforms.tracker.isRunning()) uniforms.tracker.end(A); 
+// Constant track names are only interned the first time, TRACK_*_ID take an id looked up beforehand
+#define TRACK_BEGIN(A) if (uniforms.tracker.isRunning()) { static const size_t track_id = uniforms.tracker.getId(A); uniforms.tracker.begin(track_id); }
+#define TRACK_END(A) if (uniforms.tracker.isRunning()) { static const size_t track_id = uniforms.tracker.getId(A); uniforms.tracker.end(track_id); }
+#define TRACK_BEGIN_ID(A) if (uniforms.tracker.isRunning()) uniforms.tracker.begin(A);
+#define TRACK_END_ID(A) if (uniforms.tracker.isRunning()) uniforms.tracker.end(A);
+
+// Colors each tile of the screen by its cost, from blue (cheapest) through green and yellow to red
+const std::string tiles_heatmap_frag = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+
+uniform sampler2D   u_tex0;
+uniform vec2        u_resolution;
+uniform vec2        u_tiles;
+
+vec3 heatmap(float v) {
+    return clamp(vec3(1.5 - abs(4.0 * v - vec3(3.0, 2.0, 1.0))), 0.0, 1.0);
+}
+
+void main() {
+    vec2 st = gl_FragCoord.xy / u_resolution;
+    vec2 tile = floor(st * u_tiles);
+    float cost = texture2D(u_tex0, (tile + 0.5) / u_tiles).r;
+
+    vec2 edge = fract(st * u_tiles);
+    float grid = step(edge.x, 0.5 * u_tiles.x / u_resolution.x) + step(edge.y, 0.5 * u_tiles.y / u_resolution.y);
+
+    gl_FragColor = vec4(mix(heatmap(cost), vec3(1.0), min(grid, 1.0) * 0.5), 0.5);
+}
+)";
+
+// The 2D canvas is the only one to have them, they are part of what identifies its program
+const std::string canvas_defines = "MODEL_VERTEX_TEXCOORD=v_texcoord";
 
 // ------------------------------------------------------------------------- CONTRUCTOR
 Sandbox::Sandbox(): 
+    screenshotWidth(0), screenshotHeight(0),
     frag_index(-1), vert_index(-1), geom_index(-1), 
     lenticular(""), quilt(-1), 
     verbose(false), cursor(true), fxaa(false),
     // Main Vert/Frag/Geom
-    m_frag_source(""), m_vert_source(""),
+    m_frag_source(""), m_vert_source(""), m_compile_background(true),
     // Buffers
     m_buffers_total(0),
     // Poisson Fill
@@ -43,14 +81,18 @@ Sandbox::Sandbox():
     m_billboard_vbo(nullptr), m_cross_vbo(nullptr),
     // Plot helpers
     m_plot_texture(nullptr), m_plot(PLOT_OFF),
+    m_tiles_texture(nullptr),
 
     // Record
+    m_record_depth(0),
+    m_record_readback_depth(3),
+    /** 0 means enough slabs for the readback ring plus two frames per saving thread **/
+    m_record_pool_slabs(0),
     #if defined(SUPPORT_MULTITHREAD_RECORDING)
     m_task_count(0),
-    /** allow 500 MB to be used for the image save queue **/
-    m_max_mem_in_queue(500 * 1024 * 1024),
     m_save_threads(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1)),
     #endif
+    m_tile_resolution(0.0f),
 
     // Scene
     m_view2d(1.0), m_time_offset(0.0), m_camera_elevation(1.0), m_camera_azimuth(180.0), m_frame(0), m_change(true), m_initialized(false), m_error_screen(true),
@@ -64,28 +106,30 @@ Sandbox::Sandbox():
     //
     uniforms.functions["u_frame"] = UniformFunction( "int", [&](ada::Shader& _shader) {
         if (isRecording()) _shader.setUniform("u_frame", getRecordingFrame());
-        _shader.setUniform("u_frame", (int)m_frame);
+        else if (isReplaying()) _shader.setUniform("u_frame", getReplayFrame());
+        else _shader.setUniform("u_frame", (int)m_frame);
     }, 
     [&]() { 
         if (isRecording()) return ada::toString( getRecordingFrame() );
+        else if (isReplaying()) return ada::toString( getReplayFrame() );
         else return ada::toString(m_frame, 1); 
     } );
 
     uniforms.functions["u_time"] = UniformFunction( "float", [&](ada::Shader& _shader) {
-        if (isRecording()) _shader.setUniform("u_time", getRecordingTime());
-        else _shader.setUniform("u_time", float(ada::getTime()) - m_time_offset);
+        _shader.setUniform("u_time", getTime());
     }, 
     [&]() {  
-        if (isRecording()) return ada::toString( getRecordingTime() );
-        else return ada::toString(ada::getTime() - m_time_offset); 
+        return ada::toString( getTime() );
     } );
 
     uniforms.functions["u_delta"] = UniformFunction("float", [&](ada::Shader& _shader) {
         if (isRecording()) _shader.setUniform("u_delta", getRecordingDelta());
+        else if (isReplaying()) _shader.setUniform("u_delta", getReplayDelta());
         else _shader.setUniform("u_delta", float(ada::getDelta()));
     }, 
     [&]() { 
         if (isRecording()) return ada::toString( getRecordingDelta() );
+        else if (isReplaying()) return ada::toString( getReplayDelta() );
         else return ada::toString(ada::getDelta());
     });
 
@@ -96,13 +140,21 @@ Sandbox::Sandbox():
 
     // MOUSE
     uniforms.functions["u_mouse"] = UniformFunction("vec2", [](ada::Shader& _shader) {
-        _shader.setUniform("u_mouse", float(ada::getMouseX()), float(ada::getMouseY()));
+        if (isReplaying()) _shader.setUniform("u_mouse", getReplayMouseX(), getReplayMouseY());
+        else _shader.setUniform("u_mouse", float(ada::getMouseX()), float(ada::getMouseY()));
     },
-    []() { return ada::toString(ada::getMouseX(),1) + "," + ada::toString(ada::getMouseY(),1); } );
+    []() { 
+        if (isReplaying()) return ada::toString(getReplayMouseX(),1) + "," + ada::toString(getReplayMouseY(),1);
+        return ada::toString(ada::getMouseX(),1) + "," + ada::toString(ada::getMouseY(),1); 
+    } );
 
     // VIEWPORT
-    uniforms.functions["u_resolution"]= UniformFunction("vec2", [](ada::Shader& _shader) {
-        _shader.setUniform("u_resolution", float(ada::getWindowWidth()), float(ada::getWindowHeight()));
+    uniforms.functions["u_resolution"]= UniformFunction("vec2", [this](ada::Shader& _shader) {
+        // tiles of a big screenshot see the resolution of the whole image
+        if (m_tile_resolution.x > 0.0f)
+            _shader.setUniform("u_resolution", m_tile_resolution.x, m_tile_resolution.y);
+        else
+            _shader.setUniform("u_resolution", float(ada::getWindowWidth()), float(ada::getWindowHeight()));
     },
     []() { return ada::toString((float)ada::getWindowWidth(),1) + "," + ada::toString((float)ada::getWindowHeight(),1); });
 
@@ -136,12 +188,24 @@ Sandbox::~Sandbox() {
         std::this_thread::sleep_for(std::chrono::milliseconds{10});
     
     #endif
+
+    // in case clear() never ran
+    if (m_tiles_texture) {
+        delete m_tiles_texture;
+        m_tiles_texture = nullptr;
+    }
 }
 
 // ------------------------------------------------------------------------- SET
 
 void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
 
+    // Setup runs on the render thread, which is the one every frame is tracked on
+    uniforms.tracker.setThreadName("render");
+    #if defined(SUPPORT_RECORDING_PIPE)
+    recordingSetTracker(&uniforms.tracker);
+    #endif
+
     // Add Sandbox Commands
     // ----------------------------------------
     _commands.push_back(Command("debug", [&](const std::string& _line){
@@ -217,11 +281,53 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
 
                 else if (values[1] == "framerate")
                     std::cout << uniforms.tracker.logFramerate();
+
+                else if (values[1] == "stats")
+                    std::cout << uniforms.tracker.logStats();
+
+                else if (values[1] == "budget")
+                    std::cout << uniforms.tracker.getBudget() << std::endl;
+
+                else if (values[1] == "counters")
+                    std::cout << uniforms.tracker.logCounters();
+
+                else if (values[1] == "capacity")
+                    std::cout << uniforms.tracker.getCapacity() << std::endl;
+
+                else if (values[1] == "spill")
+                    std::cout << (uniforms.tracker.getSpill().empty() ? "off" : uniforms.tracker.getSpill()) << std::endl;
             }
 
             else if (values.size() == 3) {
 
-                if (values[1] == "average" && 
+                // the rings and the spill file belong to the render thread while tracking
+                if ((values[1] == "capacity" || values[1] == "spill") && uniforms.tracker.isRunning())
+                    std::cout << "Stop tracking before changing the " << values[1] << std::endl;
+
+                else if (values[1] == "capacity")
+                    uniforms.tracker.setCapacity( std::max(1, ada::toInt(values[2])) );
+
+                else if (values[1] == "spill" && values[2] == "off")
+                    uniforms.tracker.setSpill("");
+
+                else if (values[1] == "spill" && !uniforms.tracker.setSpill(values[2]))
+                    std::cout << "Can't write " << values[2] << std::endl;
+
+                else if (values[1] == "budget")
+                    uniforms.tracker.setBudget( ada::toFloat(values[2]) );
+
+                else if (   values[1] == "stats" && 
+                            ada::haveExt(values[2],"csv") ) {
+                    std::ofstream out(values[2]);
+                    out << "track,count,minMs,maxMs,meanMs,stddevMs,p50Ms,p90Ms,p99Ms,p999Ms,overBudget\n";
+                    out << uniforms.tracker.logStats();
+                    out.close();
+                }
+
+                else if (values[1] == "stats")
+                    std::cout << uniforms.tracker.logStats( values[2] );
+
+                else if (values[1] == "average" && 
                     ada::haveExt(values[2],"csv") ) {
                     std::ofstream out(values[2]);
                     out << uniforms.tracker.logAverage();
@@ -231,10 +337,17 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
                 else if (values[1] == "average")
                     std::cout << uniforms.tracker.logAverage( values[2] );
 
+                else if (   values[1] == "trace" && 
+                            ada::haveExt(values[2],"json") ) {
+                    std::ofstream out(values[2]);
+                    out << uniforms.tracker.logTrace();
+                    out.close();
+                }
+
                 else if (   values[1] == "samples" && 
                             ada::haveExt(values[2],"csv") ) {
                     std::ofstream out(values[2]);
-                    out << "track,timeStampMs,durationMs\n";
+                    out << "track,timeStampMs,durationMs,gpuDurationMs\n";
                     out << uniforms.tracker.logSamples();
                     out.close();
                 }
@@ -259,12 +372,20 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
                     out.close();
                 }
 
+                else if (   values[1] == "stats" && 
+                    ada::haveExt(values[3],"csv") ) {
+                    std::ofstream out( values[3] );
+                    out << "track,count,minMs,maxMs,meanMs,stddevMs,p50Ms,p90Ms,p99Ms,p999Ms,overBudget\n";
+                    out << uniforms.tracker.logStats( values[2] );
+                    out.close();
+                }
+
             }
 
         }
         return false;
     },
-    "track[,on|off|average|samples]", "start/stop tracking rendering time", false));
+    "track[,on|off|average|samples|stats|counters|budget|capacity|spill|trace]", "start/stop tracking rendering time, print its averages, samples, stats or counters, set its budget, capacity or spill file, or export a trace", false));
 
     _commands.push_back(Command("reset", [&](const std::string& _line){
         if (_line == "reset") {
@@ -305,6 +426,7 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
             if (values[0] == "plot" && values.size() == 2) {
 
                 m_plot_shader.delDefine("PLOT_VALUE");
+                std::fill(m_plot_values, m_plot_values + 256, glm::vec4(0.0f));
                 if (values[1] == "off") 
                     m_plot = PLOT_OFF;
                 else if (values[1] == "luma") {
@@ -335,6 +457,7 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
                     m_plot = PLOT_MS;
                     m_plot_shader.addDefine("PLOT_VALUE", "color.rgb += digits(uv * 0.1 + vec2(0.105, -0.01), value.r * 60.0, 1.0); color += stroke(fract(st.y * 3.0), 0.5, 0.05) * 0.1;");
                 }
+                flagChange();
                 return true;
             }
         }
@@ -342,6 +465,46 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
     },
     "plot[,off|luma|red|green|blue|rgb|fps|ms]", "show/hide a histogram or FPS plot on screen", false));
 
+    _commands.push_back(Command("tiles", [&](const std::string& _line){
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values[0] != "tiles")
+            return false;
+
+        if (values.size() == 1) {
+            if (m_tiles.isRunning())
+                std::cout << "tiles," << m_tiles.getColumns() << "," << m_tiles.getRows() << "," << m_tiles.getTarget() << std::endl;
+            else
+                std::cout << "tiles,off" << std::endl;
+            return true;
+        }
+        else if (values.size() == 2 && values[1] == "off") {
+            m_tiles.stop();
+            return true;
+        }
+        else if (values.size() == 2 && values[1] == "on") {
+            m_tiles.start(16, 9, "canvas");
+            return true;
+        }
+        else if (values.size() == 2 && ada::haveExt(values[1],"csv")) {
+            std::ofstream out(values[1]);
+            out << "column,row,x,y,width,height,samples,meanMs\n";
+            out << m_tiles.logTiles();
+            out.close();
+            return true;
+        }
+        else if (values.size() == 3 || values.size() == 4) {
+            std::string target = (values.size() == 4) ? values[3] : "canvas";
+            if (target != "canvas" && !ada::beginsWith(target, "u_buffer")) {
+                std::cout << "Only the canvas or a u_bufferN can be split in tiles" << std::endl;
+                return true;
+            }
+            m_tiles.start(ada::toInt(values[1]), ada::toInt(values[2]), target);
+            return true;
+        }
+        return false;
+    },
+    "tiles[,on|off|<columns>,<rows>[,canvas|u_bufferN]|<file.csv>]", "time the canvas (or a u_bufferN) tile by tile and show the cost as a heatmap, or save it to a csv", false));
+
     _commands.push_back(Command("defines", [&](const std::string& _line){ 
         if (_line == "defines") {
             if (geom_index == -1)
@@ -353,7 +516,74 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
         return false;
     },
     "defines", "return a list of active defines", false));
+
+    _commands.push_back(Command("shaders", [&](const std::string& _line){ 
+        std::vector<std::string> values = ada::split(_line,',');
+        if (values.size() == 2 && values[1] == "stats") {
+            std::cout << uniforms.shaderStats.logStats();
+            return true;
+        }
+        else if (values.size() == 3 && values[1] == "stats" && ada::haveExt(values[2],"csv")) {
+            std::ofstream out(values[2]);
+            out << "pass,defines,hash,bytes,ms,status,redundant,unchanged,cached\n";
+            out << uniforms.shaderStats.logPrograms();
+            out.close();
+            return true;
+        }
+        else if (values.size() == 2 && values[1] == "cache") {
+            std::cout << uniforms.programCache.logStats();
+            return true;
+        }
+        else if (values.size() == 3 && values[1] == "cache") {
+            return uniforms.programCache.setFolder(values[2] == "off" ? "" : values[2]);
+        }
+        else if (values.size() == 2 && values[1] == "metadata") {
+            // the scan of one reload, timed over a few runs to get past the noise
+            const int runs = 100;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < runs; i++) {
+                scanShader(m_frag_source);
+                scanShader(m_vert_source);
+            }
+            double ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() * 0.001 / runs;
+
+            std::cout << "buffers," << m_frag_metadata.buffers << std::endl;
+            std::cout << "doubleBuffers," << m_frag_metadata.doubleBuffers << std::endl;
+            std::cout << "convolutionPyramids," << m_frag_metadata.convolutionPyramids << std::endl;
+            std::cout << "convolutionPyramid," << (m_frag_metadata.convolutionPyramid ? "on" : "off") << std::endl;
+            std::cout << "postprocessing," << (m_frag_metadata.postprocessing ? "on" : "off") << std::endl;
+            std::cout << "background," << (m_frag_metadata.background ? "on" : "off") << std::endl;
+            std::cout << "floor," << ((m_frag_metadata.floor || m_vert_metadata.floor) ? "on" : "off") << std::endl;
+            for (std::map<std::string, glm::vec2>::const_iterator it = m_frag_metadata.bufferSizes.begin(); it != m_frag_metadata.bufferSizes.end(); ++it)
+                std::cout << "size," << it->first << "," << it->second.x << "x" << it->second.y << std::endl;
+            std::cout << "declared," << (m_frag_metadata.declared.size() + m_vert_metadata.declared.size()) << std::endl;
+            std::cout << "bytes," << (m_frag_source.size() + m_vert_source.size()) << std::endl;
+            std::cout << "scanMs," << ms << std::endl;
+            return true;
+        }
+        return false;
+    },
+    "shaders,stats[,<file.csv>]|cache[,<folder>|off]|metadata", "return compile stats, program cache stats or shader metadata", false));
     
+    _commands.push_back(Command("memory", [&](const std::string& _line){ 
+        if (_line == "memory") {
+            std::cout << m_memory.log();
+            return true;
+        }
+        else if (ada::haveExt(_line,"csv")) {
+            std::vector<std::string> values = ada::split(_line,',');
+            if (values.size() == 2) {
+                std::ofstream out(values[1]);
+                out << "owner,kind,format,size,count,bytes\n";
+                out << m_memory.log();
+                out.close();
+                return true;
+            }
+        }
+        return false;
+    },
+    "memory[,<file.csv>]", "return the estimated video memory of buffers, textures and readbacks", false));
+
     _commands.push_back(Command("uniforms", [&](const std::string& _line){ 
         std::vector<std::string> values = ada::split(_line,',');
 
@@ -467,6 +697,23 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
     },
     "error_screen,on|off", "enable/disable magenta screen on errors", false));
 
+    _commands.push_back(Command("background_compile", [&](const std::string& _line){ 
+        if (_line == "background_compile") {
+            std::string rta = m_compile_background ? "on" : "off";
+            std::cout << "background_compile," << rta << (m_compiler.isParallel() ? ",parallel" : "") << std::endl; 
+            return true;
+        }
+        else {
+            std::vector<std::string> values = ada::split(_line,',');
+            if (values.size() == 2) {
+                m_compile_background = (values[1] == "on");
+                return true;
+            }
+        }
+        return false;
+    },
+    "background_compile[,on|off]", "compile changed shaders while the current ones keep rendering", false));
+
     // LIGTH
     _commands.push_back(Command("lights", [&](const std::string& _line){ 
         if (_line == "lights") {
@@ -769,18 +1016,61 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
     },
     "streams[,stop|play|restart|speed|prevs[,<value>]]", "print all streams or get/set streams speed and previous frames"));
 
+    _commands.push_back(Command("record_pool", [&](const std::string & line) {
+        std::vector<std::string> values = ada::split(line,',');
+        if (values.size() == 2) {
+            if (values[1] == "reset")
+                m_record_readback.getPool().resetStats();
+            else
+                m_record_pool_slabs = std::max(0, ada::toInt(values[1]));
+            return true;
+        }
+        else {
+            PixelsPool& pool = m_record_readback.getPool();
+            std::cout << "slabs," << pool.getTotal() << std::endl;
+            std::cout << "free," << pool.getFree() << std::endl;
+            std::cout << "slab_bytes," << pool.getSlabSize() << std::endl;
+            std::cout << "waits," << pool.getWaits() << std::endl;
+            std::cout << "wait_ms," << pool.getWaitMs() << std::endl;
+            std::cout << "max_wait_ms," << pool.getMaxWaitMs() << std::endl;
+            return true;
+        }
+        return false;
+    }, "record_pool[,<slabs>|reset]", "print the frames pool usage and how long capture waited for a free slab, or set its size (0 = auto)", false));
+
     #if defined(SUPPORT_MULTITHREAD_RECORDING)
+    // Deprecated, the save queue is bounded by the slabs of the record pool now. The budget becomes slabs of the current frame size
     _commands.push_back(Command("max_mem_in_queue", [&](const std::string & line) {
+        std::cout << "max_mem_in_queue is deprecated, use record_pool[,<slabs>]" << std::endl;
+
+        size_t slabBytes = m_record_readback.getPool().getSlabSize();
+        if (slabBytes == 0)
+            slabBytes = (size_t)ada::getWindowWidth() * ada::getWindowHeight() * 4;
+
         std::vector<std::string> values = ada::split(line,',');
         if (values.size() == 2) {
-            m_max_mem_in_queue = std::stoll(values[1]);
+            long long bytes = std::max(0LL, atoll(values[1].c_str()));
+            m_record_pool_slabs = std::max(m_record_readback_depth + 1, (size_t)bytes / std::max((size_t)1, slabBytes));
+            std::cout << "record_pool," << m_record_pool_slabs << std::endl;
+        }
+        else
+            std::cout << _getPoolSlabs() * slabBytes << std::endl;
+        return true;
+    }, "max_mem_in_queue[,<bytes>]", "deprecated, use record_pool", false));
+    #endif
+
+    _commands.push_back(Command("readback_depth", [&](const std::string & line) {
+        std::vector<std::string> values = ada::split(line,',');
+        if (values.size() == 2) {
+            m_record_readback_depth = std::max(1, ada::toInt(values[1]));
+            return true;
         }
         else {
-            std::cout << m_max_mem_in_queue.load() << std::endl;
+            std::cout << m_record_readback_depth << std::endl;
+            return true;
         }
         return false;
-    }, "max_mem_in_queue[,<bytes>]", "set the maximum amount of memory used by a queue to export images to disk"));
-    #endif
+    }, "readback_depth[,<frames>]", "get or set how many frames the recording readback can lag behind the render (default: 3)", false));
 
     // LOAD SHACER 
     // -----------------------------------------------
@@ -789,7 +1079,7 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
         m_frag_source = "";
         m_frag_dependencies.clear();
 
-        if ( !ada::loadGlslFrom(_files[frag_index].path, &m_frag_source, include_folders, &m_frag_dependencies) )
+        if ( !includes.load(_files[frag_index].path, &m_frag_source, include_folders, &m_frag_dependencies) )
             return;
 
         ada::setVersionFromCode(m_frag_source);
@@ -807,7 +1097,7 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
         m_vert_source = "";
         m_vert_dependencies.clear();
 
-        ada::loadGlslFrom(_files[vert_index].path, &m_vert_source, include_folders, &m_vert_dependencies);
+        includes.load(_files[vert_index].path, &m_vert_source, include_folders, &m_vert_dependencies);
     }
     else {
         // If there is no use the default one
@@ -823,7 +1113,8 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
     // LOAD GEOMETRY
     // -----------------------------------------------
     if (geom_index == -1) {
-        m_canvas_shader.addDefine("MODEL_VERTEX_TEXCOORD", "v_texcoord");
+        m_canvas_shader.addDefine("MODEL_VERTEX_TEXCOORD", "v_texcoord");   // as in canvas_defines
+        m_canvas_tiled_shader.addDefine("MODEL_VERTEX_TEXCOORD", "v_texcoord");
         uniforms.getCamera().orbit(m_camera_azimuth, m_camera_elevation, 2.0);
     }
     else {
@@ -889,6 +1180,8 @@ void Sandbox::setup( WatchFileList &_files, CommandList &_commands ) {
 }
 
 void Sandbox::addDefine(const std::string &_define, const std::string &_value) {
+    uniforms.shaderStats.setDefine(_define, _value);
+
     for (int i = 0; i < m_buffers_total; i++)
         m_buffers_shaders[i].addDefine(_define, _value);
 
@@ -897,6 +1190,7 @@ void Sandbox::addDefine(const std::string &_define, const std::string &_value) {
 
     // if (geom_index == -1)
         m_canvas_shader.addDefine(_define, _value);
+        m_canvas_tiled_shader.addDefine(_define, _value);
     // else
         m_scene.addDefine(_define, _value);
 
@@ -904,14 +1198,18 @@ void Sandbox::addDefine(const std::string &_define, const std::string &_value) {
 }
 
 void Sandbox::delDefine(const std::string &_define) {
+    uniforms.shaderStats.delDefine(_define);
+
     for (int i = 0; i < m_buffers_total; i++)
         m_buffers_shaders[i].delDefine(_define);
 
     for (int i = 0; i < m_doubleBuffers_total; i++)
         m_doubleBuffers_shaders[i].delDefine(_define);
 
-    if (geom_index == -1)
+    if (geom_index == -1) {
         m_canvas_shader.delDefine(_define);
+        m_canvas_tiled_shader.delDefine(_define);
+    }
     else
         m_scene.delDefine(_define);
 
@@ -920,6 +1218,14 @@ void Sandbox::delDefine(const std::string &_define) {
 
 // ------------------------------------------------------------------------- GET
 
+float Sandbox::getTime() const {
+    if (isRecording()) 
+        return getRecordingTime();
+    else if (isReplaying()) 
+        return getReplayTime();
+    return float(ada::getTime()) - m_time_offset;
+}
+
 bool Sandbox::isReady() {
     return m_initialized;
 }
@@ -946,7 +1252,8 @@ bool Sandbox::haveChange() {
             isRecording() ||
             screenshotFile != "" ||
             m_scene.haveChange() ||
-            uniforms.haveChange();
+            uniforms.haveChange() ||
+            m_plot_histogram.getPending() > 0;
 }
 
 const std::string& Sandbox::getSource(ShaderType _type) const {
@@ -966,8 +1273,10 @@ void Sandbox::_updateSceneBuffer(int _width, int _height) {
     if (!m_scene_fbo.isAllocated() ||
         m_scene_fbo.getType() != type || 
         m_scene_fbo.getWidth() != _width || 
-        m_scene_fbo.getHeight() != _height )
+        m_scene_fbo.getHeight() != _height ) {
         m_scene_fbo.allocate(_width, _height, type);
+        _updateMemory();
+    }
 }
 
 bool Sandbox::setSource(ShaderType _type, const std::string& _source) {
@@ -978,33 +1287,51 @@ bool Sandbox::setSource(ShaderType _type, const std::string& _source) {
 };
 
 bool Sandbox::reloadShaders( WatchFileList &_files ) {
+    TrackerScope track(&uniforms.tracker, "reload:shaders");
+    uniforms.shaderStats.beginReload();
     flagChange();
 
+    // What the shaders ask for (buffers, postprocessing, native uniforms, ...), read once for the whole reload
+    {
+        TrackerScope trackScan(&uniforms.tracker, "reload:scan");
+        m_frag_metadata = scanShader(m_frag_source);
+        m_vert_metadata = scanShader(m_vert_source);
+    }
+
     // UPDATE scene shaders of models (materials)
     if (geom_index == -1) {
 
         if (verbose)
             std::cout << "Reload 2D shaders" << std::endl;
 
-        // Reload the shader
-        m_canvas_shader.detach(GL_FRAGMENT_SHADER | GL_VERTEX_SHADER);
-        m_canvas_shader.load(m_frag_source, m_vert_source, verbose, m_error_screen);
+        // Reload the shader, unless the edit was on the code of other passes
+        if (!uniforms.shaderStats.skip(m_canvas_shader, "canvas", canvas_defines, m_frag_source, m_vert_source)) {
+            m_canvas_shader.detach(GL_FRAGMENT_SHADER | GL_VERTEX_SHADER);
+            uniforms.shaderStats.load(m_canvas_shader, "canvas", canvas_defines, m_frag_source, m_vert_source, verbose, m_error_screen);
+        }
     }
     else {
         if (verbose)
             std::cout << "Reload 3D scene shaders" << std::endl;
 
-        m_scene.loadShaders(m_frag_source, m_vert_source, verbose);
+        m_scene.loadShaders(uniforms, m_frag_source, m_vert_source, m_frag_metadata, m_vert_metadata, verbose);
     }
 
     // UPDATE shaders dependencies
     {
         ada::StringList new_dependencies = ada::merge(m_frag_dependencies, m_vert_dependencies);
 
-        // remove old dependencies
-        for (int i = _files.size() - 1; i >= 0; i--)
-            if (_files[i].type == GLSL_DEPENDENCY)
+        // remove the dependencies that are gone, the ones still there keep their last change
+        for (int i = _files.size() - 1; i >= 0; i--) {
+            if (_files[i].type != GLSL_DEPENDENCY)
+                continue;
+
+            ada::StringList::iterator it = std::find(new_dependencies.begin(), new_dependencies.end(), _files[i].path);
+            if (it == new_dependencies.end())
                 _files.erase( _files.begin() + i);
+            else
+                new_dependencies.erase(it);
+        }
 
         // Add new dependencies
         struct stat st;
@@ -1022,7 +1349,7 @@ bool Sandbox::reloadShaders( WatchFileList &_files ) {
     }
 
     // UPDATE uniforms
-    uniforms.checkPresenceIn(m_vert_source, m_frag_source); // Check active native uniforms
+    uniforms.checkPresenceIn(m_vert_metadata, m_frag_metadata); // Check active native uniforms
     uniforms.flagChange();                                  // Flag all user defined uniforms as changed
 
     if (uniforms.cubemap) {
@@ -1031,26 +1358,27 @@ bool Sandbox::reloadShaders( WatchFileList &_files ) {
     }
 
     // UPDATE Buffers
-    m_buffers_total = countBuffers(m_frag_source);
-    m_doubleBuffers_total = countDoubleBuffers(m_frag_source);
-    m_convolution_pyramid_total = countConvolutionPyramid( getSource(FRAGMENT) );
+    m_buffers_total = m_frag_metadata.buffers;
+    m_doubleBuffers_total = m_frag_metadata.doubleBuffers;
+    m_convolution_pyramid_total = m_frag_metadata.convolutionPyramids;
     _updateBuffers();
     
     // UPDATE Postprocessing
-    bool havePostprocessing = checkPostprocessing( getSource(FRAGMENT) );
+    bool havePostprocessing = m_frag_metadata.postprocessing;
     if (havePostprocessing) {
         // Specific defines for this buffer
         m_postprocessing_shader.addDefine("POSTPROCESSING");
-        m_postprocessing_shader.load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+        if (!uniforms.shaderStats.skip(m_postprocessing_shader, "postprocessing", "POSTPROCESSING", m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD)))
+            uniforms.shaderStats.load(m_postprocessing_shader, "postprocessing", "POSTPROCESSING", m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
         m_postprocessing = havePostprocessing;
     }
     else if (lenticular.size() > 0) {
-        m_postprocessing_shader.load(ada::getLenticularFragShader(ada::getVersion()), ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+        uniforms.shaderStats.load(m_postprocessing_shader, "postprocessing:lenticular", "", ada::getLenticularFragShader(ada::getVersion()), ada::getDefaultSrc(ada::VERT_BILLBOARD));
         uniforms.functions["u_scene"].present = true;
         m_postprocessing = true;
     }
     else if (fxaa) {
-        m_postprocessing_shader.load(ada::getDefaultSrc(ada::FRAG_FXAA), ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+        uniforms.shaderStats.load(m_postprocessing_shader, "postprocessing:fxaa", "", ada::getDefaultSrc(ada::FRAG_FXAA), ada::getDefaultSrc(ada::VERT_BILLBOARD));
         uniforms.functions["u_scene"].present = true;
         m_postprocessing = true;
     }
@@ -1060,6 +1388,7 @@ bool Sandbox::reloadShaders( WatchFileList &_files ) {
     if (m_postprocessing || m_plot == PLOT_RGB || m_plot == PLOT_RED || m_plot == PLOT_GREEN || m_plot == PLOT_BLUE || m_plot == PLOT_LUMA)
         _updateSceneBuffer(ada::getWindowWidth(), ada::getWindowHeight());
 
+    uniforms.shaderStats.endReload();
     console_refresh();
 
     return true;
@@ -1080,21 +1409,22 @@ void Sandbox::_updateBuffers() {
             uniforms.buffers.push_back( ada::Fbo() );
 
             glm::vec2 size = glm::vec2(ada::getWindowWidth(), ada::getWindowHeight());
-            uniforms.buffers[i].fixed = getBufferSize(m_frag_source, "u_buffer" + ada::toString(i), size);
+            uniforms.buffers[i].fixed = m_frag_metadata.getBufferSize("u_buffer" + ada::toString(i), size);
             uniforms.buffers[i].allocate(size.x, size.y, ada::COLOR_FLOAT_TEXTURE);
             
             // New Shader
             m_buffers_shaders.push_back( ada::Shader() );
             m_buffers_shaders[i].addDefine("BUFFER_" + ada::toString(i));
-            m_buffers_shaders[i].load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+            uniforms.shaderStats.load(m_buffers_shaders[i], "u_buffer" + ada::toString(i), "BUFFER_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
         }
     }
     else {
         for (size_t i = 0; i < m_buffers_shaders.size(); i++) {
 
-            // Reload shader code
+            // Reload shader code, if the code of this buffer changed
             m_buffers_shaders[i].addDefine("BUFFER_" + ada::toString(i));
-            m_buffers_shaders[i].load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+            if (!uniforms.shaderStats.skip(m_buffers_shaders[i], "u_buffer" + ada::toString(i), "BUFFER_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD)))
+                uniforms.shaderStats.load(m_buffers_shaders[i], "u_buffer" + ada::toString(i), "BUFFER_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
         }
     }
 
@@ -1111,7 +1441,7 @@ void Sandbox::_updateBuffers() {
             uniforms.doubleBuffers.push_back( ada::PingPong() );
 
             glm::vec2 size = glm::vec2(ada::getWindowWidth(), ada::getWindowHeight());
-            bool fixed = getBufferSize(m_frag_source, "u_doubleBuffer" + ada::toString(i), size);
+            bool fixed = m_frag_metadata.getBufferSize("u_doubleBuffer" + ada::toString(i), size);
             uniforms.doubleBuffers[i][0].fixed = fixed;
             uniforms.doubleBuffers[i][1].fixed = fixed;
             uniforms.doubleBuffers[i].allocate(size.x, size.y, ada::COLOR_FLOAT_TEXTURE);
@@ -1119,15 +1449,16 @@ void Sandbox::_updateBuffers() {
             // New Shader
             m_doubleBuffers_shaders.push_back( ada::Shader() );
             m_doubleBuffers_shaders[i].addDefine("DOUBLE_BUFFER_" + ada::toString(i));
-            m_doubleBuffers_shaders[i].load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+            uniforms.shaderStats.load(m_doubleBuffers_shaders[i], "u_doubleBuffer" + ada::toString(i), "DOUBLE_BUFFER_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
         }
     }
     else {
         for (size_t i = 0; i < m_doubleBuffers_shaders.size(); i++) {
 
-            // Reload shader code
+            // Reload shader code, if the code of this double buffer changed
             m_doubleBuffers_shaders[i].addDefine("DOUBLE_BUFFER_" + ada::toString(i));
-            m_doubleBuffers_shaders[i].load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+            if (!uniforms.shaderStats.skip(m_doubleBuffers_shaders[i], "u_doubleBuffer" + ada::toString(i), "DOUBLE_BUFFER_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD)))
+                uniforms.shaderStats.load(m_doubleBuffers_shaders[i], "u_doubleBuffer" + ada::toString(i), "DOUBLE_BUFFER_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
         }
     }
 
@@ -1141,7 +1472,7 @@ void Sandbox::_updateBuffers() {
         m_convolution_pyramid_subshaders.clear();
         for (int i = 0; i < m_convolution_pyramid_total; i++) {
             glm::vec2 size = glm::vec2(ada::getWindowWidth(), ada::getWindowHeight());
-            bool fixed = getBufferSize(m_frag_source, "u_convolutionPyramid" + ada::toString(i), size);
+            bool fixed = m_frag_metadata.getBufferSize("u_convolutionPyramid" + ada::toString(i), size);
             
             uniforms.convolution_pyramids.push_back( ada::ConvolutionPyramid() );
             uniforms.convolution_pyramids[i].allocate(size.x, size.y);
@@ -1175,26 +1506,35 @@ void Sandbox::_updateBuffers() {
         }
     }
     
-    if ( checkConvolutionPyramid( getSource(FRAGMENT) ) ) {
+    if ( m_frag_metadata.convolutionPyramid ) {
         m_convolution_pyramid_shader.addDefine("CONVOLUTION_PYRAMID_ALGORITHM");
-        m_convolution_pyramid_shader.load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+        if (!uniforms.shaderStats.skip(m_convolution_pyramid_shader, "u_convolutionPyramid", "CONVOLUTION_PYRAMID_ALGORITHM", m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD)))
+            uniforms.shaderStats.load(m_convolution_pyramid_shader, "u_convolutionPyramid", "CONVOLUTION_PYRAMID_ALGORITHM", m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
     }
-    else
-        m_convolution_pyramid_shader.load(ada::getDefaultSrc(ada::FRAG_POISSON), ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+    else if (!uniforms.shaderStats.skip(m_convolution_pyramid_shader, "u_convolutionPyramid:poisson", "", ada::getDefaultSrc(ada::FRAG_POISSON), ada::getDefaultSrc(ada::VERT_BILLBOARD)))
+        uniforms.shaderStats.load(m_convolution_pyramid_shader, "u_convolutionPyramid:poisson", "", ada::getDefaultSrc(ada::FRAG_POISSON), ada::getDefaultSrc(ada::VERT_BILLBOARD));
 
     for (size_t i = 0; i < m_convolution_pyramid_subshaders.size(); i++) {
         m_convolution_pyramid_subshaders[i].addDefine("CONVOLUTION_PYRAMID_" + ada::toString(i));
-        m_convolution_pyramid_subshaders[i].load(m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+        if (!uniforms.shaderStats.skip(m_convolution_pyramid_subshaders[i], "u_convolutionPyramid" + ada::toString(i), "CONVOLUTION_PYRAMID_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD)))
+            uniforms.shaderStats.load(m_convolution_pyramid_subshaders[i], "u_convolutionPyramid" + ada::toString(i), "CONVOLUTION_PYRAMID_" + ada::toString(i), m_frag_source, ada::getDefaultSrc(ada::VERT_BILLBOARD));
     }
+
+    _updateMemory();
 }
 
 // ------------------------------------------------------------------------- DRAW
 void Sandbox::_renderBuffers() {
     glDisable(GL_BLEND);
 
+    // only looked up again when the amount of buffers changes
+    uniforms.tracker.getIds("render:buffer", uniforms.buffers.size(), m_buffers_track);
+    uniforms.tracker.getIds("render:doubleBuffer", uniforms.doubleBuffers.size(), m_doubleBuffers_track);
+    uniforms.tracker.getIds("render:convolution_pyramid", m_convolution_pyramid_subshaders.size(), m_convolution_pyramid_track);
+
     bool reset_viewport = false;
     for (size_t i = 0; i < uniforms.buffers.size(); i++) {
-        TRACK_BEGIN("render:buffer" + ada::toString(i))
+        TRACK_BEGIN_ID(m_buffers_track[i])
 
         reset_viewport += uniforms.buffers[i].fixed;
 
@@ -1213,15 +1553,20 @@ void Sandbox::_renderBuffers() {
         // Update uniforms and textures
         uniforms.feedTo(m_buffers_shaders[i], true, false);
 
-        m_billboard_vbo->render( &m_buffers_shaders[i] );
+        if (m_tiles.isTarget("u_buffer" + ada::toString(i)))
+            m_tiles.render(uniforms.buffers[i].getWidth(), uniforms.buffers[i].getHeight(), [&]() {
+                m_billboard_vbo->render( &m_buffers_shaders[i] );
+            });
+        else
+            m_billboard_vbo->render( &m_buffers_shaders[i] );
         
         uniforms.buffers[i].unbind();
 
-        TRACK_END("render:buffer" + ada::toString(i))
+        TRACK_END_ID(m_buffers_track[i])
     }
 
     for (size_t i = 0; i < uniforms.doubleBuffers.size(); i++) {
-        TRACK_BEGIN("render:doubleBuffer" + ada::toString(i))
+        TRACK_BEGIN_ID(m_doubleBuffers_track[i])
 
         reset_viewport += uniforms.doubleBuffers[i].src->fixed;
 
@@ -1244,14 +1589,14 @@ void Sandbox::_renderBuffers() {
         uniforms.doubleBuffers[i].dst->unbind();
         uniforms.doubleBuffers[i].swap();
 
-        TRACK_END("render:doubleBuffer" + ada::toString(i))
+        TRACK_END_ID(m_doubleBuffers_track[i])
     }
 
     // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA);
     // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     for (size_t i = 0; i < m_convolution_pyramid_subshaders.size(); i++) {
-        TRACK_BEGIN("render:convolution_pyramid" + ada::toString(i))
+        TRACK_BEGIN_ID(m_convolution_pyramid_track[i])
 
         reset_viewport += m_convolution_pyramid_fbos[i].fixed;
 
@@ -1272,7 +1617,7 @@ void Sandbox::_renderBuffers() {
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         uniforms.convolution_pyramids[i].process(&m_convolution_pyramid_fbos[i]);
 
-        TRACK_END("render:convolution_pyramid" + ada::toString(i))
+        TRACK_END_ID(m_convolution_pyramid_track[i])
     }
 
     #if defined(__EMSCRIPTEN__)
@@ -1309,9 +1654,11 @@ void Sandbox::render() {
     
     // MAIN SCENE
     // ----------------------------------------------- < main scene start
-    if (screenshotFile != "" || isRecording() )
-        if (!m_record_fbo.isAllocated())
-            m_record_fbo.allocate(ada::getWindowWidth(), ada::getWindowHeight(), ada::COLOR_TEXTURE_DEPTH_BUFFER);
+    if (screenshotFile != "" || isRecording() ) {
+        bool hdr = _isRecordHDR();
+        if (!m_record_fbo.isAllocated() || (m_record_fbo.getType() == ada::COLOR_FLOAT_TEXTURE) != hdr)
+            _allocateRecordFbo(ada::getWindowWidth(), ada::getWindowHeight(), hdr);
+    }
 
     if (m_postprocessing || m_plot == PLOT_LUMA || m_plot == PLOT_RGB || m_plot == PLOT_RED || m_plot == PLOT_GREEN || m_plot == PLOT_BLUE ) {
         _updateSceneBuffer(ada::getWindowWidth(), ada::getWindowHeight());
@@ -1353,7 +1700,12 @@ void Sandbox::render() {
 
             // Pass special uniforms
             m_canvas_shader.setUniform("u_modelViewProjectionMatrix", glm::mat4(1.));
-            m_billboard_vbo->render( &m_canvas_shader );
+            if (m_tiles.isTarget("canvas"))
+                m_tiles.render(ada::getWindowWidth(), ada::getWindowHeight(), [&]() {
+                    m_billboard_vbo->render( &m_canvas_shader );
+                });
+            else
+                m_billboard_vbo->render( &m_canvas_shader );
         }
 
         TRACK_END("render:billboard")
@@ -1696,6 +2048,40 @@ void Sandbox::renderUI() {
         // TRACK_END("plot_data")
     }
 
+    if (m_tiles.isRunning()) {
+        glDisable(GL_DEPTH_TEST);
+
+        std::vector<float> heatmap;
+        double maxMs = m_tiles.getHeatmap(heatmap);
+        int columns = (int)m_tiles.getColumns();
+        int rows = (int)m_tiles.getRows();
+
+        if (heatmap.size() == (size_t)(columns * rows * 4)) {
+            bool resized = m_tiles_texture == nullptr || m_tiles_texture->getWidth() != columns || m_tiles_texture->getHeight() != rows;
+            if (m_tiles_texture == nullptr)
+                m_tiles_texture = new ada::Texture();
+            m_tiles_texture->load(columns, rows, 4, 32, &heatmap[0], ada::NEAREST, ada::CLAMP);
+            if (resized)
+                _updateMemory();
+
+            if (!m_tiles_shader.isLoaded())
+                m_tiles_shader.load(tiles_heatmap_frag, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+
+            m_tiles_shader.use();
+            m_tiles_shader.setUniform("u_resolution", (float)ada::getWindowWidth(), (float)ada::getWindowHeight());
+            m_tiles_shader.setUniform("u_tiles", (float)columns, (float)rows);
+            m_tiles_shader.setUniformTexture("u_tex0", m_tiles_texture, 0);
+            m_billboard_vbo->render(&m_tiles_shader);
+
+            float p = ada::getPixelDensity();
+            ada::textAngle(0.0f);
+            ada::textAlign(ada::ALIGN_TOP);
+            ada::textAlign(ada::ALIGN_LEFT);
+            ada::textSize(12.0f * p);
+            ada::text(m_tiles.getTarget() + " " + ada::toString(columns) + "x" + ada::toString(rows) + " slowest tile " + ada::toString((float)maxMs, 3) + "ms", 10.0f * p, 10.0f * p);
+        }
+    }
+
     if (cursor && ada::getMouseEntered()) {
 
         // TRACK_BEGIN("cursor")
@@ -1720,19 +2106,51 @@ void Sandbox::renderDone() {
 
     // RECORD
     if (isRecording()) {
-        onScreenshot( ada::toString( getRecordingCount() , 0, 5, '0') + ".png");
+        onScreenshot( recordingFrameFile( getRecordingCount() ) );
         recordingFrameAdded();
+
+        // That was the last frame, deliver the ones still waiting on the readback ring
+        if (!isRecording()) {
+            m_record_readback.flush();
+            #if defined(SUPPORT_RECORDING_PIPE)
+            recordingPipeEnd();
+            #endif
+
+            float secs = getRecordingElapsed();
+            console_clear();
+            std::cout << "Rendered " << getRecordingRendered() << " frames in " << secs << " secs (" << (secs > 0.0f ? getRecordingRendered() / secs : 0.0f) << " fps)" << std::endl;
+            console_refresh();
+        }
     }
     // SCREENSHOT 
     else if (screenshotFile != "") {
-        onScreenshot(screenshotFile);
+        if (screenshotWidth > 0 && screenshotHeight > 0 &&
+            (screenshotWidth != ada::getWindowWidth() || screenshotHeight != ada::getWindowHeight()) )
+            _renderTiledScreenshot(screenshotFile, screenshotWidth, screenshotHeight);
+        else
+            onScreenshot(screenshotFile);
         screenshotFile = "";
+        screenshotWidth = 0;
+        screenshotHeight = 0;
     }
 
+    // what onPlot() measures only changes if something did on this frame
+    bool change = m_change || m_scene.haveChange() || uniforms.haveChange();
     unflagChange();
 
     if (m_plot != PLOT_OFF)
-        onPlot();
+        onPlot(change);
+
+    // the snapshot is taken where things are (re)allocated, here it's only reported
+    if (uniforms.tracker.isRunning()) {
+        const double mb = 1.0 / (1024.0 * 1024.0);
+        uniforms.tracker.counter("memory", m_memory.getTotal() * mb);
+        uniforms.tracker.counter("memory:peak", m_memory.getPeak() * mb);
+        uniforms.tracker.counter("memory:fbo", m_memory.getTotal("fbo") * mb);
+        uniforms.tracker.counter("memory:texture", m_memory.getTotal("texture") * mb);
+        uniforms.tracker.counter("memory:stream", m_memory.getTotal("stream") * mb);
+        uniforms.tracker.counter("memory:readback", m_memory.getTotal("readback") * mb);
+    }
 
     if (!m_initialized) {
         m_initialized = true;
@@ -1749,16 +2167,32 @@ void Sandbox::renderDone() {
 // ------------------------------------------------------------------------- ACTIONS
 
 void Sandbox::clear() {
+    m_record_readback.clear();
+    if (m_record_depth) {
+        glDeleteRenderbuffers(1, &m_record_depth);
+        m_record_depth = 0;
+    }
+    m_plot_histogram.clear();
     uniforms.clear();
 
     if (geom_index != -1)
         m_scene.clear();
 
-    if (m_billboard_vbo)
+    if (m_billboard_vbo) {
         delete m_billboard_vbo;
+        m_billboard_vbo = nullptr;
+    }
 
-    if (m_cross_vbo)
+    if (m_cross_vbo) {
         delete m_cross_vbo;
+        m_cross_vbo = nullptr;
+    }
+
+    if (m_tiles_texture) {
+        delete m_tiles_texture;
+        m_tiles_texture = nullptr;
+    }
+    m_tiles.clear();
 }
 
 void Sandbox::printDependencies(ShaderType _type) const {
@@ -1782,6 +2216,10 @@ void Sandbox::onFileChange(WatchFileList &_files, int index) {
     FileType type = _files[index].type;
     std::string filename = _files[index].path;
 
+    // Only the file that changed is read again, the rest of the includes come from memory
+    if (type == FRAG_SHADER || type == VERT_SHADER || type == GLSL_DEPENDENCY)
+        includes.invalidate(filename);
+
     // IF the change is on a dependency file, re route to the correct shader that need to be reload
     if (type == GLSL_DEPENDENCY) {
         if (std::find(m_frag_dependencies.begin(), m_frag_dependencies.end(), filename) != m_frag_dependencies.end()) {
@@ -1794,17 +2232,30 @@ void Sandbox::onFileChange(WatchFileList &_files, int index) {
         }
     }
     
-    if (type == FRAG_SHADER) {
-        m_frag_source = "";
-        m_frag_dependencies.clear();
-        if ( ada::loadGlslFrom(filename, &m_frag_source, include_folders, &m_frag_dependencies) )
-            reloadShaders(_files);
-    }
-    else if (type == VERT_SHADER) {
-        m_vert_source = "";
-        m_vert_dependencies.clear();
-        if ( ada::loadGlslFrom(filename, &m_vert_source, include_folders, &m_vert_dependencies) )
-            reloadShaders(_files);
+    if (type == FRAG_SHADER || type == VERT_SHADER) {
+        std::string source = "";
+        ada::StringList dependencies;
+        if ( includes.load(filename, &source, include_folders, &dependencies) ) {
+            // an edit while others compile builds on the sources they were compiling
+            if (!m_compiler.isCompiling()) {
+                m_compile_frag_source = m_frag_source;
+                m_compile_vert_source = m_vert_source;
+                m_compile_frag_dependencies = m_frag_dependencies;
+                m_compile_vert_dependencies = m_vert_dependencies;
+            }
+
+            if (type == FRAG_SHADER) {
+                m_compile_frag_source = source;
+                m_compile_frag_dependencies = dependencies;
+            }
+            else {
+                m_compile_vert_source = source;
+                m_compile_vert_dependencies = dependencies;
+            }
+
+            if (!_compileInBackground())
+                _applyCompiled(_files);
+        }
     }
     else if (type == GEOMETRY) {
         // TODO
@@ -1813,19 +2264,96 @@ void Sandbox::onFileChange(WatchFileList &_files, int index) {
         for (TextureList::iterator it = uniforms.textures.begin(); it!=uniforms.textures.end(); it++) {
             if (filename == it->second->getFilePath()) {
                 std::cout << filename << std::endl;
+                TrackerScope track(&uniforms.tracker, "load:" + it->first);
                 it->second->load(filename, _files[index].vFlip);
+                _updateMemory();
                 break;
             }
         }
     }
     else if (type == CUBEMAP) {
-        if (uniforms.cubemap)
+        if (uniforms.cubemap) {
             uniforms.cubemap->load(filename, _files[index].vFlip);
+            _updateMemory();
+        }
     }
 
     flagChange();
 }
 
+/** The programs of the new sources are compiled by m_compiler while the current ones keep rendering.
+ *  Only on drivers that compile on their own threads, elsewhere it would be the same synchronous
+ *  reload with extra steps. Only the 2D passes glslViewer compiles itself go there (the materials
+ *  of models are compiled by ada), and never while recording or replaying, where each frame has to
+ *  show what it always did **/
+bool Sandbox::_compileInBackground() {
+    m_compiler.clear();
+    if (!m_compile_background || !m_compiler.isParallel() || geom_index != -1 || isRecording() || isReplaying())
+        return false;
+
+    const std::string& frag = m_compile_frag_source;
+    const std::string billboard = ada::getDefaultSrc(ada::VERT_BILLBOARD);
+    std::vector<CompileSource> programs;
+
+    // passes that end up with the same code they have now are skipped by the reload anyway
+    auto add = [&](ada::Shader* _shader, const std::string& _pass, const std::string& _defines, const std::string& _vert) {
+        if (_shader && uniforms.shaderStats.isCurrent(*_shader, _pass, _defines, frag, _vert))
+            return;
+
+        CompileSource program;
+        program.pass = _pass;
+        program.defines = _defines;
+        program.fragSrc = frag;
+        program.vertSrc = _vert;
+        programs.push_back(program);
+    };
+
+    add(&m_canvas_shader, "canvas", canvas_defines, m_compile_vert_source);
+
+    ShaderMetadata metadata = scanShader(frag);
+    int buffers = metadata.buffers;
+    for (int i = 0; i < buffers; i++)
+        add((i < (int)m_buffers_shaders.size() && buffers == m_buffers_total) ? &m_buffers_shaders[i] : nullptr, "u_buffer" + ada::toString(i), "BUFFER_" + ada::toString(i), billboard);
+
+    int doubleBuffers = metadata.doubleBuffers;
+    for (int i = 0; i < doubleBuffers; i++)
+        add((i < (int)m_doubleBuffers_shaders.size() && doubleBuffers == m_doubleBuffers_total) ? &m_doubleBuffers_shaders[i] : nullptr, "u_doubleBuffer" + ada::toString(i), "DOUBLE_BUFFER_" + ada::toString(i), billboard);
+
+    if (metadata.convolutionPyramid)
+        add(&m_convolution_pyramid_shader, "u_convolutionPyramid", "CONVOLUTION_PYRAMID_ALGORITHM", billboard);
+
+    int pyramids = metadata.convolutionPyramids;
+    for (int i = 0; i < pyramids; i++)
+        add((i < (int)m_convolution_pyramid_subshaders.size() && pyramids == m_convolution_pyramid_total) ? &m_convolution_pyramid_subshaders[i] : nullptr, "u_convolutionPyramid" + ada::toString(i), "CONVOLUTION_PYRAMID_" + ada::toString(i), billboard);
+
+    if (metadata.postprocessing)
+        add(&m_postprocessing_shader, "postprocessing", "POSTPROCESSING", billboard);
+
+    if (programs.empty() || !m_compiler.start(uniforms.programCache, uniforms.shaderStats.getDefines(), programs))
+        return false;
+
+    if (verbose)
+        std::cout << "Compiling " << programs.size() << " programs in the background" << std::endl;
+    return true;
+}
+
+void Sandbox::updateCompile(WatchFileList &_files) {
+    if (m_compiler.update(uniforms.programCache))
+        _applyCompiled(_files);
+}
+
+// Every pass is reloaded on the same frame, the ones compiled in the background straight from their binaries
+void Sandbox::_applyCompiled(WatchFileList &_files) {
+    m_frag_source = m_compile_frag_source;
+    m_vert_source = m_compile_vert_source;
+    m_frag_dependencies = m_compile_frag_dependencies;
+    m_vert_dependencies = m_compile_vert_dependencies;
+
+    reloadShaders(_files);
+    uniforms.programCache.clearMemory();
+    flagChange();
+}
+
 void Sandbox::onScroll(float _yoffset) {
     // Vertical scroll button zooms u_view2d and view3d.
     /* zoomfactor 2^(1/4): 4 scroll wheel clicks to double in size. */
@@ -1845,6 +2373,11 @@ void Sandbox::onScroll(float _yoffset) {
 }
 
 void Sandbox::onMouseDrag(float _x, float _y, int _button) {
+    onMouseDrag(_x, _y, ada::getMouseVelX(), ada::getMouseVelY(), _button);
+}
+
+// The velocity is passed along so replays can drag exactly as it was recorded
+void Sandbox::onMouseDrag(float _x, float _y, float _velX, float _velY, int _button) {
 
     if (quilt < 0) {
         // If it's not playing on the HOLOPLAY
@@ -1865,13 +2398,13 @@ void Sandbox::onMouseDrag(float _x, float _y, int _button) {
 
     if (_button == 1) {
         // Left-button drag is used to pan u_view2d.
-        m_view2d = glm::translate(m_view2d, glm::vec2(-ada::getMouseVelX(),-ada::getMouseVelY()) );
+        m_view2d = glm::translate(m_view2d, glm::vec2(-_velX,-_velY) );
 
         // Left-button drag is used to rotate geometry.
         float dist = uniforms.getCamera().getDistance();
 
-        float vel_x = ada::getMouseVelX();
-        float vel_y = ada::getMouseVelY();
+        float vel_x = _velX;
+        float vel_y = _velY;
 
         if (fabs(vel_x) < 50.0 && fabs(vel_y) < 50.0) {
             m_camera_azimuth -= vel_x;
@@ -1883,7 +2416,7 @@ void Sandbox::onMouseDrag(float _x, float _y, int _button) {
     else {
         // Right-button drag is used to zoom geometry.
         float dist = uniforms.getCamera().getDistance();
-        dist += (-.008f * ada::getMouseVelY());
+        dist += (-.008f * _velY);
         if (dist > 0.0f) {
             uniforms.getCamera().orbit(m_camera_azimuth, m_camera_elevation, dist);
             uniforms.getCamera().lookAt(glm::vec3(0.0));
@@ -1916,8 +2449,9 @@ void Sandbox::onViewportResize(int _newWidth, int _newHeight) {
         _updateSceneBuffer(_newWidth, _newHeight);
 
     if (screenshotFile != "" || isRecording())
-        m_record_fbo.allocate(_newWidth, _newHeight, ada::COLOR_TEXTURE_DEPTH_BUFFER);
+        _allocateRecordFbo(_newWidth, _newHeight, _isRecordHDR());
 
+    _updateMemory();
     flagChange();
 }
 
@@ -1928,113 +2462,365 @@ void Sandbox::onScreenshot(std::string _file) {
 
         glBindFramebuffer(GL_FRAMEBUFFER, m_record_fbo.getId());
 
-        if (ada::getExt(_file) == "hdr") {
-            float* pixels = new float[ada::getWindowWidth() * ada::getWindowHeight()*4];
-            glReadPixels(0, 0, ada::getWindowWidth(), ada::getWindowHeight(), GL_RGBA, GL_FLOAT, pixels);
-            ada::savePixelsHDR(_file, pixels, ada::getWindowWidth(), ada::getWindowHeight());
+        std::string ext = ada::toLower( ada::getExt(_file) );
+
+        // Frames of a video go to the pipe whatever the format of sequences is
+        #if defined(SUPPORT_RECORDING_PIPE)
+        if (recordingPipe()) {
+            const RecordingSettings& settings = recordingPipeSettings();
+            bool reallocated = false;
+            if (settings.src_yuv) {
+                // reads back 1.5 bytes per pixel instead of 3
+                _renderRecordYUV(settings.src_yuv, settings.src_yuv_full);
+                reallocated = m_record_readback.allocate(m_record_yuv.getFbo().getWidth(), m_record_yuv.getFbo().getHeight(), 4, m_record_readback_depth, _getPoolSlabs());
+            }
+            else
+                reallocated = m_record_readback.allocate(ada::getWindowWidth(), ada::getWindowHeight(), settings.src_channels, m_record_readback_depth, _getPoolSlabs());
+
+            if (reallocated)
+                _updateMemory();
+
+            m_record_readback.read( [](Pixels&& _pixels) {
+                recordingPipeFrame( std::move(_pixels) );
+            });
+
+            if (settings.src_yuv)
+                m_record_yuv.unbind();
         }
-        #if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
-        else if (recordingPipe()) {
+        else
+        #endif
+        if (ext == "hdr" || ext == "exr") {
             int width = ada::getWindowWidth();
             int height = ada::getWindowHeight();
-            auto pixels = std::unique_ptr<unsigned char[]>(new unsigned char [width * height * 3]);
-            glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.get());
-            recordingPipeFrame( std::move(pixels) );
+
+            #if defined(GL_HALF_FLOAT)
+            // half the bandwidth of GL_FLOAT, the saving threads expand them back to floats. GLES only
+            // reads float targets as GL_FLOAT or as the one type the driver prefers
+            GLenum type = GL_HALF_FLOAT;
+                #if defined(GL_ES_VERSION_3_0)
+            GLint preferred = 0;
+            glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &preferred);
+            if (preferred != GL_HALF_FLOAT)
+                type = GL_FLOAT;
+                #endif
+
+            if (m_record_readback.allocate(width, height, 4, m_record_readback_depth, _getPoolSlabs(), type))
+                _updateMemory();
+            m_record_readback.read( [this, _file, width, height, type](Pixels&& _pixels) {
+                if (type == GL_FLOAT)
+                    floatToHalf((const float*)_pixels.get(), (uint16_t*)_pixels.get(), (size_t)width * height * 4);
+                _savePixels(_file, width, height, std::move(_pixels), true);
+            });
+            #else
+            std::vector<float> pixels((size_t)width * height * 4);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+            ada::savePixelsHDR(_file, pixels.data(), width, height);
+            #endif
         }
-        #endif
         else {
             int width = ada::getWindowWidth();
             int height = ada::getWindowHeight();
-            auto pixels = std::unique_ptr<unsigned char[]>(new unsigned char [width * height * 4]);
-            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.get());
+            if (m_record_readback.allocate(width, height, 4, m_record_readback_depth, _getPoolSlabs()))
+                _updateMemory();
+            m_record_readback.read( [this, _file, width, height](Pixels&& _pixels) {
+                _savePixels(_file, width, height, std::move(_pixels));
+            });
+        }
 
-            #if defined(SUPPORT_MULTITHREAD_RECORDING)
-            
-            std::shared_ptr<Job> saverPtr = std::make_shared<Job>(std::move(_file), width, height, std::move(pixels), m_task_count, m_max_mem_in_queue);
-            /** In the case that we render faster than we can safe frames, more and more frames
-             * have to be stored temporary in the save queue. That means that more and more ram is used.
-             * If to much is memory is used, we save the current frame directly to prevent that the system
-             * is running out of memory. Otherwise we put the frame in to the thread queue, so that we can utilize
-             * multilple cpu cores */
-            if (m_max_mem_in_queue <= 0) {
-                Job& saver = *saverPtr;
-                saver();
+        // A single screenshot has no next frame to wait for
+        if ( !isRecording() ) {
+            m_record_readback.flush();
+            std::cout << "Screenshot saved to " << _file << std::endl;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // TRACK_END("screenshot")
+    }
+}
+
+// Converts m_record_fbo into m_record_yuv and leaves it bound, ready to be read
+void Sandbox::_renderRecordYUV(int _matrix, bool _fullRange) {
+    if (m_record_yuv.render(m_record_fbo, _matrix, _fullRange))
+        _updateMemory();
+}
+
+/** Renders an image bigger than the window, one window sized tile at a time. Each tile is drawn on
+ *  the record FBO with a viewport of its own size, and a projection that only sees its part of the
+ *  whole image (an off-axis frustum for the scene, and the same crop on the canvas billboard) so
+ *  the geometry and the varyings land where they belong. gl_FragCoord of the canvas shader gets the
+ *  tile offset added and u_resolution reports the whole image. Tiles are read back and written a
+ *  strip at a time, so only one strip of the image is ever in memory. **/
+void Sandbox::_renderTiledScreenshot(const std::string& _file, int _width, int _height) {
+    if (!ada::isGL())
+        return;
+
+    if (quilt >= 0) {
+        std::cerr << "Screenshots bigger than the window can't be rendered on quilt mode" << std::endl;
+        return;
+    }
+
+    // The offset canvas is a program of its own, compiled again only when the sources or the defines changed
+    if (geom_index == -1) {
+        std::string tiledSource = offsetFragCoord(m_frag_source, "u_tileOffset");
+        if (!uniforms.shaderStats.isCurrent(m_canvas_tiled_shader, "canvas:tiled", canvas_defines, tiledSource, m_vert_source)) {
+            m_canvas_tiled_shader.detach(GL_FRAGMENT_SHADER | GL_VERTEX_SHADER);
+            if (!uniforms.shaderStats.load(m_canvas_tiled_shader, "canvas:tiled", canvas_defines, tiledSource, m_vert_source, verbose, false)) {
+                std::cerr << "Can't render " << _file << ", the shader doesn't compile with gl_FragCoord offset by the tile" << std::endl;
+                return;
+            }
+        }
+    }
+
+    ImageWriter writer;
+    if (!writer.open(_file, _width, _height, 4))
+        return;
+
+    if (m_postprocessing || uniforms.buffers.size() > 0 || uniforms.doubleBuffers.size() > 0 || m_convolution_pyramid_total > 0)
+        std::cout << "Postprocessing is skipped and buffers keep the window resolution on screenshots bigger than the window" << std::endl;
+
+    const int tileWidth = ada::getWindowWidth();
+    const int tileHeight = ada::getWindowHeight();
+    if (!m_record_fbo.isAllocated() || m_record_fbo.getType() != ada::COLOR_TEXTURE_DEPTH_BUFFER)
+        _allocateRecordFbo(tileWidth, tileHeight, false);
+
+    // the camera frames the whole image, each tile crops its projection
+    ada::Camera& camera = uniforms.getCamera();
+    ada::Projection projection = camera.getType();
+    camera.setViewport(_width, _height);
+    const glm::mat4 fullProjection = camera.getProjectionMatrix();
+    m_tile_resolution = glm::vec2(_width, _height);
+
+    std::vector<unsigned char> tile((size_t)tileWidth * tileHeight * 4);
+    std::vector<unsigned char> strip((size_t)_width * tileHeight * 4);
+    int tiles = 0;
+
+    // Strips go from the top of the image down, in the same order the rows are written
+    for (int top = 0; top < _height; top += tileHeight) {
+        int stripHeight = std::min(tileHeight, _height - top);
+        int y = _height - top - stripHeight;
+
+        for (int x = 0; x < _width; x += tileWidth) {
+            int w = std::min(tileWidth, _width - x);
+
+            // maps the clip space of the whole image to the one of the tile [x, x+w] x [y, y+stripHeight]
+            glm::mat4 crop = glm::translate(glm::mat4(1.0f), glm::vec3(float(_width - 2 * x - w) / w, float(_height - 2 * y - stripHeight) / stripHeight, 0.0f));
+            crop = glm::scale(crop, glm::vec3(float(_width) / w, float(_height) / stripHeight, 1.0f));
+
+            m_record_fbo.bind();
+            glViewport(0, 0, w, stripHeight);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            if (geom_index == -1) {
+                m_canvas_tiled_shader.use();
+                uniforms.feedTo( m_canvas_tiled_shader );
+                m_canvas_tiled_shader.setUniform("u_tileOffset", float(x), float(y));
+                m_canvas_tiled_shader.setUniform("u_modelViewProjectionMatrix", crop);
+                m_billboard_vbo->render( &m_canvas_tiled_shader );
             }
             else {
-                auto func = [saverPtr]() {
-                    Job& saver = *saverPtr;
-                    saver();
-                };
-                m_save_threads.Submit(std::move(func));
+                camera.setProjection(crop * fullProjection);
+                camera.bChange = true;
+                m_scene.render(uniforms);
+                if (m_scene.showGrid || m_scene.showAxis || m_scene.showBBoxes)
+                    m_scene.renderDebug(uniforms);
             }
-            #else
 
-            ada::savePixels(_file, pixels.get(), width, height);
+            glReadPixels(0, 0, w, stripHeight, GL_RGBA, GL_UNSIGNED_BYTE, tile.data());
+            m_record_fbo.unbind();
 
-            #endif
+            for (int row = 0; row < stripHeight; row++)
+                memcpy(&strip[((size_t)row * _width + x) * 4], &tile[(size_t)row * w * 4], (size_t)w * 4);
+            tiles++;
         }
-    
-        if ( !isRecording() )
-            std::cout << "Screenshot saved to " << _file << std::endl;
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // TRACK_END("screenshot")
+        // GL rows go bottom up
+        for (int row = stripHeight - 1; row >= 0; row--)
+            writer.writeRows(&strip[(size_t)row * _width * 4], 1);
     }
+
+    m_tile_resolution = glm::vec2(0.0f);
+    camera.setProjection(projection);
+    camera.setViewport(tileWidth, tileHeight);
+    camera.bChange = true;
+    glViewport(0, 0, tileWidth, tileHeight);
+
+    if (writer.close())
+        std::cout << "Screenshot of " << _width << "x" << _height << " saved to " << _file << " in " << tiles << " tiles" << std::endl;
 }
 
-void Sandbox::onPlot() {
-    if ( !ada::isGL() )
-        return;
+/** hdr and exr captures (screenshots and sequences, never the frames of a video) need a float target,
+ *  an RGBA8 one clamps everything to 1.0 before it's read back **/
+bool Sandbox::_isRecordHDR() const {
+    std::string file = screenshotFile;
+    if (isRecording()) {
+        #if defined(SUPPORT_RECORDING_PIPE)
+        if (recordingPipe())
+            return false;
+        #endif
+        file = recordingFrameFile(0);
+    }
 
-    if ( (m_plot == PLOT_LUMA || m_plot == PLOT_RGB || m_plot == PLOT_RED || m_plot == PLOT_GREEN || m_plot == PLOT_BLUE ) && haveChange() ) {
+    std::string ext = ada::toLower( ada::getExt(file) );
+    return ext == "hdr" || ext == "exr";
+}
 
-        // TRACK_BEGIN("plot::histogram")
+// ada's float targets have no depth, the scene gets a depth renderbuffer of its own on them
+void Sandbox::_allocateRecordFbo(int _width, int _height, bool _hdr) {
+    m_record_fbo.allocate(_width, _height, _hdr ? ada::COLOR_FLOAT_TEXTURE : ada::COLOR_TEXTURE_DEPTH_BUFFER);
 
-        // Extract pixels
-        glBindFramebuffer(GL_FRAMEBUFFER, m_scene_fbo.getId());
-        int w = ada::getWindowWidth();
-        int h = ada::getWindowHeight();
-        int c = 3;
-        int total = w * h * c;
-        unsigned char* pixels = new unsigned char[total];
-        glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    if (!_hdr) {
+        if (m_record_depth)
+            glDeleteRenderbuffers(1, &m_record_depth);
+        m_record_depth = 0;
+    }
+    else {
+        if (!m_record_depth)
+            glGenRenderbuffers(1, &m_record_depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_record_depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, _width, _height);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_record_fbo.getId());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_record_depth);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
 
-        // Count frequencies of appearances 
-        float max_rgb_freq = 0;
-        float max_luma_freq = 0;
-        glm::vec4 freqs[256];
-        for (int i = 0; i < total; i += c) {
-            m_plot_values[pixels[i]].r++;
-            if (m_plot_values[pixels[i]].r > max_rgb_freq)
-                max_rgb_freq = m_plot_values[pixels[i]].r;
+    _updateMemory();
+}
 
-            m_plot_values[pixels[i+1]].g++;
-            if (m_plot_values[pixels[i+1]].g > max_rgb_freq)
-                max_rgb_freq = m_plot_values[pixels[i+1]].g;
+// Every (re)allocation takes a new snapshot, so the peak doesn't depend on when it's looked at
+void Sandbox::_updateMemory() {
+    GpuAllocations allocations;
+    _accountMemory(allocations);
+    m_memory.set(allocations);
+}
 
-            m_plot_values[pixels[i+2]].b++;
-            if (m_plot_values[pixels[i+2]].b > max_rgb_freq)
-                max_rgb_freq = m_plot_values[pixels[i+2]].b;
+size_t Sandbox::_getPoolSlabs() const {
+    if (m_record_pool_slabs > 0)
+        return m_record_pool_slabs;
 
-            int luma = 0.299 * pixels[i] + 0.587 * pixels[i+1] + 0.114 * pixels[i+2];
-            m_plot_values[luma].a++;
-            if (m_plot_values[luma].a > max_luma_freq)
-                max_luma_freq = m_plot_values[luma].a;
+    #if defined(SUPPORT_MULTITHREAD_RECORDING)
+    return m_record_readback_depth + m_save_threads.num_threads() * 2;
+    #else
+    return m_record_readback_depth + 1;
+    #endif
+}
+
+void Sandbox::_savePixels(const std::string& _file, int _width, int _height, Pixels&& _pixels, bool _half) {
+    #if defined(SUPPORT_MULTITHREAD_RECORDING)
+
+    /** The pixels live on a slab of the record pool. If we render faster than we can save frames
+     * the pool runs out of slabs and the capture waits for the saving threads to give one back,
+     * so memory never grows beyond the pool size while all the cpu cores are used to save. **/
+    std::shared_ptr<Job> saverPtr = std::make_shared<Job>(_file, _width, _height, std::move(_pixels), m_task_count, _half, &uniforms.tracker);
+    auto func = [saverPtr]() {
+        Job& saver = *saverPtr;
+        saver();
+    };
+    m_save_threads.Submit(std::move(func));
+
+    #else
+
+    TrackerScope track(&uniforms.tracker, "save");
+    if (_half)
+        savePixelsHalf(_file, (const uint16_t*)_pixels.get(), _width, _height);
+    else
+        ada::savePixels(_file, _pixels.get(), _width, _height);
+
+    #endif
+}
+
+void Sandbox::_accountMemory(GpuAllocations& _list) {
+    for (size_t i = 0; i < uniforms.buffers.size(); i++)
+        addGpuAllocation(_list, "u_buffer" + ada::toString(i), uniforms.buffers[i]);
+
+    for (size_t i = 0; i < uniforms.doubleBuffers.size(); i++) {
+        addGpuAllocation(_list, "u_doubleBuffer" + ada::toString(i), uniforms.doubleBuffers[i][0]);
+        addGpuAllocation(_list, "u_doubleBuffer" + ada::toString(i), uniforms.doubleBuffers[i][1]);
+    }
+
+    // the levels of a pyramid are not exposed, each one has a float target to go down and another to come back up
+    for (size_t i = 0; i < uniforms.convolution_pyramids.size(); i++) {
+        std::string owner = "u_convolutionPyramid" + ada::toString(i);
+        if (i < m_convolution_pyramid_fbos.size())
+            addGpuAllocation(_list, owner, m_convolution_pyramid_fbos[i]);
+
+        int width = uniforms.convolution_pyramids[i].getWidth();
+        int height = uniforms.convolution_pyramids[i].getHeight();
+        for (size_t l = 0; l < uniforms.convolution_pyramids[i].getDepth(); l++)
+            addGpuAllocation(_list, owner, "fbo", "rgba32f", std::max(1, width >> l), std::max(1, height >> l), 16, 2);
+    }
+
+    addGpuAllocation(_list, "u_scene", m_scene_fbo);
+    addGpuAllocation(_list, "record", m_record_fbo);
+    if (m_record_depth)
+        addGpuAllocation(_list, "record", "fbo", "depth16", m_record_fbo.getWidth(), m_record_fbo.getHeight(), 2);
+    m_record_yuv.accountMemory(_list, "record:yuv");
+    std::string readbackFormat = (m_record_readback.getChannels() == 3) ? "rgb" : "rgba";
+    if (m_record_readback.getType() == GL_UNSIGNED_BYTE)
+        readbackFormat += "8";
+    else
+        readbackFormat += (m_record_readback.getType() == GL_FLOAT) ? "32f" : "16f";
+    // the ring stays allocated after a recording or a screenshot, until the size or format changes
+    addGpuAllocation(_list, "record", "readback", readbackFormat,
+                    m_record_readback.getWidth(), m_record_readback.getHeight(), m_record_readback.getBytesPerPixel(), m_record_readback.getDepth());
+
+    for (size_t i = 0; i < uniforms.lights.size(); i++)
+        if (uniforms.lights[i].getShadowMap())
+            addGpuAllocation(_list, "u_lightShadowMap" + (i > 0 ? ada::toString(i) : ""), *uniforms.lights[i].getShadowMap());
+
+    for (TextureList::iterator it = uniforms.textures.begin(); it != uniforms.textures.end(); ++it) {
+        if (it->second == m_plot_texture)
+            continue;
+
+        StreamsList::iterator stream = uniforms.streams.find(it->first);
+        if (stream == uniforms.streams.end())
+            addGpuAllocation(_list, it->first, "texture", it->second);
+        else {
+            addGpuAllocation(_list, it->first, "stream", it->second);
+            addGpuAllocation(_list, it->first + "Prev", "stream", "rgba8", it->second->getWidth(), it->second->getHeight(), 4, stream->second->getPrevTexturesTotal());
         }
-        delete[] pixels;
+    }
+
+    if (uniforms.cubemap)
+        addGpuAllocation(_list, "u_cubeMap", "texture", "rgba8", uniforms.cubemap->getWidth(), uniforms.cubemap->getHeight(), 4, 6);
 
-        // Normalize frequencies
-        for (int i = 0; i < 256; i ++)
-            m_plot_values[i] = m_plot_values[i] / glm::vec4(max_rgb_freq, max_rgb_freq, max_rgb_freq, max_luma_freq);
+    if (m_plot_texture)
+        addGpuAllocation(_list, "plot", "texture", "rgba32f", m_plot_texture->getWidth(), m_plot_texture->getHeight(), 16);
 
-        if (m_plot_texture == nullptr)
-            m_plot_texture = new ada::Texture();
-        m_plot_texture->load(256, 1, 4, 32, &m_plot_values[0], ada::NEAREST, ada::CLAMP);
+    if (m_tiles_texture)
+        addGpuAllocation(_list, "tiles", "texture", "rgba32f", m_tiles_texture->getWidth(), m_tiles_texture->getHeight(), 16);
+
+    m_plot_histogram.accountMemory(_list, "plot:histogram");
+}
+
+void Sandbox::onPlot(bool _change) {
+    if ( !ada::isGL() )
+        return;
+
+    if ( (m_plot == PLOT_LUMA || m_plot == PLOT_RGB || m_plot == PLOT_RED || m_plot == PLOT_GREEN || m_plot == PLOT_BLUE ) && !_change ) {
+        // Same image as the last one counted, deliver what is still on its way
+        m_plot_histogram.flush();
+    }
+
+    else if ( m_plot == PLOT_LUMA || m_plot == PLOT_RGB || m_plot == PLOT_RED || m_plot == PLOT_GREEN || m_plot == PLOT_BLUE ) {
+
+        // TRACK_BEGIN("plot::histogram")
+
+        // The bins arrive a couple of frames later, they replace all the previous values
+        m_plot_histogram.compute(m_scene_fbo, [this](const float* _bins) {
+            bool change = memcmp(&m_plot_values[0], _bins, sizeof(m_plot_values)) != 0;
+            memcpy(&m_plot_values[0], _bins, sizeof(m_plot_values));
+
+            _updatePlotTexture();
+
+            uniforms.textures["u_histogram"] = m_plot_texture;
+
+            // a histogram that didn't change doesn't need another frame
+            if (change)
+                uniforms.flagChange();
+        });
 
-        uniforms.textures["u_histogram"] = m_plot_texture;
-        uniforms.flagChange();
         // TRACK_END("plot::histogram")
     }
 
@@ -2046,10 +2832,7 @@ void Sandbox::onPlot() {
 
         // TRACK_BEGIN("plot::fps")
 
-        if (m_plot_texture == nullptr)
-            m_plot_texture = new ada::Texture();
-
-        m_plot_texture->load(256, 1, 4, 32, &m_plot_values[0], ada::NEAREST, ada::CLAMP);
+        _updatePlotTexture();
         // uniforms.textures["u_sceneFps"] = m_plot_texture;
 
         // TRACK_END("plot::fps")
@@ -2063,13 +2846,20 @@ void Sandbox::onPlot() {
 
         // TRACK_BEGIN("plot::ms")
 
-        if (m_plot_texture == nullptr)
-            m_plot_texture = new ada::Texture();
-
-        m_plot_texture->load(256, 1, 4, 32, &m_plot_values[0], ada::NEAREST, ada::CLAMP);
+        _updatePlotTexture();
 
         // uniforms.textures["u_sceneMs"] = m_plot_texture;
 
         // TRACK_END("plot::ms")
     }
 }
+
+void Sandbox::_updatePlotTexture() {
+    bool created = m_plot_texture == nullptr;
+    if (created)
+        m_plot_texture = new ada::Texture();
+    m_plot_texture->load(256, 1, 4, 32, &m_plot_values[0], ada::NEAREST, ada::CLAMP);
+
+    if (created)
+        _updateMemory();
+}
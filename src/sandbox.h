@@ -7,6 +7,13 @@
 
 #include "scene.h"
 #include "types/files.h"
+#include "tools/readback.h"
+#include "tools/gpuMemory.h"
+#include "tools/tileProfiler.h"
+#include "tools/histogram.h"
+#include "tools/yuv420.h"
+#include "tools/includeGraph.h"
+#include "tools/shaderCompiler.h"
 #include "ada/string.h"
 
 enum ShaderType {
@@ -51,25 +58,35 @@ public:
     // Getting some data out of Sandbox
     const std::string&  getSource( ShaderType _type ) const;
     Scene&              getScene() { return m_scene; }
+    size_t              getFrame() const { return m_frame; }
+    float               getTime() const;    // u_time of the next frame
 
     void                printDependencies( ShaderType _type ) const;
     
     // Some events
     void                onScroll( float _yoffset );
     void                onMouseDrag( float _x, float _y, int _button );
+    void                onMouseDrag( float _x, float _y, float _velX, float _velY, int _button );
     void                onViewportResize( int _newWidth, int _newHeight );
     void                onFileChange( WatchFileList &_files, int _index );
     void                onScreenshot( std::string _file );
-    void                onPlot();
+    void                onPlot(bool _change = true);
+
+    // Programs compiling in the background after a file change, swapped in by updateCompile() once ready
+    bool                isCompiling() const { return m_compiler.isCompiling(); }
+    void                updateCompile( WatchFileList &_files );
    
-    // Include folders
+    // Include folders, and the files read from them and the shaders
     ada::StringList     include_folders;
+    IncludeGraph        includes;
 
     // Uniforms
     Uniforms            uniforms;
 
-    // Screenshot file
+    // Screenshot file, and size when it's different from the window (rendered in tiles)
     std::string         screenshotFile;
+    int                 screenshotWidth;
+    int                 screenshotHeight;
 
     // States
     int                 frag_index;
@@ -87,25 +104,49 @@ private:
     void                _updateSceneBuffer(int _width, int _height);
     void                _updateBuffers();
     void                _renderBuffers();
+    void                _renderRecordYUV(int _matrix, bool _fullRange);
+    void                _renderTiledScreenshot(const std::string& _file, int _width, int _height);
+    size_t              _getPoolSlabs() const;
+    bool                _isRecordHDR() const;
+    void                _allocateRecordFbo(int _width, int _height, bool _hdr);
+    void                _savePixels(const std::string& _file, int _width, int _height, Pixels&& _pixels, bool _half = false);
+    void                _accountMemory(GpuAllocations& _list);
+    void                _updateMemory();
+    void                _updatePlotTexture();
+    bool                _compileInBackground();
+    void                _applyCompiled(WatchFileList &_files);
 
     // Main Shader
     std::string         m_frag_source;
     std::string         m_vert_source;
+    ShaderMetadata      m_frag_metadata;
+    ShaderMetadata      m_vert_metadata;
 
     // Dependencies
     ada::StringList     m_vert_dependencies;
     ada::StringList     m_frag_dependencies;
 
+    // Background compiles, and the sources and dependencies they are from, applied once they are done
+    ShaderCompiler      m_compiler;
+    bool                m_compile_background;
+    std::string         m_compile_frag_source;
+    std::string         m_compile_vert_source;
+    ada::StringList     m_compile_frag_dependencies;
+    ada::StringList     m_compile_vert_dependencies;
+
     // Buffers
     std::vector<ada::Shader>    m_buffers_shaders;
     int                         m_buffers_total;
+    std::vector<size_t>         m_buffers_track;
 
     // Buffers
     std::vector<ada::Shader>    m_doubleBuffers_shaders;
     int                         m_doubleBuffers_total;
+    std::vector<size_t>         m_doubleBuffers_track;
 
     // A. CANVAS
     ada::Shader         m_canvas_shader;
+    ada::Shader         m_canvas_tiled_shader;  // with gl_FragCoord offset by the tile, for screenshots bigger than the window
 
     // B. SCENE
     Scene               m_scene;
@@ -116,6 +157,7 @@ private:
     std::vector<ada::Shader>    m_convolution_pyramid_subshaders;
     ada::Shader                 m_convolution_pyramid_shader;
     int                         m_convolution_pyramid_total;
+    std::vector<size_t>         m_convolution_pyramid_track;
 
     // Postprocessing
     ada::Shader         m_postprocessing_shader;
@@ -133,14 +175,28 @@ private:
     ada::Texture*       m_plot_texture;
     glm::vec4           m_plot_values[256];
     PlotType            m_plot;
+    Histogram           m_plot_histogram;
+
+    // cost of each tile of the canvas or a buffer, shown as a heatmap over it
+    TileProfiler        m_tiles;
+    ada::Shader         m_tiles_shader;
+    ada::Texture*       m_tiles_texture;
 
     // Recording
     ada::Fbo            m_record_fbo;
+    GLuint              m_record_depth;     // depth of m_record_fbo when it's a float target, for hdr and exr captures
+    Yuv420              m_record_yuv;
+    Readback            m_record_readback;
+    size_t              m_record_readback_depth;
+    size_t              m_record_pool_slabs;
     #if defined(SUPPORT_MULTITHREAD_RECORDING)
     std::atomic<int>        m_task_count {0};
-    std::atomic<long long>  m_max_mem_in_queue {0};
     thread_pool::ThreadPool m_save_threads;
     #endif
+    glm::vec2           m_tile_resolution;
+
+    // Estimated video memory, refreshed every frame while tracking
+    GpuMemory           m_memory;
 
     // Other state properties
     glm::mat3           m_view2d;
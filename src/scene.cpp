@@ -25,8 +25,10 @@
 
 #include "tools/text.h"
 
-#define TRACK_BEGIN(A) if (_uniforms.tracker.isRunning()) _uniforms.tracker.begin(A); 
-#define TRACK_END(A) if (_uniforms.tracker.isRunning()) _uniforms.tracker.end(A); 
+#define TRACK_BEGIN(A) if (_uniforms.tracker.isRunning()) { static const size_t track_id = _uniforms.tracker.getId(A); _uniforms.tracker.begin(track_id); }
+#define TRACK_END(A) if (_uniforms.tracker.isRunning()) { static const size_t track_id = _uniforms.tracker.getId(A); _uniforms.tracker.end(track_id); }
+#define TRACK_BEGIN_ID(A) if (_uniforms.tracker.isRunning()) _uniforms.tracker.begin(A);
+#define TRACK_END_ID(A) if (_uniforms.tracker.isRunning()) _uniforms.tracker.end(A);
 
 Scene::Scene(): 
     // Debug State
@@ -55,6 +57,7 @@ void Scene::clear() {
         delete m_models[i];
 
     m_models.clear();
+    m_models_track.clear();
 
     if (m_lightUI_vbo) {
         delete m_lightUI_vbo;
@@ -530,28 +533,34 @@ bool Scene::loadGeometry(Uniforms& _uniforms, WatchFileList& _files, int _index,
     return true;
 }
 
-bool Scene::loadShaders(const std::string& _fragmentShader, const std::string& _vertexShader, bool _verbose) {
+bool Scene::loadShaders(Uniforms& _uniforms, const std::string& _fragmentShader, const std::string& _vertexShader,
+                        const ShaderMetadata& _fragmentMetadata, const ShaderMetadata& _vertexMetadata, bool _verbose) {
     bool rta = true;
-    for (size_t i = 0; i < m_models.size(); i++)
-        if ( !m_models[i]->loadShader( _fragmentShader, _vertexShader, _verbose) )
+    for (size_t i = 0; i < m_models.size(); i++) {
+        // models add the defines of their material and compile it themselves
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok = m_models[i]->loadShader( _fragmentShader, _vertexShader, _verbose);
+        double ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() * 0.001;
+        _uniforms.shaderStats.add("model:" + m_models[i]->getName(), "", _fragmentShader, _vertexShader, ms, ok);
+        if ( !ok )
             rta = false;
+    }
 
-
-    m_background = checkBackground(_fragmentShader);
+    m_background = _fragmentMetadata.background;
     if (m_background) {
         // Specific defines for this buffer
         m_background_shader.addDefine("BACKGROUND");
-        m_background_shader.load(_fragmentShader, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+        _uniforms.shaderStats.load(m_background_shader, "background", "BACKGROUND", _fragmentShader, ada::getDefaultSrc(ada::VERT_BILLBOARD));
     }
 
-    bool thereIsFloorDefine = checkFloor(_fragmentShader) || checkFloor(_vertexShader);
+    bool thereIsFloorDefine = _fragmentMetadata.floor || _vertexMetadata.floor;
     if (thereIsFloorDefine) {
-        m_floor_shader.load(_fragmentShader, _vertexShader, false);
+        _uniforms.shaderStats.load(m_floor_shader, "floor", "FLOOR", _fragmentShader, _vertexShader);
         if (m_floor_subd == -1)
             m_floor_subd_target = 0;
     }
 
-    m_shadows = findId(_fragmentShader, "u_lightShadowMap;");
+    m_shadows = _fragmentMetadata.isDeclared("u_lightShadowMap");
 
     return rta;
 }
@@ -589,11 +598,17 @@ void Scene::render(Uniforms& _uniforms) {
 
     ada::cullingMode(m_culling);
 
+    if (m_models_track.size() != m_models.size()) {
+        m_models_track.resize(m_models.size());
+        for (size_t i = 0; i < m_models.size(); i++)
+            m_models_track[i] = _uniforms.tracker.getId("render:scene:" + m_models[i]->getName());
+    }
+
     for (size_t i = 0; i < m_models.size(); i++) {
 
         if (m_models[i]->getShader()->isLoaded() ) {
 
-            TRACK_BEGIN("render:scene:" + m_models[i]->getName() )
+            TRACK_BEGIN_ID( m_models_track[i] )
 
             // bind the shader
             m_models[i]->getShader()->use();
@@ -605,7 +620,7 @@ void Scene::render(Uniforms& _uniforms) {
             m_models[i]->getShader()->setUniform( "u_modelViewProjectionMatrix", ada::getProjectionViewWorldMatrix() );
             m_models[i]->render();
 
-            TRACK_END("render:scene:" + m_models[i]->getName() )
+            TRACK_END_ID( m_models_track[i] )
         }
     }
 
@@ -722,7 +737,7 @@ void Scene::renderFloor(Uniforms& _uniforms, const glm::mat4& _mvp, bool _lights
             m_floor_subd = m_floor_subd_target;
 
             if (!m_floor_shader.isLoaded()) 
-                m_floor_shader.load(ada::getDefaultSrc(ada::FRAG_DEFAULT_SCENE), ada::getDefaultSrc(ada::VERT_DEFAULT_SCENE), false);
+                _uniforms.shaderStats.load(m_floor_shader, "floor:default", "", ada::getDefaultSrc(ada::FRAG_DEFAULT_SCENE), ada::getDefaultSrc(ada::VERT_DEFAULT_SCENE));
 
             m_floor_shader.addDefine("FLOOR");
             m_floor_shader.addDefine("FLOOR_SUBD", m_floor_subd);
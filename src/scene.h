@@ -20,7 +20,8 @@ public:
     void            clear();
 
     bool            loadGeometry(Uniforms& _uniforms, WatchFileList& _files, int _index, bool _verbose);
-    bool            loadShaders(const std::string& _fragmentShader, const std::string& _vertexShader, bool _verbose);
+    bool            loadShaders(Uniforms& _uniforms, const std::string& _fragmentShader, const std::string& _vertexShader,
+                                const ShaderMetadata& _fragmentMetadata, const ShaderMetadata& _vertexMetadata, bool _verbose);
 
     void            addDefine(const std::string& _define, const std::string& _value);
     void            delDefine(const std::string& _define);
@@ -57,6 +58,7 @@ public:
 protected:
      // Geometry
     std::vector<ada::Model*>             m_models;
+    std::vector<size_t>                  m_models_track;
     std::map<std::string,ada::Material>  m_materials;
 
     ada::Node           m_origin;
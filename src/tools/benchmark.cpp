@@ -0,0 +1,422 @@
+#include "benchmark.h"
+
+#include <sys/stat.h>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#ifndef PLATFORM_WINDOWS
+#include <dirent.h>
+#include <sys/resource.h>
+#endif
+
+#include "ada/fs.h"
+#include "ada/string.h"
+#include "ada/window.h"
+
+#include "tinygltf/json.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Tracks faster than this jitter too much from run to run to be compared against a baseline
+const double BENCHMARK_MIN_MS = 0.05;
+
+#if defined(PLATFORM_WINDOWS)
+const std::string BENCHMARK_NULL_INPUT = " < NUL";
+#else
+const std::string BENCHMARK_NULL_INPUT = " < /dev/null";
+#endif
+
+double msBetween(const StatPoint& _start, const StatPoint& _end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(_end - _start).count() * 0.001;
+}
+
+// In KB, or -1 where it's not known
+long peakRssKb() {
+    #if defined(PLATFORM_WINDOWS)
+    return -1;
+    #else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    #if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;     // bytes on macOS
+    #else
+    return usage.ru_maxrss;
+    #endif
+
+    #endif
+}
+
+bool isDirectory(const std::string& _path) {
+    struct stat st;
+    return stat(_path.c_str(), &st) == 0 && (st.st_mode & S_IFDIR);
+}
+
+bool isModel(const std::string& _path) {
+    std::string ext = ada::toLower( ada::getExt(_path) );
+    return ext == "ply" || ext == "obj" || ext == "stl" || ext == "glb" || ext == "gltf";
+}
+
+// Sorted files of a folder, plus the ones of its subfolders when _recursive
+void listFiles(const std::string& _folder, bool _recursive, std::vector<std::string>& _files) {
+    #if defined(PLATFORM_WINDOWS)
+    std::cerr << "Benchmark: can't list " << _folder << " on this platform, list its shaders one by one" << std::endl;
+    #else
+    DIR* dir = opendir(_folder.c_str());
+    if (!dir)
+        return;
+
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir))
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    for (size_t i = 0; i < names.size(); i++) {
+        std::string path = _folder + "/" + names[i];
+        if (!isDirectory(path))
+            _files.push_back(path);
+        else if (_recursive)
+            listFiles(path, true, _files);
+    }
+    #endif
+}
+
+struct BenchmarkEntry {
+    std::string                 name;
+    std::vector<std::string>    args;
+};
+
+void addEntries(const json& _entry, std::vector<BenchmarkEntry>& _entries) {
+    if (_entry.is_object()) {
+        BenchmarkEntry entry;
+        entry.name = _entry.value("name", std::string(""));
+        if (_entry.count("args") && _entry["args"].is_array())
+            for (size_t i = 0; i < _entry["args"].size(); i++)
+                entry.args.push_back(_entry["args"][i].get<std::string>());
+        if (entry.name.empty() && !entry.args.empty())
+            entry.name = entry.args[0];
+        _entries.push_back(entry);
+    }
+    else if (_entry.is_string() && isDirectory(_entry.get<std::string>())) {
+        std::vector<std::string> files;
+        listFiles(_entry.get<std::string>(), true, files);
+
+        for (size_t i = 0; i < files.size(); i++) {
+            if (ada::toLower( ada::getExt(files[i]) ) != "frag")
+                continue;
+
+            BenchmarkEntry entry;
+            entry.name = files[i];
+            entry.args.push_back(files[i]);
+
+            // 3D shaders need a model, use the first one next to them
+            std::vector<std::string> siblings;
+            listFiles(files[i].substr(0, files[i].find_last_of('/')), false, siblings);
+            for (size_t j = 0; j < siblings.size(); j++)
+                if (isModel(siblings[j])) {
+                    entry.args.push_back(siblings[j]);
+                    break;
+                }
+
+            _entries.push_back(entry);
+        }
+    }
+    else if (_entry.is_string()) {
+        BenchmarkEntry entry;
+        entry.name = _entry.get<std::string>();
+        entry.args.push_back(entry.name);
+        _entries.push_back(entry);
+    }
+}
+
+void setSoftwareGL() {
+    #if defined(PLATFORM_WINDOWS)
+    _putenv_s("LIBGL_ALWAYS_SOFTWARE", "1");
+    _putenv_s("GALLIUM_DRIVER", "llvmpipe");
+    #else
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+    #endif
+}
+
+std::string quote(const std::string& _arg) {
+    return "\"" + _arg + "\"";
+}
+
+// Compares _metric of _current against _baseline, adding a regression when it got slower than _threshold %
+void compare(   const json& _run, const std::string& _track, const std::string& _metric,
+                const json& _current, const json& _baseline, double _threshold, json& _regressions) {
+    if (!_current.count(_metric) || !_baseline.count(_metric) ||
+        !_current[_metric].is_number() || !_baseline[_metric].is_number())
+        return;
+
+    double current = _current[_metric].get<double>();
+    double baseline = _baseline[_metric].get<double>();
+    if (baseline < BENCHMARK_MIN_MS || current <= baseline * (1.0 + _threshold * 0.01))
+        return;
+
+    json regression;
+    regression["name"] = _run["name"];
+    regression["width"] = _run["width"];
+    regression["height"] = _run["height"];
+    regression["track"] = _track;
+    regression["metric"] = _metric;
+    regression["baseline"] = baseline;
+    regression["current"] = current;
+    regression["percent"] = (current / baseline - 1.0) * 100.0;
+    _regressions.push_back(regression);
+
+    std::cerr   << "Regression: " << _run["name"].get<std::string>() << " at " << _run["width"].get<int>() << "x" << _run["height"].get<int>()
+                << " " << _track << " " << _metric << " " << baseline << "ms -> " << current << "ms" << std::endl;
+}
+
+}
+
+bool benchmarkRunParse(const std::string& _args, BenchmarkRun& _run) {
+    std::vector<std::string> values = ada::split(_args, ',');
+    if (values.size() != 3)
+        return false;
+
+    // the first frame pays for the lazy parts of shader compilation, it's never measured
+    _run.warmup = std::max(1, ada::toInt(values[0]));
+    _run.frames = std::max(1, ada::toInt(values[1]));
+    _run.file = values[2];
+    return true;
+}
+
+bool benchmarkRunFrame(BenchmarkRun& _run, Tracker& _tracker, int _width, int _height) {
+    _run.frame++;
+
+    StatPoint now = std::chrono::high_resolution_clock::now();
+    if (_run.frame == 1)
+        _run.firstFrameMs = msBetween(_run.setupEnd, now);
+
+    if (_run.frame == _run.warmup)
+        _tracker.start();
+
+    if (_run.frame < _run.warmup + _run.frames)
+        return false;
+
+    _tracker.stop();
+
+    json run;
+    run["width"] = _width;
+    run["height"] = _height;
+    run["warmup"] = _run.warmup;
+    run["frames"] = _run.frames;
+    run["startupMs"] = msBetween(_run.start, _run.setupEnd) + _run.firstFrameMs;
+    run["setupMs"] = msBetween(_run.setupStart, _run.setupEnd);
+    run["firstFrameMs"] = _run.firstFrameMs;
+    if (_run.programCache) {
+        run["programCache"]["hits"] = _run.programCacheHits;
+        run["programCache"]["misses"] = _run.programCacheMisses;
+    }
+    else
+        run["programCache"] = nullptr;
+    long rss = peakRssKb();
+    if (rss >= 0)
+        run["peakRssKb"] = rss;
+    else
+        run["peakRssKb"] = nullptr;
+    run["vendor"] = ada::getVendor();
+    run["renderer"] = ada::getRenderer();
+    run["glVersion"] = ada::getGLVersion();
+    run["tracks"] = json::object();
+
+    std::vector<std::string> tracks = _tracker.getTracks();
+    for (size_t i = 0; i < tracks.size(); i++) {
+        StatHistogram hist;
+        double gpu = -1.0;
+        size_t overBudget = 0;
+        if (!_tracker.getStats(tracks[i], hist, gpu, overBudget))
+            continue;
+
+        json track;
+        track["count"] = hist.count;
+        track["cpuMeanMs"] = hist.mean;
+        track["cpuStddevMs"] = hist.stddev();
+        track["cpuMinMs"] = hist.min;
+        track["cpuP50Ms"] = hist.percentile(50.0);
+        track["cpuP90Ms"] = hist.percentile(90.0);
+        track["cpuP99Ms"] = hist.percentile(99.0);
+        track["cpuMaxMs"] = hist.max;
+        if (gpu >= 0.0)
+            track["gpuMeanMs"] = gpu;
+        else
+            track["gpuMeanMs"] = nullptr;
+        track["overBudget"] = overBudget;
+        run["tracks"][tracks[i]] = track;
+    }
+
+    std::ofstream out(_run.file);
+    out << run.dump(4) << std::endl;
+    if (!out.good())
+        std::cerr << "Benchmark: can't write " << _run.file << std::endl;
+
+    return true;
+}
+
+int benchmarkSuite(const std::string& _manifest, const std::string& _executable) {
+    std::ifstream in(_manifest);
+    if (!in.is_open()) {
+        std::cerr << "Benchmark: can't open " << _manifest << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    json manifest = json::parse(in, nullptr, false);
+    if (manifest.is_discarded() || !manifest.is_object()) {
+        std::cerr << "Benchmark: " << _manifest << " is not a JSON object" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int warmup = manifest.value("warmup", 30);
+    int frames = manifest.value("frames", 120);
+    double threshold = manifest.value("threshold", 10.0);
+    std::string output = manifest.value("output", std::string("benchmark.json"));
+    std::string baselineFile = manifest.value("baseline", std::string(""));
+    std::string shaderCache = manifest.value("shaderCache", std::string(""));
+
+    std::vector< std::pair<int, int> > resolutions;
+    if (manifest.count("resolutions") && manifest["resolutions"].is_array())
+        for (size_t i = 0; i < manifest["resolutions"].size(); i++) {
+            const json& res = manifest["resolutions"][i];
+            if (res.is_array() && res.size() == 2)
+                resolutions.push_back( std::make_pair(res[0].get<int>(), res[1].get<int>()) );
+        }
+    if (resolutions.empty())
+        resolutions.push_back( std::make_pair(512, 512) );
+
+    std::vector<BenchmarkEntry> entries;
+    if (manifest.count("entries") && manifest["entries"].is_array())
+        for (size_t i = 0; i < manifest["entries"].size(); i++)
+            addEntries(manifest["entries"][i], entries);
+
+    if (entries.empty()) {
+        std::cerr << "Benchmark: " << _manifest << " has no entries" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (manifest.value("software", false))
+        setSoftwareGL();
+
+    json results;
+    results["manifest"] = _manifest;
+    results["warmup"] = warmup;
+    results["frames"] = frames;
+    results["threshold"] = threshold;
+    results["runs"] = json::array();
+
+    int failed = 0;
+    std::string runFile = output + ".run.json";
+    for (size_t e = 0; e < entries.size(); e++) {
+        for (size_t r = 0; r < resolutions.size(); r++) {
+            int width = resolutions[r].first;
+            int height = resolutions[r].second;
+
+            std::string cmd = quote(_executable) + " --headless --noncurses" +
+                                " -w " + ada::toString(width) + " -h " + ada::toString(height);
+            for (size_t a = 0; a < entries[e].args.size(); a++)
+                cmd += " " + quote(entries[e].args[a]);
+            if (!shaderCache.empty())
+                cmd += " --shader-cache " + quote(shaderCache);
+            cmd += " --benchmark-run " + ada::toString(warmup) + "," + ada::toString(frames) + "," + quote(runFile);
+            cmd += BENCHMARK_NULL_INPUT;
+
+            std::cout << "// Benchmark " << entries[e].name << " at " << width << "x" << height << std::endl;
+
+            std::remove(runFile.c_str());
+            int status = std::system(cmd.c_str());
+
+            json run;
+            std::ifstream runIn(runFile);
+            if (runIn.is_open())
+                run = json::parse(runIn, nullptr, false);
+            runIn.close();
+            std::remove(runFile.c_str());
+
+            if (status != 0 || !run.is_object()) {
+                run = json::object();
+                run["status"] = "failed";
+                run["exitCode"] = status;
+                failed++;
+                std::cerr << "Benchmark: " << entries[e].name << " at " << width << "x" << height << " failed" << std::endl;
+            }
+            else
+                run["status"] = "ok";
+
+            run["name"] = entries[e].name;
+            run["args"] = entries[e].args;
+            run["width"] = width;
+            run["height"] = height;
+            results["runs"].push_back(run);
+
+            if (run["status"] == "ok" && run["tracks"].count("render")) {
+                const json& render = run["tracks"]["render"];
+                std::cout   << "//  startup " << run["startupMs"].get<double>() << "ms"
+                            << (run["programCache"].is_object() ? " (" + ada::toString(run["programCache"]["hits"].get<size_t>()) + " cached programs)" : std::string(""))
+                            << ", render p50 " << render["cpuP50Ms"].get<double>() << "ms"
+                            << ", p99 " << render["cpuP99Ms"].get<double>() << "ms";
+                if (render["gpuMeanMs"].is_number())
+                    std::cout << ", gpu " << render["gpuMeanMs"].get<double>() << "ms";
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    // Gate against a previous run, matching runs by name and resolution
+    json regressions = json::array();
+    if (!baselineFile.empty()) {
+        std::ifstream baseIn(baselineFile);
+        json baseline = baseIn.is_open() ? json::parse(baseIn, nullptr, false) : json();
+
+        if (!baseline.is_object() || !baseline.count("runs"))
+            std::cerr << "Benchmark: no baseline on " << baselineFile << ", nothing to compare against" << std::endl;
+        else {
+            const json& runs = results["runs"];
+            for (size_t i = 0; i < runs.size(); i++) {
+                if (runs[i]["status"] != "ok")
+                    continue;
+
+                for (size_t j = 0; j < baseline["runs"].size(); j++) {
+                    const json& base = baseline["runs"][j];
+                    if (base.value("status", std::string("")) != "ok" ||
+                        base["name"] != runs[i]["name"] || base["width"] != runs[i]["width"] || base["height"] != runs[i]["height"])
+                        continue;
+
+                    compare(runs[i], "startup", "setupMs", runs[i], base, threshold, regressions);
+
+                    const json& tracks = base["tracks"];
+                    for (json::const_iterator it = tracks.begin(); it != tracks.end(); ++it) {
+                        if (!runs[i]["tracks"].count(it.key()))
+                            continue;
+                        const json& current = runs[i]["tracks"][it.key()];
+                        compare(runs[i], it.key(), "cpuP50Ms", current, it.value(), threshold, regressions);
+                        compare(runs[i], it.key(), "gpuMeanMs", current, it.value(), threshold, regressions);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    results["regressions"] = regressions;
+
+    std::ofstream out(output);
+    out << results.dump(4) << std::endl;
+    out.close();
+    std::cout << "// Benchmark results saved to " << output << std::endl;
+
+    if (failed > 0 || regressions.size() > 0) {
+        std::cerr << "Benchmark: " << failed << " failed runs and " << regressions.size() << " regressions" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+
+#include "tracker.h"
+
+// A single headless run (--benchmark-run <warmup>,<frames>,<file.json>): renders <warmup> frames,
+// then <frames> more with the tracker on, and saves their stats as JSON
+struct BenchmarkRun {
+    int         warmup      = 30;
+    int         frames      = 120;
+    std::string file        = "";
+
+    int         frame       = 0;    // frames rendered so far
+    StatPoint   start;              // when the process started
+    StatPoint   setupStart;
+    StatPoint   setupEnd;
+    double      firstFrameMs = 0.0;
+
+    bool        programCache = false;   // --shader-cache was on, and how many programs of the setup came from it
+    size_t      programCacheHits = 0;
+    size_t      programCacheMisses = 0;
+
+    bool        isActive() const { return !file.empty(); }
+};
+
+bool    benchmarkRunParse(const std::string& _args, BenchmarkRun& _run);
+
+// Call after every frame, returns true once the run is over and its results were saved
+bool    benchmarkRunFrame(BenchmarkRun& _run, Tracker& _tracker, int _width, int _height);
+
+/** Runs every entry of a JSON manifest at every resolution, each on its own headless process of
+ *  _executable, and saves the results as JSON. Returns non zero if a run failed or, when there is
+ *  a baseline (the output of a previous run), if a metric got more than threshold % slower.
+ *  "software" forces Mesa's llvmpipe, for machines without a GPU. A directory entry stands for
+ *  every .frag under it, each with the models of its folder. With "shaderCache" every run keeps
+ *  its programs on that folder: running the same manifest twice gives the cold and the warm startup.
+ *
+ *  {   "resolutions": [[512, 512], [1920, 1080]], "warmup": 30, "frames": 120,
+ *      "threshold": 10, "software": true, "shaderCache": ".cache", "output": "benchmark.json", "baseline": "baseline.json",
+ *      "entries": [    "examples/2D",
+ *                      "examples/2D/00_tests/test.frag",
+ *                      { "name": "head", "args": ["examples/3D/00_pipeline/00_background.frag", "examples/3D/00_pipeline/head.ply"] } ] }
+ **/
+int     benchmarkSuite(const std::string& _manifest, const std::string& _executable);
@@ -0,0 +1,99 @@
+#include "gpuMemory.h"
+
+#include <map>
+#include <algorithm>
+
+#include "ada/string.h"
+
+void addGpuAllocation(  GpuAllocations& _list, const std::string& _owner, const std::string& _kind, const std::string& _format,
+                        int _width, int _height, size_t _bytesPerPixel, size_t _count) {
+    if (_width <= 0 || _height <= 0 || _count == 0)
+        return;
+
+    GpuAllocation allocation;
+    allocation.owner = _owner;
+    allocation.kind = _kind;
+    allocation.format = _format;
+    allocation.width = _width;
+    allocation.height = _height;
+    allocation.count = _count;
+    allocation.bytes = (size_t)_width * _height * _bytesPerPixel * _count;
+    _list.push_back(allocation);
+}
+
+void addGpuAllocation(GpuAllocations& _list, const std::string& _owner, const ada::Fbo& _fbo) {
+    if (!_fbo.isAllocated())
+        return;
+
+    // Float targets are asked as RGBA32F and depth as 24 bits, which drivers pad to 32
+    ada::FboType type = _fbo.getType();
+    if (type == ada::COLOR_FLOAT_TEXTURE)
+        addGpuAllocation(_list, _owner, "fbo", "rgba32f", _fbo.getWidth(), _fbo.getHeight(), 16);
+    else if (type == ada::COLOR_TEXTURE_DEPTH_BUFFER || type == ada::COLOR_DEPTH_TEXTURES)
+        addGpuAllocation(_list, _owner, "fbo", "rgba8+depth24", _fbo.getWidth(), _fbo.getHeight(), 8);
+    else if (type == ada::COLOR_TEXTURE)
+        addGpuAllocation(_list, _owner, "fbo", "rgba8", _fbo.getWidth(), _fbo.getHeight(), 4);
+    else
+        addGpuAllocation(_list, _owner, "fbo", "depth24", _fbo.getWidth(), _fbo.getHeight(), 4);
+}
+
+void addGpuAllocation(GpuAllocations& _list, const std::string& _owner, const std::string& _kind, const ada::Texture* _texture) {
+    if (_texture)
+        addGpuAllocation(_list, _owner, _kind, "rgba8", _texture->getWidth(), _texture->getHeight(), 4);
+}
+
+GpuMemory::GpuMemory(): m_total(0), m_peak(0) {
+}
+
+void GpuMemory::set(const GpuAllocations& _allocations) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allocations = _allocations;
+
+    m_total = 0;
+    for (size_t i = 0; i < m_allocations.size(); i++)
+        m_total += m_allocations[i].bytes;
+    m_peak = std::max(m_peak, m_total);
+}
+
+size_t GpuMemory::getTotal() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_total;
+}
+
+size_t GpuMemory::getTotal(const std::string& _kind) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    for (size_t i = 0; i < m_allocations.size(); i++)
+        if (m_allocations[i].kind == _kind)
+            total += m_allocations[i].bytes;
+    return total;
+}
+
+size_t GpuMemory::getPeak() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peak;
+}
+
+std::string GpuMemory::log() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string log = "";
+
+    std::map<std::string, size_t> kinds;
+    for (size_t i = 0; i < m_allocations.size(); i++) {
+        const GpuAllocation& allocation = m_allocations[i];
+        log +=  allocation.owner + "," +
+                allocation.kind + "," +
+                allocation.format + "," +
+                ada::toString(allocation.width) + "x" + ada::toString(allocation.height) + "," +
+                ada::toString(allocation.count) + "," +
+                ada::toString(allocation.bytes) + "\n";
+        kinds[allocation.kind] += allocation.bytes;
+    }
+
+    for (std::map<std::string, size_t>::iterator it = kinds.begin(); it != kinds.end(); ++it)
+        log += "total:" + it->first + "," + ada::toString(it->second) + "\n";
+    log += "total," + ada::toString(m_total) + "\n";
+    log += "peak," + ada::toString(m_peak) + "\n";
+
+    return log;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <string>
+
+#include "ada/gl/fbo.h"
+#include "ada/gl/texture.h"
+
+struct GpuAllocation {
+    std::string owner;      // uniform name, model or pass
+    std::string kind;       // fbo, texture, stream, readback, ...
+    std::string format;
+    int         width;
+    int         height;
+    size_t      count;      // surfaces of that size and format
+    size_t      bytes;
+};
+
+typedef std::vector<GpuAllocation> GpuAllocations;
+
+// ada doesn't keep track of what it allocates, so each surface is measured from its size and the format it was asked for
+void    addGpuAllocation(GpuAllocations& _list, const std::string& _owner, const std::string& _kind, const std::string& _format,
+                        int _width, int _height, size_t _bytesPerPixel, size_t _count = 1);
+void    addGpuAllocation(GpuAllocations& _list, const std::string& _owner, const ada::Fbo& _fbo);
+void    addGpuAllocation(GpuAllocations& _list, const std::string& _owner, const std::string& _kind, const ada::Texture* _texture);
+
+/** Last snapshot of the estimated video memory in use and its high-water mark **/
+class GpuMemory {
+public:
+    GpuMemory();
+
+    void    set(const GpuAllocations& _allocations);
+
+    size_t  getTotal();
+    size_t  getTotal(const std::string& _kind);
+    size_t  getPeak();
+
+    // owner,kind,format,<width>x<height>,count,bytes of every allocation, followed by the totals per kind and the peak
+    std::string log();
+
+protected:
+    std::mutex          m_mutex;
+    GpuAllocations      m_allocations;
+    size_t              m_total;
+    size_t              m_peak;
+};
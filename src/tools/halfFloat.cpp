@@ -0,0 +1,217 @@
+#include "halfFloat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+
+#include "ada/fs.h"
+#include "ada/string.h"
+#include "ada/pixel.h"
+
+#if defined(__F16C__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/** Shifts exponent and mantissa into place and rebias the exponent multiplying by 2^112,
+ *  which also takes care of denormals. Infinites and NaNs get the float exponent forced **/
+inline float halfToFloat(uint16_t _half) {
+    uint32_t expmant = _half & 0x7FFF;
+    uint32_t bits = expmant << 13;
+    float value;
+    memcpy(&value, &bits, 4);
+    value *= 5.192296858534828e+33f;
+
+    memcpy(&bits, &value, 4);
+    if (expmant > 0x7BFF)
+        bits |= 255 << 23;
+    bits |= (uint32_t)(_half & 0x8000) << 16;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+#if !defined(__F16C__) && (defined(__SSE2__) || defined(_M_X64))
+// Same as above on four halfs zero extended to 32 bits
+inline __m128 halfToFloat(__m128i _half) {
+    const __m128i maskNoSign = _mm_set1_epi32(0x7FFF);
+    const __m128  magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    const __m128i wasInfNan = _mm_set1_epi32(0x7BFF);
+    const __m128i expInfNan = _mm_set1_epi32(255 << 23);
+
+    __m128i expmant = _mm_and_si128(maskNoSign, _half);
+    __m128i sign = _mm_slli_epi32(_mm_xor_si128(_half, expmant), 16);
+    __m128  scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), magic);
+    __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, wasInfNan), expInfNan);
+    return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+}
+#endif
+
+// Rounds to the nearest even, what doesn't fit is infinite and what is too small a denormal or zero
+inline uint16_t floatToHalf(float _value) {
+    uint32_t bits;
+    memcpy(&bits, &_value, 4);
+    uint32_t sign = bits & 0x80000000;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= 0x47800000)
+        half = (bits > 0x7F800000) ? 0x7E00 : 0x7C00;
+    else if (bits < 0x38800000) {
+        // adding 0.5 lines up the denormal mantissa on the lowest bits
+        float value;
+        memcpy(&value, &bits, 4);
+        value += 0.5f;
+        memcpy(&bits, &value, 4);
+        half = (uint16_t)(bits - 0x3F000000);
+    }
+    else {
+        uint32_t odd = (bits >> 13) & 1;
+        bits += ((uint32_t)(15 - 127) << 23) + 0xFFF + odd;
+        half = (uint16_t)(bits >> 13);
+    }
+    return half | (uint16_t)(sign >> 16);
+}
+
+void putLE32(std::vector<unsigned char>& _out, uint32_t _value) {
+    for (int i = 0; i < 4; i++)
+        _out.push_back((_value >> (i * 8)) & 0xFF);
+}
+
+void putAttribute(std::vector<unsigned char>& _out, const char* _name, const char* _type, const std::vector<unsigned char>& _value) {
+    _out.insert(_out.end(), _name, _name + strlen(_name) + 1);
+    _out.insert(_out.end(), _type, _type + strlen(_type) + 1);
+    putLE32(_out, _value.size());
+    _out.insert(_out.end(), _value.begin(), _value.end());
+}
+
+/** Uncompressed scanline OpenEXR with four half channels, one line per block. EXR is
+ *  little endian, like every platform this runs on, so halfs go to disk as they are **/
+bool saveEXR(const std::string& _file, const uint16_t* _pixels, int _width, int _height) {
+    FILE* file = fopen(_file.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Can't write " << _file << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> header = { 0x76, 0x2F, 0x31, 0x01, 2, 0, 0, 0 };
+
+    // Channels have to be sorted by name
+    const char* names[4] = { "A", "B", "G", "R" };
+    const int   offsets[4] = { 3, 2, 1, 0 };
+    std::vector<unsigned char> value;
+    for (int c = 0; c < 4; c++) {
+        value.push_back(names[c][0]);
+        value.push_back(0);
+        putLE32(value, 1);      // HALF
+        putLE32(value, 0);      // pLinear and reserved
+        putLE32(value, 1);      // x sampling
+        putLE32(value, 1);      // y sampling
+    }
+    value.push_back(0);
+    putAttribute(header, "channels", "chlist", value);
+
+    value = { 0 };              // NO_COMPRESSION
+    putAttribute(header, "compression", "compression", value);
+
+    value.clear();
+    putLE32(value, 0);
+    putLE32(value, 0);
+    putLE32(value, _width - 1);
+    putLE32(value, _height - 1);
+    putAttribute(header, "dataWindow", "box2i", value);
+    putAttribute(header, "displayWindow", "box2i", value);
+
+    value = { 0 };              // INCREASING_Y
+    putAttribute(header, "lineOrder", "lineOrder", value);
+
+    const float one = 1.0f;
+    value.assign((const unsigned char*)&one, (const unsigned char*)&one + 4);
+    putAttribute(header, "pixelAspectRatio", "float", value);
+    putAttribute(header, "screenWindowWidth", "float", value);
+
+    value.assign(8, 0);
+    putAttribute(header, "screenWindowCenter", "v2f", value);
+    header.push_back(0);
+
+    // Offset of every line block
+    const size_t lineSize = (size_t)_width * 4 * 2;
+    uint64_t offset = header.size() + (uint64_t)_height * 8;
+    for (int y = 0; y < _height; y++) {
+        putLE32(header, offset & 0xFFFFFFFF);
+        putLE32(header, offset >> 32);
+        offset += 8 + lineSize;
+    }
+
+    bool ok = fwrite(header.data(), 1, header.size(), file) == header.size();
+
+    // EXR lines go top down, planar per channel
+    std::vector<unsigned char> line;
+    line.reserve(8 + lineSize);
+    std::vector<uint16_t> plane(_width);
+    for (int y = 0; y < _height && ok; y++) {
+        const uint16_t* src = _pixels + (size_t)(_height - 1 - y) * _width * 4;
+
+        line.clear();
+        putLE32(line, y);
+        putLE32(line, lineSize);
+        for (int c = 0; c < 4; c++) {
+            for (int x = 0; x < _width; x++)
+                plane[x] = src[x * 4 + offsets[c]];
+            line.insert(line.end(), (const unsigned char*)plane.data(), (const unsigned char*)(plane.data() + _width));
+        }
+        ok = fwrite(line.data(), 1, line.size(), file) == line.size();
+    }
+
+    if (fclose(file) != 0)
+        ok = false;
+
+    if (!ok)
+        std::cerr << "Fail writing " << _file << std::endl;
+    return ok;
+}
+
+}
+
+void halfToFloat(const uint16_t* _src, float* _dst, size_t _count) {
+    size_t i = 0;
+
+    #if defined(__F16C__)
+    for (; i + 8 <= _count; i += 8)
+        _mm256_storeu_ps(_dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(_src + i))));
+
+    #elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= _count; i += 8) {
+        __m128i half = _mm_loadu_si128((const __m128i*)(_src + i));
+        _mm_storeu_ps(_dst + i, halfToFloat(_mm_unpacklo_epi16(half, zero)));
+        _mm_storeu_ps(_dst + i + 4, halfToFloat(_mm_unpackhi_epi16(half, zero)));
+    }
+
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= _count; i += 4)
+        vst1q_f32(_dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(_src + i))));
+
+    #endif
+
+    for (; i < _count; i++)
+        _dst[i] = halfToFloat(_src[i]);
+}
+
+void floatToHalf(const float* _src, uint16_t* _dst, size_t _count) {
+    // front to back, each half lands on bytes of floats already converted
+    for (size_t i = 0; i < _count; i++)
+        _dst[i] = floatToHalf(_src[i]);
+}
+
+bool savePixelsHalf(const std::string& _file, const uint16_t* _pixels, int _width, int _height) {
+    if (ada::toLower(ada::getExt(_file)) == "exr")
+        return saveEXR(_file, _pixels, _width, _height);
+
+    std::vector<float> pixels((size_t)_width * _height * 4);
+    halfToFloat(_pixels, pixels.data(), pixels.size());
+    return ada::savePixelsHDR(_file, pixels.data(), _width, _height);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+// Converts IEEE half floats to floats, eight or four at a time on SSE2, F16C or NEON
+void    halfToFloat(const uint16_t* _src, float* _dst, size_t _count);
+
+// Converts floats to IEEE half floats rounding to the nearest, _dst can be the same memory as _src
+void    floatToHalf(const float* _src, uint16_t* _dst, size_t _count);
+
+// Saves RGBA half float pixels, as read from OpenGL (bottom up), to a .exr (kept as half) or .hdr file
+bool    savePixelsHalf(const std::string& _file, const uint16_t* _pixels, int _width, int _height);
@@ -0,0 +1,262 @@
+#include "histogram.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "ada/geom/meshes.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Past this many pixels the GPU path samples a regular grid of them, which is plenty for a histogram
+const size_t HISTOGRAM_MAX_POINTS = 1 << 20;
+
+// Results waiting on the readback ring before they are mapped
+const size_t HISTOGRAM_READBACK_DEPTH = 3;
+
+namespace {
+
+// Each point samples one texel and lands on the bin of its value, on the channel of u_channel
+const std::string histogram_vert = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+
+uniform sampler2D   u_tex0;
+uniform vec4        u_channel;
+
+attribute vec4      a_position;
+varying vec4        v_color;
+
+void main() {
+    vec4 color = texture2DLod(u_tex0, a_position.xy, 0.0);
+    float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+    float value = floor(clamp(dot(vec4(color.rgb, luma), u_channel), 0.0, 1.0) * 255.0 + 0.5);
+
+    v_color = u_channel;
+    gl_PointSize = 1.0;
+    gl_Position = vec4((value + 0.5) / 128.0 - 1.0, 0.0, 0.0, 1.0);
+}
+)";
+
+const std::string histogram_frag = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+
+varying vec4        v_color;
+
+void main() {
+    gl_FragColor = v_color;
+}
+)";
+
+// Red, green and blue share the same maximum so they can be compared, luma has its own
+void normalize(const float* _counts, float* _bins) {
+    float maxRGB = 0.0f;
+    float maxLuma = 0.0f;
+    for (size_t i = 0; i < 256; i++) {
+        maxRGB = std::max(maxRGB, std::max(_counts[i * 4], std::max(_counts[i * 4 + 1], _counts[i * 4 + 2])));
+        maxLuma = std::max(maxLuma, _counts[i * 4 + 3]);
+    }
+
+    float rgb = (maxRGB > 0.0f) ? 1.0f / maxRGB : 0.0f;
+    float luma = (maxLuma > 0.0f) ? 1.0f / maxLuma : 0.0f;
+    for (size_t i = 0; i < 256; i++) {
+        _bins[i * 4] = _counts[i * 4] * rgb;
+        _bins[i * 4 + 1] = _counts[i * 4 + 1] * rgb;
+        _bins[i * 4 + 2] = _counts[i * 4 + 2] * rgb;
+        _bins[i * 4 + 3] = _counts[i * 4 + 3] * luma;
+    }
+}
+
+// Lumas of _total RGBA8 pixels with the BT.601 weights in fixed point (77 + 150 + 29 = 256)
+void lumas(const unsigned char* _pixels, size_t _total, unsigned char* _lumas) {
+    size_t i = 0;
+
+    #if defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    for (; i + 4 <= _total; i += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(_pixels + i * 4));
+        // r*77 + g*150 and b*29 of each pixel
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i luma = _mm_srli_epi32(_mm_add_epi32(even, odd), 8);
+        luma = _mm_packs_epi32(luma, luma);
+        luma = _mm_packus_epi16(luma, luma);
+        int packed = _mm_cvtsi128_si32(luma);
+        memcpy(_lumas + i, &packed, 4);
+    }
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 8 <= _total; i += 8) {
+        uint8x8x4_t pixels = vld4_u8(_pixels + i * 4);
+        uint16x8_t luma = vmull_u8(pixels.val[0], vdup_n_u8(77));
+        luma = vmlal_u8(luma, pixels.val[1], vdup_n_u8(150));
+        luma = vmlal_u8(luma, pixels.val[2], vdup_n_u8(29));
+        vst1_u8(_lumas + i, vshrn_n_u16(luma, 8));
+    }
+    #endif
+
+    for (; i < _total; i++) {
+        const unsigned char* p = _pixels + i * 4;
+        _lumas[i] = (unsigned char)((p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8);
+    }
+}
+
+}
+
+void histogramCount(const unsigned char* _pixels, size_t _total, uint32_t* _counts) {
+    /** Neighbour pixels tend to have the same values, and incrementing the same counter back to
+     *  back makes each increment wait for the last one. Alternating between four tables lets
+     *  them overlap, they are added together at the end **/
+    std::vector<uint32_t> tables(4 * 256 * 4, 0);
+    uint32_t* t[4] = { &tables[0], &tables[1024], &tables[2048], &tables[3072] };
+
+    const size_t BLOCK = 1024;
+    unsigned char luma[BLOCK];
+    for (size_t start = 0; start < _total; start += BLOCK) {
+        size_t count = std::min(BLOCK, _total - start);
+        const unsigned char* pixels = _pixels + start * 4;
+        lumas(pixels, count, luma);
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t* table = t[i & 3];
+            const unsigned char* p = pixels + i * 4;
+            table[p[0] * 4]++;
+            table[p[1] * 4 + 1]++;
+            table[p[2] * 4 + 2]++;
+            table[luma[i] * 4 + 3]++;
+        }
+    }
+
+    for (size_t i = 0; i < 1024; i++)
+        _counts[i] += t[0][i] + t[1][i] + t[2][i] + t[3][i];
+}
+
+Histogram::Histogram(): m_gpu(-1), m_points(nullptr), m_pointsWidth(0), m_pointsHeight(0) {
+}
+
+Histogram::~Histogram() {
+    if (m_points)
+        delete m_points;
+}
+
+void Histogram::compute(const ada::Fbo& _fbo, HistogramCallback _callback) {
+    if (!_fbo.isAllocated())
+        return;
+
+    if (m_gpu < 0) {
+        m_gpu = 0;
+
+        #if !defined(__EMSCRIPTEN__)
+        GLint units = 0;
+        glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &units);
+        if (units > 0 && m_shader.load(histogram_frag, histogram_vert, false)) {
+            m_bins.allocate(256, 1, ada::COLOR_FLOAT_TEXTURE);
+            m_gpu = m_bins.isAllocated() ? 1 : 0;
+        }
+        #endif
+    }
+
+    if (m_gpu > 0)
+        _computeGPU(_fbo, _callback);
+    else
+        _computeCPU(_fbo, _callback);
+}
+
+void Histogram::_computeGPU(const ada::Fbo& _fbo, HistogramCallback _callback) {
+    int width = _fbo.getWidth();
+    int height = _fbo.getHeight();
+
+    if (m_points == nullptr || m_pointsWidth != width || m_pointsHeight != height) {
+        if (m_points)
+            delete m_points;
+
+        size_t stride = (size_t)ceil(sqrt((double)width * height / HISTOGRAM_MAX_POINTS));
+        stride = std::max((size_t)1, stride);
+
+        ada::Mesh mesh;
+        mesh.setDrawMode(GL_POINTS);
+        for (size_t y = 0; y < (size_t)height; y += stride)
+            for (size_t x = 0; x < (size_t)width; x += stride)
+                mesh.addVertex(glm::vec3((x + 0.5f) / width, (y + 0.5f) / height, 0.0f));
+
+        m_points = new ada::Vbo(mesh);
+        m_pointsWidth = width;
+        m_pointsHeight = height;
+    }
+
+    GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    m_bins.bind();
+    glViewport(0, 0, 256, 1);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    m_shader.use();
+    m_shader.setUniformTexture("u_tex0", &_fbo, 0);
+    const float channels[4][4] = { {1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f} };
+    for (size_t i = 0; i < 4; i++) {
+        m_shader.setUniform("u_channel", channels[i][0], channels[i][1], channels[i][2], channels[i][3]);
+        m_points->render(&m_shader);
+    }
+
+    m_readback.allocate(256, 1, 4, HISTOGRAM_READBACK_DEPTH, HISTOGRAM_READBACK_DEPTH + 1, GL_FLOAT);
+    m_readback.read( [this, _callback](Pixels&& _pixels) {
+        m_normalized.resize(1024);
+        normalize((const float*)_pixels.get(), &m_normalized[0]);
+        _callback(&m_normalized[0]);
+    });
+
+    m_bins.unbind();
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (depth)
+        glEnable(GL_DEPTH_TEST);
+}
+
+void Histogram::_computeCPU(const ada::Fbo& _fbo, HistogramCallback _callback) {
+    int width = _fbo.getWidth();
+    int height = _fbo.getHeight();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo.getId());
+    m_readback.allocate(width, height, 4, HISTOGRAM_READBACK_DEPTH, HISTOGRAM_READBACK_DEPTH + 1);
+    m_readback.read( [this, _callback, width, height](Pixels&& _pixels) {
+        m_counts.assign(1024, 0);
+        histogramCount(_pixels.get(), (size_t)width * height, &m_counts[0]);
+
+        std::vector<float> counts(m_counts.begin(), m_counts.end());
+        m_normalized.resize(1024);
+        normalize(&counts[0], &m_normalized[0]);
+        _callback(&m_normalized[0]);
+    });
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Histogram::flush() {
+    m_readback.flush();
+}
+
+void Histogram::clear() {
+    m_readback.clear();
+}
+
+void Histogram::accountMemory(GpuAllocations& _list, const std::string& _owner) {
+    addGpuAllocation(_list, _owner, m_bins);
+    addGpuAllocation(_list, _owner, "readback", m_readback.getType() == GL_FLOAT ? "rgba32f" : "rgba8",
+                    m_readback.getWidth(), m_readback.getHeight(), m_readback.getBytesPerPixel(), m_readback.getDepth());
+}
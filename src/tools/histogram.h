@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ada/gl/fbo.h"
+#include "ada/gl/vbo.h"
+#include "ada/gl/shader.h"
+
+#include "readback.h"
+#include "gpuMemory.h"
+
+// How often each of the 256 values appears on red, green, blue and luma, as 256 RGBA floats normalized
+// to the most frequent one (the same maximum for the three colors)
+typedef std::function<void(const float* _bins)> HistogramCallback;
+
+// Adds the red, green, blue and luma of _total RGBA8 pixels to _counts (256 RGBA counts), using SSE2 or NEON when available
+void    histogramCount(const unsigned char* _pixels, size_t _total, uint32_t* _counts);
+
+/** Histogram of a framebuffer computed on the GPU: its pixels are drawn as points that land on
+ *  the bin of their value on a 256x1 float target, with additive blending, once per channel.
+ *  Only those 256 bins are read back, without waiting, and handed to the callback a couple of
+ *  frames later. When the GPU can't do it (no texture fetches on vertex shaders or no float
+ *  targets) the whole framebuffer is read back, also asynchronously, and counted on the CPU **/
+class Histogram {
+public:
+    Histogram();
+    virtual ~Histogram();
+
+    void    compute(const ada::Fbo& _fbo, HistogramCallback _callback);
+
+    // Delivers the results still on their way
+    void    flush();
+    void    clear();
+
+    bool    isGPU() const { return m_gpu > 0; }
+    size_t  getPending() const { return m_readback.getPending(); }
+
+    void    accountMemory(GpuAllocations& _list, const std::string& _owner);
+
+protected:
+    void    _computeGPU(const ada::Fbo& _fbo, HistogramCallback _callback);
+    void    _computeCPU(const ada::Fbo& _fbo, HistogramCallback _callback);
+
+    int             m_gpu;          // -1 not checked yet, 0 counting on the CPU, 1 on the GPU
+
+    ada::Fbo        m_bins;
+    ada::Shader     m_shader;
+    ada::Vbo*       m_points;
+    int             m_pointsWidth;
+    int             m_pointsHeight;
+
+    Readback        m_readback;
+    std::vector<uint32_t> m_counts;
+    std::vector<float>  m_normalized;
+};
@@ -0,0 +1,303 @@
+#include "imageWriter.h"
+
+#include <vector>
+#include <string.h>
+#include <iostream>
+#include <algorithm>
+
+#include "ada/fs.h"
+#include "ada/string.h"
+
+namespace {
+
+uint32_t crc_table[256];
+bool     crc_table_ready = false;
+
+uint32_t crc32(uint32_t _crc, const unsigned char* _data, size_t _size) {
+    if (!crc_table_ready) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc_table[n] = c;
+        }
+        crc_table_ready = true;
+    }
+
+    for (size_t i = 0; i < _size; i++)
+        _crc = crc_table[(_crc ^ _data[i]) & 0xFF] ^ (_crc >> 8);
+    return _crc;
+}
+
+uint32_t adler32(uint32_t _adler, const unsigned char* _data, size_t _size) {
+    uint32_t a = _adler & 0xFFFF;
+    uint32_t b = _adler >> 16;
+    while (_size > 0) {
+        // 5552 is the largest n for which b can't overflow before the modulo
+        size_t n = _size < 5552 ? _size : 5552;
+        _size -= n;
+        while (n--) {
+            a += *_data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+void putBE32(std::vector<unsigned char>& _out, uint32_t _value) {
+    _out.push_back((_value >> 24) & 0xFF);
+    _out.push_back((_value >> 16) & 0xFF);
+    _out.push_back((_value >> 8) & 0xFF);
+    _out.push_back(_value & 0xFF);
+}
+
+void putLE16(std::vector<unsigned char>& _out, uint16_t _value) {
+    _out.push_back(_value & 0xFF);
+    _out.push_back((_value >> 8) & 0xFF);
+}
+
+void putLE32(std::vector<unsigned char>& _out, uint32_t _value) {
+    putLE16(_out, _value & 0xFFFF);
+    putLE16(_out, _value >> 16);
+}
+
+void putTiffEntry(std::vector<unsigned char>& _out, uint16_t _tag, uint16_t _type, uint32_t _count, uint32_t _value) {
+    putLE16(_out, _tag);
+    putLE16(_out, _type);
+    putLE32(_out, _count);
+    putLE32(_out, _value);
+}
+
+const uint16_t TIFF_SHORT = 3;
+const uint16_t TIFF_LONG = 4;
+
+// Stored deflate blocks can't be longer than this
+const size_t DEFLATE_MAX_STORED = 65535;
+
+}
+
+ImageWriter::ImageWriter():
+    m_file(nullptr), m_format(FORMAT_PNG), m_width(0), m_height(0), m_channels(4), m_rows(0), m_ok(false),
+    m_crc(0), m_adler(1) {
+}
+
+ImageWriter::~ImageWriter() {
+    close();
+}
+
+bool ImageWriter::isSupported(const std::string& _file) {
+    std::string ext = ada::toLower( ada::getExt(_file) );
+    return ext == "png" || ext == "tif" || ext == "tiff" || ext == "ppm";
+}
+
+bool ImageWriter::open(const std::string& _file, int _width, int _height, int _channels) {
+    close();
+
+    if (_width <= 0 || _height <= 0 || (_channels != 1 && _channels != 3 && _channels != 4)) {
+        std::cerr << "ImageWriter: can't write a " << _width << "x" << _height << " image of " << _channels << " channels" << std::endl;
+        return false;
+    }
+
+    std::string ext = ada::toLower( ada::getExt(_file) );
+    if (ext == "png")
+        m_format = FORMAT_PNG;
+    else if (ext == "tif" || ext == "tiff")
+        m_format = FORMAT_TIFF;
+    else if (ext == "ppm")
+        m_format = FORMAT_PPM;
+    else {
+        std::cerr << "ImageWriter: " << _file << " is not a .png, .tif or .ppm file" << std::endl;
+        return false;
+    }
+
+    // Classic TIFF offsets are 32 bits
+    if (m_format == FORMAT_TIFF && (uint64_t)_width * _height * _channels > 0xFFFFFF00ull) {
+        std::cerr << "ImageWriter: " << _file << " is bigger than 4GB, save it as .png or .ppm instead" << std::endl;
+        return false;
+    }
+
+    m_file = fopen(_file.c_str(), "wb");
+    if (!m_file) {
+        std::cerr << "ImageWriter: can't write " << _file << std::endl;
+        return false;
+    }
+
+    m_width = _width;
+    m_height = _height;
+    m_channels = _channels;
+    m_rows = 0;
+    m_ok = true;
+    m_adler = 1;
+
+    return _writeHeader();
+}
+
+bool ImageWriter::_writeHeader() {
+    std::vector<unsigned char> header;
+
+    if (m_format == FORMAT_PNG) {
+        const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        _write(signature, 8);
+
+        putBE32(header, m_width);
+        putBE32(header, m_height);
+        header.push_back(8);                                            // bit depth
+        header.push_back(m_channels == 4 ? 6 : m_channels == 3 ? 2 : 0);   // color type
+        header.push_back(0);                                            // deflate
+        header.push_back(0);                                            // adaptive filtering
+        header.push_back(0);                                            // no interlace
+        _pngChunkBegin("IHDR", header.size());
+        _pngChunkWrite(header.data(), header.size());
+        _pngChunkEnd();
+
+        // zlib header: deflate with a 32K window and no dictionary
+        const unsigned char zlib[2] = { 0x78, 0x01 };
+        _pngChunkBegin("IDAT", 2);
+        _pngChunkWrite(zlib, 2);
+        _pngChunkEnd();
+    }
+    else if (m_format == FORMAT_TIFF) {
+        const uint16_t entries = (m_channels == 4) ? 11 : 10;
+        const uint32_t bpsOffset = 8 + 2 + entries * 12 + 4;
+        const uint32_t dataOffset = bpsOffset + ((m_channels > 2) ? m_channels * 2 : 0);
+
+        header.push_back('I');
+        header.push_back('I');
+        putLE16(header, 42);
+        putLE32(header, 8);
+
+        // Tags have to be sorted
+        putLE16(header, entries);
+        putTiffEntry(header, 256, TIFF_LONG, 1, m_width);
+        putTiffEntry(header, 257, TIFF_LONG, 1, m_height);
+        putTiffEntry(header, 258, TIFF_SHORT, m_channels, (m_channels > 2) ? bpsOffset : 8);
+        putTiffEntry(header, 259, TIFF_SHORT, 1, 1);                        // no compression
+        putTiffEntry(header, 262, TIFF_SHORT, 1, (m_channels > 2) ? 2 : 1);  // RGB or min-is-black
+        putTiffEntry(header, 273, TIFF_LONG, 1, dataOffset);
+        putTiffEntry(header, 277, TIFF_SHORT, 1, m_channels);
+        putTiffEntry(header, 278, TIFF_LONG, 1, m_height);
+        putTiffEntry(header, 279, TIFF_LONG, 1, (uint32_t)m_width * m_height * m_channels);
+        putTiffEntry(header, 284, TIFF_SHORT, 1, 1);                        // chunky
+        if (m_channels == 4)
+            putTiffEntry(header, 338, TIFF_SHORT, 1, 2);                    // unassociated alpha
+        putLE32(header, 0);
+
+        if (m_channels > 2)
+            for (int i = 0; i < m_channels; i++)
+                putLE16(header, 8);
+
+        _write(header.data(), header.size());
+    }
+    else {
+        std::string ppm = std::string(m_channels == 1 ? "P5" : "P6") + "\n" + ada::toString(m_width) + " " + ada::toString(m_height) + "\n255\n";
+        _write(ppm.c_str(), ppm.size());
+    }
+
+    return m_ok;
+}
+
+bool ImageWriter::writeRows(const unsigned char* _rows, int _count) {
+    if (!isOpen() || !m_ok)
+        return false;
+
+    if (m_rows + _count > m_height)
+        _count = m_height - m_rows;
+
+    const size_t stride = (size_t)m_width * m_channels;
+
+    if (m_format == FORMAT_PNG) {
+        std::vector<unsigned char> row(stride + 1);
+        for (int r = 0; r < _count; r++) {
+            // filter type none, followed by the row
+            row[0] = 0;
+            memcpy(&row[1], _rows + r * stride, stride);
+            m_adler = adler32(m_adler, row.data(), row.size());
+
+            size_t blocks = (row.size() + DEFLATE_MAX_STORED - 1) / DEFLATE_MAX_STORED;
+            _pngChunkBegin("IDAT", row.size() + blocks * 5);
+            for (size_t offset = 0; offset < row.size(); offset += DEFLATE_MAX_STORED) {
+                uint16_t length = (uint16_t)std::min(DEFLATE_MAX_STORED, row.size() - offset);
+                const unsigned char block[5] = {    0x00,
+                                                    (unsigned char)(length & 0xFF), (unsigned char)(length >> 8),
+                                                    (unsigned char)(~length & 0xFF), (unsigned char)((~length >> 8) & 0xFF) };
+                _pngChunkWrite(block, 5);
+                _pngChunkWrite(&row[offset], length);
+            }
+            _pngChunkEnd();
+        }
+    }
+    else if (m_format == FORMAT_PPM && m_channels == 4) {
+        std::vector<unsigned char> rgb((size_t)m_width * 3);
+        for (int r = 0; r < _count; r++) {
+            const unsigned char* src = _rows + r * stride;
+            for (int x = 0; x < m_width; x++) {
+                rgb[x * 3 + 0] = src[x * 4 + 0];
+                rgb[x * 3 + 1] = src[x * 4 + 1];
+                rgb[x * 3 + 2] = src[x * 4 + 2];
+            }
+            _write(rgb.data(), rgb.size());
+        }
+    }
+    else
+        _write(_rows, stride * _count);
+
+    m_rows += _count;
+    return m_ok;
+}
+
+bool ImageWriter::close() {
+    if (!isOpen())
+        return false;
+
+    bool complete = m_ok && m_rows == m_height;
+
+    if (complete && m_format == FORMAT_PNG) {
+        // Empty final block closes the deflate stream, then the checksum of everything inflated
+        std::vector<unsigned char> end = { 0x01, 0x00, 0x00, 0xFF, 0xFF };
+        putBE32(end, m_adler);
+        _pngChunkBegin("IDAT", end.size());
+        _pngChunkWrite(end.data(), end.size());
+        _pngChunkEnd();
+
+        _pngChunkBegin("IEND", 0);
+        _pngChunkEnd();
+    }
+
+    if (fclose(m_file) != 0)
+        complete = false;
+    m_file = nullptr;
+
+    if (!complete)
+        std::cerr << "ImageWriter: only " << m_rows << " of " << m_height << " rows were written" << std::endl;
+
+    return complete;
+}
+
+bool ImageWriter::_write(const void* _data, size_t _size) {
+    if (m_ok && _size > 0 && fwrite(_data, 1, _size, m_file) != _size)
+        m_ok = false;
+    return m_ok;
+}
+
+void ImageWriter::_pngChunkBegin(const char* _type, uint32_t _length) {
+    std::vector<unsigned char> header;
+    putBE32(header, _length);
+    _write(header.data(), 4);
+
+    // The CRC covers the type and the data, but not the length
+    m_crc = 0xFFFFFFFFu;
+    _pngChunkWrite(_type, 4);
+}
+
+void ImageWriter::_pngChunkWrite(const void* _data, size_t _size) {
+    m_crc = crc32(m_crc, (const unsigned char*)_data, _size);
+    _write(_data, _size);
+}
+
+void ImageWriter::_pngChunkEnd() {
+    std::vector<unsigned char> crc;
+    putBE32(crc, m_crc ^ 0xFFFFFFFFu);
+    _write(crc.data(), 4);
+}
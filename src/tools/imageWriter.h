@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+
+/** Writes an 8 bits per channel image a few rows at a time, so images much bigger than
+ *  what fits in memory (or in a texture) can be saved as they are rendered. The format comes
+ *  from the extension: .png (stored without deflate compression), .tif/.tiff (uncompressed
+ *  single strip) or .ppm (RGB only, alpha is dropped). Rows go top down. **/
+class ImageWriter {
+public:
+    ImageWriter();
+    virtual ~ImageWriter();
+
+    static bool isSupported(const std::string& _file);
+
+    bool    open(const std::string& _file, int _width, int _height, int _channels);
+    bool    isOpen() const { return m_file != nullptr; }
+
+    // Appends _count rows of width * channels bytes each
+    bool    writeRows(const unsigned char* _rows, int _count);
+
+    // Returns false if the file is not complete
+    bool    close();
+
+    int     getRowsWritten() const { return m_rows; }
+
+private:
+    enum Format {
+        FORMAT_PNG = 0,
+        FORMAT_TIFF,
+        FORMAT_PPM
+    };
+
+    bool    _writeHeader();
+    bool    _write(const void* _data, size_t _size);
+    void    _pngChunkBegin(const char* _type, uint32_t _length);
+    void    _pngChunkWrite(const void* _data, size_t _size);
+    void    _pngChunkEnd();
+
+    FILE*   m_file;
+    Format  m_format;
+    int     m_width;
+    int     m_height;
+    int     m_channels;
+    int     m_rows;
+    bool    m_ok;
+
+    uint32_t m_crc;
+    uint32_t m_adler;
+};
@@ -0,0 +1,241 @@
+#include "includeGraph.h"
+
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// Absolute path of an existing file without . or .. on it, empty when there is no such file
+std::string fullPath(const std::string& _path) {
+    #if defined(PLATFORM_WINDOWS)
+    char buffer[_MAX_PATH];
+    if (_fullpath(buffer, _path.c_str(), _MAX_PATH) == NULL)
+        return "";
+    std::string path(buffer);
+    #else
+    char* buffer = realpath(_path.c_str(), NULL);
+    if (buffer == NULL)
+        return "";
+    std::string path(buffer);
+    free(buffer);
+    #endif
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || (st.st_mode & S_IFMT) == S_IFDIR)
+        return "";
+    return path;
+}
+
+bool beginsWith(const std::string& _str, const char* _start) {
+    return _str.compare(0, strlen(_start), _start) == 0;
+}
+
+void addUnique(ada::StringList& _list, const std::string& _value) {
+    if (std::find(_list.begin(), _list.end(), _value) == _list.end())
+        _list.push_back(_value);
+}
+
+}
+
+IncludeGraph::IncludeGraph(): m_reads(0), m_expansions(0), m_cached(0) {
+}
+
+bool IncludeGraph::load(const std::string& _path, std::string* _into, const ada::StringList& _folders, ada::StringList* _dependencies) {
+    // other folders may find other files
+    if (_folders != m_folders) {
+        m_nodes.clear();
+        m_folders = _folders;
+    }
+
+    std::string path = fullPath(_path);
+    if (path.empty())
+        return false;
+
+    std::map<std::string, Node>::iterator it = m_nodes.find(path);
+    if (it == m_nodes.end()) {
+        it = m_nodes.insert(std::make_pair(path, Node())).first;
+        if (!_read(path, it->second)) {
+            m_nodes.erase(it);
+            return false;
+        }
+    }
+
+    if (it->second.expanded)
+        m_cached++;
+    else {
+        std::vector<std::string> stack;
+        _expand(path, stack);
+    }
+
+    *_into = it->second.expansion;
+    for (size_t i = 0; i < it->second.dependencies.size(); i++)
+        addUnique(*_dependencies, it->second.dependencies[i]);
+    return true;
+}
+
+void IncludeGraph::invalidate(const std::string& _path) {
+    std::string path = fullPath(_path);
+    std::map<std::string, Node>::iterator it = m_nodes.find(path.empty() ? _path : path);
+    if (it == m_nodes.end())
+        return;
+    path = it->first;
+
+    Node node;
+    if (!_read(path, node)) {
+        // it's gone, the files including it look for it again on their next expansion
+        _dropExpansion(path);
+        _unlink(path, it->second);
+        m_nodes.erase(it);
+        return;
+    }
+
+    // saved without changes
+    if (node.hash == it->second.hash)
+        return;
+
+    _dropExpansion(path);
+    _unlink(path, it->second);
+    node.parents = it->second.parents;
+    it->second = node;
+}
+
+void IncludeGraph::clear() {
+    m_nodes.clear();
+}
+
+std::string IncludeGraph::logStats() {
+    std::string log = "";
+    log += "files," + ada::toString(m_nodes.size()) + "\n";
+    log += "reads," + ada::toString(m_reads) + "\n";
+    log += "expansions," + ada::toString(m_expansions) + "\n";
+    log += "cached," + ada::toString(m_cached) + "\n";
+    return log;
+}
+
+bool IncludeGraph::_read(const std::string& _path, Node& _node) {
+    std::ifstream file(_path.c_str(), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    m_reads++;
+
+    _node.hash = std::hash<std::string>()(contents);
+    _node.code.assign(1, "");
+    _node.includes.clear();
+    _node.children.clear();
+    _node.expanded = false;
+
+    // Line by line like ada, where every line gets a \n (the empty one after the last \n too)
+    size_t start = 0;
+    while (start <= contents.size()) {
+        size_t end = contents.find('\n', start);
+        if (end == std::string::npos)
+            end = contents.size();
+        std::string line = contents.substr(start, end - start);
+        start = end + 1;
+
+        if (beginsWith(line, "#include ") || beginsWith(line, "#pragma include ")) {
+            // without a "file" the line is dropped
+            size_t begin = line.find_first_of('"');
+            size_t last = line.find_last_of('"');
+            if (begin != last) {
+                _node.includes.push_back(line.substr(begin + 1, last - begin - 1));
+                _node.children.push_back("");
+                _node.code.push_back("");
+            }
+        }
+        else
+            _node.code.back() += line + "\n";
+    }
+
+    return true;
+}
+
+/** Expands _path and the files it includes that aren't expanded yet. False when something was left
+ *  out (a file not found or a cycle of includes), then the expansion is not kept for the next load
+ *  and the same error shows up again until it's fixed **/
+bool IncludeGraph::_expand(const std::string& _path, std::vector<std::string>& _stack) {
+    // elements of a std::map stay where they are while others are added
+    Node& node = m_nodes[_path];
+    bool complete = true;
+
+    _stack.push_back(_path);
+    node.expansion = node.code[0];
+    node.dependencies.clear();
+    for (size_t i = 0; i < node.includes.size(); i++) {
+        std::string& child = node.children[i];
+        if (child.empty() || m_nodes.find(child) == m_nodes.end()) {
+            child = _resolve(node.includes[i], _path);
+            if (!child.empty() && m_nodes.find(child) == m_nodes.end() && !_read(child, m_nodes[child])) {
+                m_nodes.erase(child);
+                child = "";
+            }
+        }
+
+        if (child.empty()) {
+            std::cerr << "Error: " << node.includes[i] << " not found at " << _path << std::endl;
+            complete = false;
+        }
+        else if (std::find(_stack.begin(), _stack.end(), child) != _stack.end()) {
+            std::cerr << "Error: " << child << " includes itself through " << _path << std::endl;
+            complete = false;
+        }
+        else {
+            Node& include = m_nodes[child];
+            if (!include.expanded)
+                complete = _expand(child, _stack) && complete;
+            include.parents.insert(_path);
+
+            node.expansion += "\n" + include.expansion + "\n";
+            for (size_t d = 0; d < include.dependencies.size(); d++)
+                addUnique(node.dependencies, include.dependencies[d]);
+            addUnique(node.dependencies, child);
+        }
+
+        node.expansion += node.code[i + 1];
+    }
+    _stack.pop_back();
+
+    node.expanded = complete;
+    m_expansions++;
+    return complete;
+}
+
+// Next to the file including it first, then on the include folders
+std::string IncludeGraph::_resolve(const std::string& _name, const std::string& _from) {
+    std::string path = fullPath(_from.substr(0, _from.find_last_of("/\\") + 1) + _name);
+    for (size_t i = 0; i < m_folders.size() && path.empty(); i++)
+        path = fullPath(m_folders[i] + "/" + _name);
+    return path;
+}
+
+void IncludeGraph::_unlink(const std::string& _path, Node& _node) {
+    for (size_t i = 0; i < _node.children.size(); i++) {
+        std::map<std::string, Node>::iterator it = m_nodes.find(_node.children[i]);
+        if (it != m_nodes.end())
+            it->second.parents.erase(_path);
+    }
+}
+
+// The expansion of _path and of every file including it, up to the shaders, are done again on their next load
+void IncludeGraph::_dropExpansion(const std::string& _path) {
+    std::vector<std::string> pending(1, _path);
+    while (!pending.empty()) {
+        std::map<std::string, Node>::iterator it = m_nodes.find(pending.back());
+        pending.pop_back();
+
+        // the ones including a file that's not expanded aren't either
+        if (it == m_nodes.end() || !it->second.expanded)
+            continue;
+
+        it->second.expanded = false;
+        pending.insert(pending.end(), it->second.parents.begin(), it->second.parents.end());
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+#include "ada/string.h"
+
+/** The #include tree of the shaders, kept in memory between reloads. Every file is read once and
+ *  kept split in its code and its includes, next to what it expands to. When a file changes only
+ *  that one is read again, and only its expansion and the ones of the files including it (up to
+ *  the shaders) are done again, the rest come from memory. A file saved with the same contents
+ *  changes nothing. Follows the rules of ada::loadGlslFrom: a line starting with #include "file"
+ *  or #pragma include "file" is replaced by that file, looked for next to the one including it and
+ *  then on the include folders **/
+class IncludeGraph {
+public:
+    IncludeGraph();
+
+    // Like ada::loadGlslFrom, _dependencies gets every file included (once) with their full path
+    bool    load(const std::string& _path, std::string* _into, const ada::StringList& _folders, ada::StringList* _dependencies);
+
+    // _path changed on disk, it's read again and the shaders including it are expanded on their next load
+    void    invalidate(const std::string& _path);
+    void    clear();
+
+    // files on memory, read from disk, expanded, and loads that took no expansion (cached)
+    std::string logStats();
+
+protected:
+    struct Node {
+        Node(): hash(0), expanded(false) {}
+
+        std::vector<std::string> code;      // before each include, and after the last one
+        std::vector<std::string> includes;  // file names as written on them
+        std::vector<std::string> children;  // the files they were found on, empty until then
+        std::set<std::string>    parents;
+        size_t                   hash;
+
+        bool                     expanded;
+        std::string              expansion;
+        ada::StringList          dependencies;
+    };
+
+    bool    _read(const std::string& _path, Node& _node);
+    bool    _expand(const std::string& _path, std::vector<std::string>& _stack);
+    std::string _resolve(const std::string& _name, const std::string& _from);
+    void    _unlink(const std::string& _path, Node& _node);
+    void    _dropExpansion(const std::string& _path);
+
+    std::map<std::string, Node> m_nodes;
+    ada::StringList m_folders;
+
+    size_t  m_reads;
+    size_t  m_expansions;
+    size_t  m_cached;
+};
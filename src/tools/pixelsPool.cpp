@@ -0,0 +1,94 @@
+#include "pixelsPool.h"
+
+#include <chrono>
+
+void PixelsReleaser::operator()(unsigned char* _pixels) const {
+    if (pool)
+        pool->release(_pixels);
+    else
+        delete[] _pixels;
+}
+
+PixelsPool::PixelsPool(): m_slabSize(0), m_waits(0), m_waitUs(0), m_maxWaitUs(0) {
+}
+
+PixelsPool::~PixelsPool() {
+    clear();
+}
+
+void PixelsPool::allocate(size_t _slabSize, size_t _slabs) {
+    if (_slabs < 1)
+        _slabs = 1;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_slabSize == _slabSize && m_slabs.size() == _slabs)
+        return;
+
+    // slabs still in use point to the old memory
+    _waitForAll(lock);
+
+    m_slabs.clear();
+    m_free.clear();
+    m_slabSize = _slabSize;
+    for (size_t i = 0; i < _slabs; i++) {
+        m_slabs.push_back( std::unique_ptr<unsigned char[]>(new unsigned char[m_slabSize]) );
+        m_free.push_back( m_slabs.back().get() );
+    }
+}
+
+void PixelsPool::clear() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    _waitForAll(lock);
+
+    m_slabs.clear();
+    m_free.clear();
+    m_slabSize = 0;
+}
+
+Pixels PixelsPool::acquire() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_free.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        m_released.wait(lock, [this]{ return !m_free.empty(); });
+        long long us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        m_waits++;
+        m_waitUs += us;
+        if (us > m_maxWaitUs.load())
+            m_maxWaitUs = us;
+    }
+
+    unsigned char* slab = m_free.back();
+    m_free.pop_back();
+
+    PixelsReleaser releaser;
+    releaser.pool = this;
+    return Pixels(slab, releaser);
+}
+
+void PixelsPool::release(unsigned char* _pixels) {
+    if (_pixels == nullptr)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(_pixels);
+    }
+    m_released.notify_all();
+}
+
+size_t PixelsPool::getFree() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_free.size();
+}
+
+void PixelsPool::resetStats() {
+    m_waits = 0;
+    m_waitUs = 0;
+    m_maxWaitUs = 0;
+}
+
+void PixelsPool::_waitForAll(std::unique_lock<std::mutex>& _lock) {
+    m_released.wait(_lock, [this]{ return m_free.size() == m_slabs.size(); });
+}
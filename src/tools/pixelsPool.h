@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+
+class PixelsPool;
+
+/** Gives the pixels back to the pool they came from, or deletes them if they don't belong to one **/
+struct PixelsReleaser {
+    PixelsPool* pool = nullptr;
+    void operator()(unsigned char* _pixels) const;
+};
+
+typedef std::unique_ptr<unsigned char[], PixelsReleaser> Pixels;
+
+/** Fixed amount of preallocated pixel slabs shared between the capture path and the threads
+ *  that save or encode them. Instead of allocating a new frame every time, the capture checks
+ *  out a slab and waits when all of them are in use, which puts a hard limit on the memory
+ *  used by frames waiting to be saved **/
+class PixelsPool {
+public:
+    PixelsPool();
+    virtual ~PixelsPool();
+
+    // Waits for all slabs to be back before reallocating them
+    void    allocate(size_t _slabSize, size_t _slabs);
+    void    clear();
+
+    Pixels  acquire();
+    void    release(unsigned char* _pixels);
+
+    size_t  getSlabSize() const { return m_slabSize; }
+    size_t  getTotal() const { return m_slabs.size(); }
+    size_t  getFree();
+
+    // How many times and how long acquire() had to wait for a slab
+    size_t  getWaits() const { return m_waits.load(); }
+    double  getWaitMs() const { return m_waitUs.load() * 0.001; }
+    double  getMaxWaitMs() const { return m_maxWaitUs.load() * 0.001; }
+    void    resetStats();
+
+private:
+    void    _waitForAll(std::unique_lock<std::mutex>& _lock);
+
+    std::vector< std::unique_ptr<unsigned char[]> > m_slabs;
+    std::vector<unsigned char*> m_free;
+    size_t                      m_slabSize;
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_released;
+
+    std::atomic<size_t>         m_waits;
+    std::atomic<long long>      m_waitUs;
+    std::atomic<long long>      m_maxWaitUs;
+};
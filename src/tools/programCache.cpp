@@ -0,0 +1,397 @@
+#include "programCache.h"
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <iostream>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(PLATFORM_WINDOWS)
+#include <direct.h>
+#endif
+
+#include "ada/string.h"
+
+namespace {
+
+#if defined(SUPPORT_PROGRAM_BINARY)
+const char      program_magic[8] = { 'G', 'V', 'P', 'R', 'O', 'G', 'B', 'N' };
+const uint32_t  program_version = 1;
+
+// Valid on every GLSL version ada may put in front of them, from 1.00 ES to 4.x core
+const std::string program_stub_vert = "void main() { gl_Position = vec4(0.0); }\n";
+const std::string program_stub_frag = "void main() { }\n";
+
+std::string glString(GLenum _name) {
+    const GLubyte* str = glGetString(_name);
+    return str ? std::string((const char*)str) : std::string("");
+}
+
+std::string shaderSource(GLuint _shader) {
+    GLint length = 0;
+    glGetShaderiv(_shader, GL_SHADER_SOURCE_LENGTH, &length);
+    if (length <= 1)
+        return "";
+
+    std::vector<char> source(length);
+    GLsizei written = 0;
+    glGetShaderSource(_shader, length, &written, &source[0]);
+    return std::string(&source[0], written);
+}
+
+std::string toHex(size_t _value) {
+    static const char* digits = "0123456789abcdef";
+    std::string rta(sizeof(size_t) * 2, '0');
+    for (size_t i = 0; i < rta.size(); i++)
+        rta[rta.size() - 1 - i] = digits[(_value >> (i * 4)) & 0xF];
+    return rta;
+}
+
+template <typename T>
+bool read(std::istream& _stream, T& _value) {
+    return (bool)_stream.read((char*)&_value, sizeof(T));
+}
+
+template <typename T>
+void write(std::ostream& _stream, const T& _value) {
+    _stream.write((const char*)&_value, sizeof(T));
+}
+#endif
+
+bool makeFolder(const std::string& _folder) {
+    struct stat st;
+    if (stat(_folder.c_str(), &st) == 0)
+        return (st.st_mode & S_IFDIR) != 0;
+
+    #if defined(PLATFORM_WINDOWS)
+    return _mkdir(_folder.c_str()) == 0;
+    #else
+    return mkdir(_folder.c_str(), 0755) == 0;
+    #endif
+}
+
+}
+
+ProgramCache::ProgramCache():
+    m_folder(""), m_supported(-1), m_driverHash(0), m_hits(0), m_misses(0), m_rejected(0), m_saved(0), m_unsaved(0) {
+    #if !defined(SUPPORT_PROGRAM_BINARY)
+    m_supported = 0;
+    #endif
+}
+
+bool ProgramCache::setFolder(const std::string& _folder) {
+    std::string folder = _folder;
+    while (folder.size() > 1 && (folder[folder.size() - 1] == '/' || folder[folder.size() - 1] == '\\'))
+        folder.erase(folder.size() - 1);
+
+    if (!folder.empty() && !makeFolder(folder)) {
+        std::cerr << "// Can't use " << folder << " as the program cache folder" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_folder = folder;
+    return true;
+}
+
+std::string ProgramCache::getFolder() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_folder;
+}
+
+bool ProgramCache::isEnabled() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_folder.empty() && m_supported != 0;
+}
+
+// Some drivers (like most of the ones on GLES 2.0) can't give back binaries at all
+bool ProgramCache::isSupported() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    #if defined(SUPPORT_PROGRAM_BINARY)
+    if (m_supported < 0) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        m_supported = (formats > 0) ? 1 : 0;
+
+        // a driver update changes the version string, and with it every key
+        m_driverHash = std::hash<std::string>()(glString(GL_VENDOR) + '\0' + glString(GL_RENDERER) + '\0' +
+                                                glString(GL_VERSION) + '\0' + glString(GL_SHADING_LANGUAGE_VERSION));
+        if (m_supported == 0)
+            std::cerr << "// This driver can't save program binaries, the program cache is off" << std::endl;
+    }
+    #endif
+
+    return m_supported > 0;
+}
+
+bool ProgramCache::load(ada::Shader& _shader, const std::string& _fragSrc, const std::string& _vertSrc,
+                        const std::function<bool()>& _compile, bool& _hit) {
+    _hit = false;
+
+    #if defined(SUPPORT_PROGRAM_BINARY)
+    bool active;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        active = !m_folder.empty() || !m_memory.empty();
+    }
+
+    std::string stubFrag, stubVert;
+    if (active && isSupported() && _stubSources(_shader, stubFrag, stubVert)) {
+        std::string key = _hashKey(stubFrag, stubVert, _fragSrc, _vertSrc);
+        if (_loadBinary(_shader, key)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_hits++;
+            _hit = true;
+            return true;
+        }
+
+        bool ok = _compile();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_misses++;
+        }
+
+        // a program that didn't link (or the error screen shown instead) is never cached
+        if (ok && isEnabled())
+            _saveBinary(_shader.getProgram(), key, false);
+        return ok;
+    }
+    #endif
+
+    return _compile();
+}
+
+bool ProgramCache::prepare( const std::map<std::string, std::string>& _defines, const std::string& _passDefines,
+                            const std::string& _fragSrc, const std::string& _vertSrc,
+                            std::string& _fullFragSrc, std::string& _fullVertSrc, std::string& _key) {
+    #if defined(SUPPORT_PROGRAM_BINARY)
+    // ada puts its defines after the #version of the source when there is one, the stub can't tell where
+    if (!isSupported() || _fragSrc.find("#version") != std::string::npos || _vertSrc.find("#version") != std::string::npos)
+        return false;
+
+    ada::Shader shader;
+    for (std::map<std::string, std::string>::const_iterator it = _defines.begin(); it != _defines.end(); ++it)
+        shader.addDefine(it->first, it->second);
+
+    std::vector<std::string> defines = ada::split(_passDefines, ' ');
+    for (size_t i = 0; i < defines.size(); i++) {
+        size_t equal = defines[i].find('=');
+        if (equal == std::string::npos)
+            shader.addDefine(defines[i]);
+        else
+            shader.addDefine(defines[i].substr(0, equal), defines[i].substr(equal + 1));
+    }
+
+    std::string stubFrag, stubVert;
+    if (!_stubSources(shader, stubFrag, stubVert))
+        return false;
+
+    // what ada put in front of the stubs goes in front of the sources
+    if (stubFrag.size() < program_stub_frag.size() || stubFrag.compare(stubFrag.size() - program_stub_frag.size(), program_stub_frag.size(), program_stub_frag) != 0 ||
+        stubVert.size() < program_stub_vert.size() || stubVert.compare(stubVert.size() - program_stub_vert.size(), program_stub_vert.size(), program_stub_vert) != 0)
+        return false;
+
+    _fullFragSrc = stubFrag.substr(0, stubFrag.size() - program_stub_frag.size()) + _fragSrc;
+    _fullVertSrc = stubVert.substr(0, stubVert.size() - program_stub_vert.size()) + _vertSrc;
+    _key = _hashKey(stubFrag, stubVert, _fragSrc, _vertSrc);
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+bool ProgramCache::save(GLuint _program, const std::string& _key) {
+    #if defined(SUPPORT_PROGRAM_BINARY)
+    return isSupported() && _saveBinary(_program, _key, true);
+    #else
+    return false;
+    #endif
+}
+
+void ProgramCache::clearMemory() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memory.clear();
+}
+
+#if defined(SUPPORT_PROGRAM_BINARY)
+/** ada adds its #version and every #define of the shader in front of the sources. Loading the stub
+ *  leaves those on the shader objects of its program, where they can be read back, and that
+ *  program is the one a cached binary is loaded into **/
+bool ProgramCache::_stubSources(ada::Shader& _shader, std::string& _fragSrc, std::string& _vertSrc) {
+    if (!_shader.load(program_stub_frag, program_stub_vert, false))
+        return false;
+
+    GLuint shaders[2] = { 0, 0 };
+    GLsizei count = 0;
+    glGetAttachedShaders(_shader.getProgram(), 2, &count, shaders);
+
+    _fragSrc = "";
+    _vertSrc = "";
+    for (GLsizei i = 0; i < count; i++) {
+        GLint type = 0;
+        glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+        if (type == GL_FRAGMENT_SHADER)
+            _fragSrc = shaderSource(shaders[i]);
+        else if (type == GL_VERTEX_SHADER)
+            _vertSrc = shaderSource(shaders[i]);
+    }
+
+    return !_fragSrc.empty() && !_vertSrc.empty();
+}
+
+std::string ProgramCache::_hashKey(const std::string& _stubFragSrc, const std::string& _stubVertSrc, const std::string& _fragSrc, const std::string& _vertSrc) {
+    size_t driverHash;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        driverHash = m_driverHash;
+    }
+
+    return toHex( std::hash<std::string>()( _stubFragSrc + '\0' + _stubVertSrc + '\0' + _fragSrc + '\0' + _vertSrc + '\0' + toHex(driverHash) ) );
+}
+
+bool ProgramCache::_loadBinary(ada::Shader& _shader, const std::string& _key) {
+    std::string file;
+    std::vector<char> bytes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<std::string, std::vector<char> >::iterator it = m_memory.find(_key);
+        if (it != m_memory.end()) {
+            bytes.swap(it->second);
+            m_memory.erase(it);
+        }
+        else if (!m_folder.empty())
+            file = m_folder + "/" + _key + ".bin";
+    }
+
+    if (bytes.empty() && !file.empty()) {
+        std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+        if (in.is_open())
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    if (bytes.empty())
+        return false;
+
+    std::istringstream in(std::string(bytes.begin(), bytes.end()));
+    char magic[sizeof(program_magic)];
+    uint32_t version = 0;
+    uint64_t driverHash = 0;
+    uint32_t format = 0;
+    uint32_t length = 0;
+    std::vector<char> binary;
+
+    bool ok =   in.read(magic, sizeof(magic)) && memcmp(magic, program_magic, sizeof(magic)) == 0 &&
+                read(in, version) && version == program_version &&
+                read(in, driverHash) && read(in, format) && read(in, length) && length > 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ok = ok && driverHash == (uint64_t)m_driverHash;
+    }
+
+    if (ok) {
+        binary.resize(length);
+        ok = (bool)in.read(&binary[0], length);
+    }
+
+    // the driver has the last word: it refuses binaries of other versions or GPUs on its own
+    if (ok) {
+        GLuint program = _shader.getProgram();
+        glProgramBinary(program, (GLenum)format, &binary[0], (GLsizei)length);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        ok = (linked == GL_TRUE);
+    }
+
+    if (!ok) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rejected++;
+        if (!file.empty())
+            std::remove(file.c_str());
+    }
+
+    return ok;
+}
+
+bool ProgramCache::_saveBinary(GLuint _program, const std::string& _key, bool _memory) {
+    GLint length = 0;
+    glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    std::vector<char> binary(length > 0 ? length : 1);
+    GLsizei written = 0;
+    GLenum format = 0;
+    if (length > 0)
+        glGetProgramBinary(_program, length, &written, &format, &binary[0]);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (written <= 0) {
+        m_unsaved++;
+        return false;
+    }
+
+    std::ostringstream bytes;
+    bytes.write(program_magic, sizeof(program_magic));
+    write<uint32_t>(bytes, program_version);
+    write<uint64_t>(bytes, (uint64_t)m_driverHash);
+    write<uint32_t>(bytes, (uint32_t)format);
+    write<uint32_t>(bytes, (uint32_t)written);
+    bytes.write(&binary[0], written);
+    std::string data = bytes.str();
+
+    if (_memory)
+        m_memory[_key].assign(data.begin(), data.end());
+
+    if (m_folder.empty()) {
+        if (_memory)
+            m_saved++;
+        return _memory;
+    }
+
+    // written aside and moved in place, so another instance never reads half a binary
+    std::string file = m_folder + "/" + _key + ".bin";
+    std::string tmp = file + ".tmp";
+    std::ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(data.c_str(), data.size());
+    out.close();
+
+    std::remove(file.c_str());
+    if (!out.good() || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        m_unsaved++;
+        return _memory;
+    }
+
+    m_saved++;
+    return true;
+}
+#endif
+
+size_t ProgramCache::getHits() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t ProgramCache::getMisses() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+std::string ProgramCache::logStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string log = "";
+
+    log += "folder," + (m_folder.empty() ? std::string("-") : m_folder) + "\n";
+    log += "supported," + std::string(m_supported < 0 ? "-" : (m_supported > 0 ? "yes" : "no")) + "\n";
+    log += "hits," + ada::toString(m_hits) + "\n";
+    log += "misses," + ada::toString(m_misses) + "\n";
+    log += "rejected," + ada::toString(m_rejected) + "\n";
+    log += "saved," + ada::toString(m_saved) + "\n";
+    log += "unsaved," + ada::toString(m_unsaved) + "\n";
+    return log;
+}
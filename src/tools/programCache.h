@@ -0,0 +1,79 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <functional>
+#include <stddef.h>
+
+#include "ada/gl/gl.h"
+#include "ada/gl/shader.h"
+
+#if defined(GL_PROGRAM_BINARY_LENGTH) && !defined(__EMSCRIPTEN__)
+#define SUPPORT_PROGRAM_BINARY
+#endif
+
+/** Keeps the linked binary of every program on a folder so the next start (or reload) of the same
+ *  shaders skips compiling and linking them. A binary is found by a hash of the sources as they
+ *  reach the driver, with ada's #version and #defines already on them, plus the vendor, renderer
+ *  and version of the driver. Those prefixes are read back from a tiny stub program loaded on
+ *  the same ada::Shader first, and it's that stub program the binary is loaded into. Anything
+ *  the driver refuses (other driver, other GPU, a corrupt file) is compiled from source as usual
+ *  and saved again. Programs linked somewhere else (like in the background) can hand their binary
+ *  over to be found by the next load, kept in memory until then. Used from the render thread,
+ *  the counters can be read from any **/
+class ProgramCache {
+public:
+    ProgramCache();
+
+    // An empty folder turns it off. The folder is created if it doesn't exist
+    bool    setFolder(const std::string& _folder);
+    std::string getFolder();
+    bool    isEnabled();
+
+    // The driver can give back and take program binaries, only known once there is a GL context
+    bool    isSupported();
+
+    // Loads _shader from the cache or, when it's not there, with _compile (which loads _fragSrc and
+    // _vertSrc on it through ada) saving the result. _hit tells which of the two it was
+    bool    load(   ada::Shader& _shader, const std::string& _fragSrc, const std::string& _vertSrc,
+                    const std::function<bool()>& _compile, bool& _hit);
+
+    /** For programs compiled outside ada: the sources ada would compile for a shader with _defines
+     *  (the ones of every shader) and _passDefines (space separated NAME or NAME=value), and the
+     *  key load() will look for. False when that can't be known, like for sources with their own #version **/
+    bool    prepare(const std::map<std::string, std::string>& _defines, const std::string& _passDefines,
+                    const std::string& _fragSrc, const std::string& _vertSrc,
+                    std::string& _fullFragSrc, std::string& _fullVertSrc, std::string& _key);
+
+    // Keeps the binary of a linked _program under _key, in memory until load() takes it and on the folder if there is one
+    bool    save(GLuint _program, const std::string& _key);
+    void    clearMemory();
+
+    size_t  getHits();
+    size_t  getMisses();
+
+    // hits, misses, rejected (binaries the driver refused), saved and unsaved (the driver gave none)
+    std::string logStats();
+
+protected:
+    #if defined(SUPPORT_PROGRAM_BINARY)
+    bool    _stubSources(ada::Shader& _shader, std::string& _fragSrc, std::string& _vertSrc);
+    std::string _hashKey(const std::string& _stubFragSrc, const std::string& _stubVertSrc, const std::string& _fragSrc, const std::string& _vertSrc);
+    bool    _loadBinary(ada::Shader& _shader, const std::string& _key);
+    bool    _saveBinary(GLuint _program, const std::string& _key, bool _memory);
+    #endif
+
+    std::mutex      m_mutex;
+    std::string     m_folder;
+    std::map<std::string, std::vector<char> > m_memory;    // per key, the same bytes there would be on a file
+    int             m_supported;    // -1 not checked yet, 0 the driver has no binary formats, 1 caching
+    size_t          m_driverHash;
+
+    size_t          m_hits;
+    size_t          m_misses;
+    size_t          m_rejected;
+    size_t          m_saved;
+    size_t          m_unsaved;
+};
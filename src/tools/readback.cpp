@@ -0,0 +1,132 @@
+#include "readback.h"
+
+#include <string.h>
+
+Readback::Readback(): m_head(0), m_count(0), m_width(0), m_height(0), m_channels(4), m_type(GL_UNSIGNED_BYTE) {
+}
+
+Readback::~Readback() {
+    clear();
+}
+
+bool Readback::allocate(int _width, int _height, int _channels, size_t _depth, size_t _slabs, GLenum _type) {
+    if (_depth < 1)
+        _depth = 1;
+
+    if (isAllocated() &&
+        m_width == _width &&
+        m_height == _height &&
+        m_channels == _channels &&
+        m_type == _type ) {
+
+        // The amount of slabs can change without touching the ring
+        m_pool.allocate(_getSize(), _slabs);
+        if (m_slots.size() == _depth)
+            return false;
+    }
+
+    clear();
+
+    m_width = _width;
+    m_height = _height;
+    m_channels = _channels;
+    m_type = _type;
+    m_slots.resize(_depth);
+    m_pool.allocate(_getSize(), _slabs);
+
+    #if defined(SUPPORT_PBO_READBACK)
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        glGenBuffers(1, &m_slots[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, _getSize(), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    #endif
+
+    return true;
+}
+
+void Readback::clear() {
+    // Don't lose any frame that is still on its way
+    flush();
+
+    #if defined(SUPPORT_PBO_READBACK)
+    for (size_t i = 0; i < m_slots.size(); i++)
+        if (m_slots[i].pbo)
+            glDeleteBuffers(1, &m_slots[i].pbo);
+    #endif
+
+    m_slots.clear();
+    m_head = 0;
+    m_count = 0;
+}
+
+void Readback::read(ReadbackCallback _callback) {
+    if (!isAllocated())
+        return;
+
+    // RGB rows are not 4 bytes aligned
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    #if defined(SUPPORT_PBO_READBACK)
+    // The ring is full, the oldest frame had N frames to finish, so mapping it shouldn't stall
+    if (m_count == m_slots.size())
+        _complete();
+
+    size_t index = (m_head + m_count) % m_slots.size();
+    m_slots[index].callback = _callback;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[index].pbo);
+    glReadPixels(0, 0, m_width, m_height, _getFormat(), m_type, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_count++;
+
+    #else
+    Pixels pixels = m_pool.acquire();
+    glReadPixels(0, 0, m_width, m_height, _getFormat(), m_type, pixels.get());
+    _callback( std::move(pixels) );
+
+    #endif
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+void Readback::flush() {
+    while (m_count > 0)
+        _complete();
+}
+
+void Readback::_complete() {
+    if (m_count == 0)
+        return;
+
+    Slot& slot = m_slots[m_head];
+
+    // If every slab is still being saved, this is where the capture waits for one
+    Pixels pixels = m_pool.acquire();
+
+    #if defined(SUPPORT_PBO_READBACK)
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+
+        #if defined(GL_ES_VERSION_3_0)
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, _getSize(), GL_MAP_READ_BIT);
+        #else
+    void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        #endif
+
+    if (data) {
+        memcpy(pixels.get(), data, _getSize());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    #endif
+
+    m_head = (m_head + 1) % m_slots.size();
+    m_count--;
+
+    ReadbackCallback callback = std::move(slot.callback);
+    slot.callback = nullptr;
+    if (callback)
+        callback( std::move(pixels) );
+}
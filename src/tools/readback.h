@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "ada/gl/gl.h"
+#include "pixelsPool.h"
+
+#if defined(GL_PIXEL_PACK_BUFFER) && !defined(__EMSCRIPTEN__)
+#define SUPPORT_PBO_READBACK
+#endif
+
+#if !defined(GL_HALF_FLOAT) && defined(GL_HALF_FLOAT_OES)
+#define GL_HALF_FLOAT GL_HALF_FLOAT_OES
+#endif
+
+typedef std::function<void(Pixels&&)> ReadbackCallback;
+
+/** N-deep ring of pixel buffer objects. Every read() issues an asynchronous glReadPixels
+ *  of the bound framebuffer into its own PBO, and that PBO is only mapped when the ring
+ *  wraps around (N frames later) or on flush(). Once mapped, the pixels are handed to the
+ *  callback given on read(), always in the same order frames were read, inside a slab of
+ *  the ring's PixelsPool. On platforms without PBOs it falls back to a blocking read.
+ *  Pixels are GL_UNSIGNED_BYTE by default, or any other type glReadPixels can convert to,
+ *  like GL_HALF_FLOAT for HDR captures. **/
+class Readback {
+public:
+    Readback();
+    virtual ~Readback();
+
+    // (Re)allocates the ring and the pool of slabs. If something changes, pending frames are flushed first. True if the ring was (re)allocated
+    bool    allocate(int _width, int _height, int _channels, size_t _depth = 3, size_t _slabs = 8, GLenum _type = GL_UNSIGNED_BYTE);
+    bool    isAllocated() const { return m_slots.size() > 0; }
+    void    clear();
+
+    // Reads the currently bound framebuffer
+    void    read(ReadbackCallback _callback);
+
+    // Maps and delivers all the pending frames
+    void    flush();
+
+    int     getWidth() const { return m_width; }
+    int     getHeight() const { return m_height; }
+    int     getChannels() const { return m_channels; }
+    GLenum  getType() const { return m_type; }
+    size_t  getDepth() const { return m_slots.size(); }
+    size_t  getPending() const { return m_count; }
+    size_t  getBytesPerPixel() const { return m_channels * _getBytes(); }
+
+    PixelsPool& getPool() { return m_pool; }
+
+protected:
+    struct Slot {
+        GLuint              pbo = 0;
+        ReadbackCallback    callback;
+    };
+
+    void    _complete();
+    GLenum  _getFormat() const { return (m_channels == 3) ? GL_RGB : GL_RGBA; }
+    size_t  _getSize() const { return (size_t)m_width * m_height * m_channels * _getBytes(); }
+    size_t  _getBytes() const { return (m_type == GL_UNSIGNED_BYTE) ? 1 : (m_type == GL_FLOAT) ? 4 : 2; }
+
+    PixelsPool          m_pool;
+    std::vector<Slot>   m_slots;
+    size_t              m_head;
+    size_t              m_count;
+
+    int                 m_width;
+    int                 m_height;
+    int                 m_channels;
+    GLenum              m_type;
+};
@@ -4,26 +4,45 @@
 #include <string.h>
 
 #include <cstdio>
+#include <algorithm>
 #include <atomic>
+#include <mutex>
 #include <thread>
 #include <chrono>
 
 #include "ada/fs.h"
 #include "ada/string.h"
 
-#include "lockFreeQueue.h"
+#include "ringBuffer.h"
+#include "tracker.h"
+#include "videoEncoder.h"
 #include "console.h"
 
 #if defined( _WIN32 )
+#include <io.h>
+#include <fcntl.h>
 #define P_CLOSE( file ) _pclose( file )
 #define P_OPEN( cmd ) _popen( cmd, "wb" )  // write binary?
+#define STDOUT_BINARY() _setmode( _fileno( stdout ), _O_BINARY )
 #else
 #define P_CLOSE( file ) pclose( file )
 #define P_OPEN( cmd ) popen( cmd, "w" )
+#define STDOUT_BINARY()
 #endif
 
 float fdelta = 0.04166666667f;
-size_t counter = 0;
+size_t counter = 0;     // index of the frame being rendered
+size_t rendered = 0;    // frames rendered by this process
+
+// Split the frames of a sequence between processes, this one renders every shard_total'th frame from shard_index
+size_t shard_index = 0;
+size_t shard_total = 1;
+
+// Extension of the images of a sequence: png, or hdr/exr for half float captures
+std::string frame_format = "png";
+
+// Wall clock, to know how fast frames are produced
+std::chrono::steady_clock::time_point rec_start;
 
 // PNG Sequence by secs
 float sec_start = 0.0f;
@@ -37,23 +56,85 @@ size_t frame_head = 0;
 size_t frame_end = 0;
 bool   frame = false;
 
-#if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
+#if defined(SUPPORT_RECORDING_PIPE)
 
 // Video by Seconds
 using Clock         = std::chrono::steady_clock;
 using TimePoint     = std::chrono::time_point<Clock>;
 using Seconds       = std::chrono::duration<float>;
 
+enum PipeMode {
+    PIPE_FFMPEG = 0,    // popen'd ffmpeg (or the in-process encoder)
+    PIPE_Y4M,           // YUV4MPEG2 stream
+    PIPE_RAW            // raw frames, top to bottom
+};
+
 FILE*                       pipe = nullptr;
+PipeMode                    pipe_mode = PIPE_FFMPEG;
+std::streambuf*             pipe_cout = nullptr;    // std::cout while it's redirected to std::cerr
 std::atomic<bool>           pipe_isRecording;
+bool                        pipe_isCapturing = false;
+size_t                      pipe_counter = 0;
 std::thread                 pipe_thread;
+std::mutex                  pipe_threadMutex;       // the render and the stream command threads both join it
 RecordingSettings           pipe_settings;
 
 TimePoint                   pipe_start;
 TimePoint                   pipe_lastFrame;
-LockFreeQueue               pipe_frames;
+RingBuffer<Pixels>          pipe_frames(128);
+std::atomic<size_t>         pipe_maxQueue(0);
+
+// In-process encoder, when it's open frames don't go through the ffmpeg pipe. VideoEncoder isn't
+// thread safe, the render thread only looks at pipe_encoderOpen, cleared before the writer closes it
+VideoEncoder                pipe_encoder;
+std::atomic<bool>           pipe_encoderOpen(false);
+
+Tracker*                    pipe_tracker = nullptr;
+
+bool recordingPipeValid() { return pipe != nullptr || pipe_encoderOpen.load(); }
+bool recordingPipe() { return (pipe_isRecording.load() && pipe_isCapturing && recordingPipeValid()); }
 
-bool recordingPipe() { return (pipe != nullptr && pipe_isRecording.load()); }
+const RecordingSettings& recordingPipeSettings() { return pipe_settings; }
+void recordingSetTracker(Tracker* _tracker) { pipe_tracker = _tracker; }
+
+size_t recordingPipeFrameSize() {
+    if ( pipe_settings.src_yuv )
+        return pipe_settings.src_width * pipe_settings.src_height * 3 / 2;
+    return pipe_settings.src_width * pipe_settings.src_height * pipe_settings.src_channels;
+}
+
+void _recordingPipeCloseFile() {
+    if ( pipe == nullptr )
+        return;
+
+    if ( pipe_mode == PIPE_FFMPEG )
+        P_CLOSE( pipe );
+    else if ( pipe == stdout )
+        // std::cout is given back by recordingStreamClose(), from the thread that took it
+        fflush( pipe );
+    else
+        fclose( pipe );
+    pipe = nullptr;
+}
+
+void _recordingPipeJoin() {
+    std::lock_guard<std::mutex> lock( pipe_threadMutex );
+    if ( pipe_thread.joinable() )
+        pipe_thread.join();
+}
+
+void _recordingPipeStart(float _start, float _end) {
+    fdelta = 1.0/pipe_settings.src_fps;
+    counter = 0;
+    rendered = 0;
+    pipe_counter = 0;
+    rec_start = std::chrono::steady_clock::now();
+    pipe_maxQueue = 0;
+
+    sec_start = _start;
+    sec_head = _start;
+    sec_end = _end;
+}
 
 // From https://github.com/tyhenry/ofxFFmpeg
 bool recordingPipeOpen(const RecordingSettings& _settings, float _start, float _end) {
@@ -92,12 +173,18 @@ bool recordingPipeOpen(const RecordingSettings& _settings, float _start, float _
     if ( pipe_settings.ffmpegPath.empty() )
         pipe_settings.ffmpegPath = "ffmpeg";
 
-    fdelta = 1.0/pipe_settings.src_fps;
-    counter = 0;
+    _recordingPipeCloseFile();
+    pipe_mode = PIPE_FFMPEG;
+    _recordingPipeStart(_start, _end);
 
-    sec_start = _start;
-    sec_head = _start;
-    sec_end = _end;
+    if ( !pipe_settings.trg_codec.empty() ) {
+        if ( pipe_encoder.open(pipe_settings) ) {
+            pipe_encoderOpen = true;
+            pipe_isCapturing = true;
+            return pipe_isRecording = true;
+        }
+        std::cerr << "Can't encode " << pipe_settings.trg_path << " in-process, falling back to " << pipe_settings.ffmpegPath << std::endl;
+    }
 
     std::string cmd = pipe_settings.ffmpegPath;
     std::vector<std::string> args = {
@@ -114,7 +201,9 @@ bool recordingPipeOpen(const RecordingSettings& _settings, float _start, float _
         "-s " + std::to_string( pipe_settings.src_width ) +     // input resolution width
             "x" + std::to_string( pipe_settings.src_height ),   // input resolution height
         "-f rawvideo",                                          // input codec
-        "-pix_fmt rgb24",                                       // input pixel format
+        pipe_settings.src_yuv ? "-pix_fmt yuv420p" : "-pix_fmt rgb24",  // input pixel format
+        pipe_settings.src_yuv ? std::string("-color_range ") + (pipe_settings.src_yuv_full ? "pc" : "tv") : "",
+        pipe_settings.src_yuv ? std::string("-colorspace ") + (pipe_settings.src_yuv == 709 ? "bt709" : "smpte170m") : "",
         pipe_settings.src_args,                                 // custom input args
         "-i pipe:",                                             // input source (default pipe)
 
@@ -128,9 +217,6 @@ bool recordingPipeOpen(const RecordingSettings& _settings, float _start, float _
 
     // std::cout << cmd << std::endl; 
 
-    if ( pipe != nullptr )
-        P_CLOSE( pipe );
-
     pipe = P_OPEN( cmd.c_str() );
 
     if ( !pipe ) {
@@ -143,51 +229,178 @@ bool recordingPipeOpen(const RecordingSettings& _settings, float _start, float _
         return false;
     }
 
+    pipe_isCapturing = true;
     return pipe_isRecording = true;
 }
 
-void processFrame() {
-    while ( pipe_isRecording.load() ) {
+bool recordingStreamOpen(const RecordingSettings& _settings, float _start, float _end) {
+    if (pipe_isRecording.load()) {
+        std::cout << "Can't start streaming - already started." << std::endl;
+        return false;
+    }
 
-        TimePoint lastFrameTime = Clock::now();
-        const float framedur    = 1.f / pipe_settings.src_fps;
+    if (pipe_frames.size() > 0) {
+        std::cerr << "Can't start streaming - previous recording is still processing." << std::endl;
+        return false;
+    }
 
-        while ( pipe_frames.size() ) {  // allows finish processing queue after we call stop()
+    pipe_settings = _settings;
 
-            // feed frames at constant fps
-            float delta = Seconds( Clock::now() - lastFrameTime ).count();
+    _recordingPipeCloseFile();
+    pipe_mode = ada::haveExt(pipe_settings.trg_path, "y4m") ? PIPE_Y4M : PIPE_RAW;
 
-            if ( delta >= framedur ) {
-                
-                if ( !pipe_isRecording.load() ) {
-                    console_clear();
-                    std::cout << "Don't close. Recording stopped, but still processing " << pipe_frames.size() << " frames" << std::endl;
-                }
+    if ( pipe_settings.trg_path == "-" || pipe_settings.trg_path == "stdout" ) {
+        // Frames get stdout, while the stream is open messages go to stderr
+        std::cout.flush();
+        pipe_cout = std::cout.rdbuf( std::cerr.rdbuf() );
+        STDOUT_BINARY();
+        pipe = stdout;
+    }
+    else
+        // on a named pipe this waits until someone opens the other end
+        pipe = fopen( pipe_settings.trg_path.c_str(), "wb" );
 
-                Pixels pixels;
-                if ( pipe_frames.consume( std::move( pixels ) ) && pixels ) {
-                    std::unique_ptr<unsigned char[]> data = std::move( pixels );
-                    const size_t dataLength = pipe_settings.src_width * pipe_settings.src_height * pipe_settings.src_channels;
-                    const size_t written = pipe ? fwrite( data.get(), sizeof( char ), dataLength, pipe ) : 0;
+    if ( !pipe ) {
+        std::cerr << "Unable to open " << pipe_settings.trg_path << " for streaming." << std::endl;
+        recordingStreamClose();
+        return false;
+    }
+    setvbuf( pipe, NULL, _IOFBF, 1024 * 1024 );
+
+    if ( pipe_mode == PIPE_Y4M ) {
+        std::string header = "YUV4MPEG2";
+        header += " W" + ada::toString( (int)pipe_settings.src_width );
+        header += " H" + ada::toString( (int)pipe_settings.src_height );
+        header += " F" + ada::toString( (int)(pipe_settings.src_fps * 1000.0f + 0.5f) ) + ":1000";
+        header += " Ip A1:1";
+        header += pipe_settings.src_yuv ? " C420jpeg" : " C444";
+        header += (pipe_settings.src_yuv && pipe_settings.src_yuv_full) ? " XCOLORRANGE=FULL" : " XCOLORRANGE=LIMITED";
+        header += "\n";
+        fwrite( header.c_str(), sizeof( char ), header.size(), pipe );
+    }
+    else {
+        std::cerr << "Streaming " << pipe_settings.src_width << "x" << pipe_settings.src_height << " " << (pipe_settings.src_yuv ? "yuv420p" : (pipe_settings.src_channels == 4 ? "rgba" : "rgb24"));
+        std::cerr << " frames at " << pipe_settings.src_fps << "fps into " << pipe_settings.trg_path << std::endl;
+    }
 
-                    if ( written <= 0 )
-                        std::cout << "Unable to write the frame." << std::endl;
+    _recordingPipeStart(_start, _end);
+    pipe_isCapturing = true;
+    return pipe_isRecording = true;
+}
 
-                    lastFrameTime = Clock::now();
-                }
+// OpenGL rows go bottom up, streams top to bottom
+size_t _writeFlipped( const unsigned char* _data, size_t _rowSize, size_t _rows ) {
+    size_t written = 0;
+    for ( size_t i = 0; i < _rows; i++ )
+        written += fwrite( _data + (_rows - 1 - i) * _rowSize, sizeof( char ), _rowSize, pipe );
+    return written;
+}
 
-                console_refresh();
+size_t _streamFrame( const unsigned char* _data, std::vector<unsigned char>& _planes ) {
+    const size_t width = pipe_settings.src_width;
+    const size_t height = pipe_settings.src_height;
+    size_t written = 0;
+
+    if ( pipe_mode == PIPE_Y4M )
+        fwrite( "FRAME\n", sizeof( char ), 6, pipe );
+
+    if ( pipe_settings.src_yuv ) {
+        // planar yuv420p, converted on the GPU
+        const unsigned char* u = _data + width * height;
+        const unsigned char* v = u + (width / 2) * (height / 2);
+        written += _writeFlipped( _data, width, height );
+        written += _writeFlipped( u, width / 2, height / 2 );
+        written += _writeFlipped( v, width / 2, height / 2 );
+    }
+    else if ( pipe_mode == PIPE_Y4M ) {
+        // YUV4MPEG2 has no RGB, so convert it to 4:4:4 BT.601 limited range
+        const size_t channels = pipe_settings.src_channels;
+        const size_t size = width * height;
+        _planes.resize( size * 3 );
+        for ( size_t y = 0; y < height; y++ ) {
+            const unsigned char* src = _data + (height - 1 - y) * width * channels;
+            for ( size_t x = 0; x < width; x++, src += channels ) {
+                float r = src[0], g = src[1], b = src[2];
+                size_t i = y * width + x;
+                _planes[i]            = (unsigned char)( 16.0f + ( 65.481f * r + 128.553f * g +  24.966f * b) / 255.0f + 0.5f);
+                _planes[size + i]     = (unsigned char)(128.0f + (-37.797f * r -  74.203f * g + 112.000f * b) / 255.0f + 0.5f);
+                _planes[size * 2 + i] = (unsigned char)(128.0f + (112.000f * r -  93.786f * g -  18.214f * b) / 255.0f + 0.5f);
             }
         }
+        written += fwrite( _planes.data(), sizeof( char ), _planes.size(), pipe );
+    }
+    else
+        written += _writeFlipped( _data, width * pipe_settings.src_channels, height );
+
+    return written;
+}
+
+void processFrame() {
+    const size_t dataLength = recordingPipeFrameSize();
+    std::vector<unsigned char> planes;
+
+    // keep going until the recording ended AND every queued frame was written
+    while ( pipe_isRecording.load() || !pipe_frames.empty() ) {
+
+        // sleep until there is a frame, wake up from time to time to check if the recording ended
+        Pixels pixels;
+        if ( !pipe_frames.consume( pixels, 100 ) || !pixels )
+            continue;
+
+        if ( !pipe_isRecording.load() ) {
+            console_clear();
+            std::cout << "Don't close. Recording stopped, but still processing " << pipe_frames.size() << " frames" << std::endl;
+            console_refresh();
+        }
+
+        if ( pipe_tracker && pipe_tracker->isRunning() )
+            pipe_tracker->setThreadName("record");
+        TrackerScope track(pipe_tracker, "record:write");
+
+        // ffmpeg takes the frame rate from -r, so frames are written as fast as it can take them.
+        // Once written the pixels go back to their pool
+        if ( pipe_encoderOpen.load() ) {
+            if ( !pipe_encoder.encode( pixels.get() ) )
+                std::cout << "Unable to encode the frame." << std::endl;
+        }
+        else if ( pipe_mode != PIPE_FFMPEG ) {
+            // a slow reader blocks fwrite, which fills the ring, which makes the capture wait
+            if ( pipe && _streamFrame( pixels.get(), planes ) <= 0 )
+                std::cout << "Unable to stream the frame." << std::endl;
+        }
+        else {
+            const size_t written = pipe ? fwrite( pixels.get(), sizeof( char ), dataLength, pipe ) : 0;
+            if ( written <= 0 )
+                std::cout << "Unable to write the frame." << std::endl;
+        }
+    }
+
+    console_clear();
+    std::cout << "Don't close. Encoding data into " << pipe_settings.trg_path << std::endl;
+    console_refresh();
+
+    if ( pipe_encoderOpen.exchange(false) ) {
+        size_t frames = pipe_encoder.getFrames();
+        double avgMs = pipe_encoder.getAverageMs();
+        double maxMs = pipe_encoder.getMaxMs();
+        bool ok = pipe_encoder.close();
 
         console_clear();
-        std::cout << "Don't close. Encoding data into " << pipe_settings.trg_path << std::endl;
+        if ( ok )
+            std::cout << "Finish saving " << pipe_settings.trg_path << " (" << pipe_encoder.getCodecName() << ", " << frames << " frames, " << avgMs << "ms avg / " << maxMs << "ms max per frame, " << pipe_maxQueue << " frames max in queue)" << std::endl;
+        else
+            std::cerr << "Error finishing " << pipe_settings.trg_path << std::endl;
         console_refresh();
+    }
 
+    if ( pipe && pipe_mode != PIPE_FFMPEG ) {
+        console_clear();
+        _recordingPipeCloseFile();
+        std::cerr << "Finish streaming " << pipe_settings.trg_path << std::endl;
+        console_refresh();
     }
+
     // close ffmpeg pipe once stopped recording
-    
-    
     if ( pipe ) {
         console_clear();
         if ( P_CLOSE( pipe ) < 0 ) {
@@ -206,26 +419,40 @@ void processFrame() {
     counter = 0;
 }
 
-size_t recordingPipeFrame( std::unique_ptr<unsigned char[]>&& _pixels ) {
+size_t recordingPipeFrame( Pixels&& _pixels ) {
     if ( !pipe_isRecording ) {
         std::cerr << "Can't add new frame - not in recording mode." << std::endl;
         return 0;
     }
 
-    if ( !pipe ) {
+    if ( !recordingPipeValid() ) {
         std::cerr << "Can't add new frame - FFmpeg pipe is invalid!" << std::endl;
         return 0;
     }
 
-    if ( counter == 0 ) {
+    // Frames can arrive a few frames late (asynchronous readback), so don't rely on the recording counter
+    if ( pipe_counter == 0 ) {
+        std::lock_guard<std::mutex> lock( pipe_threadMutex );
         if ( pipe_thread.joinable() ) pipe_thread.join();  //detach();
         pipe_thread     = std::thread( &processFrame );
         pipe_start      = Clock::now();
         pipe_lastFrame  = pipe_start;
     }
 
-    pipe_frames.produce( std::move(_pixels) );
+    // the writing thread is behind, wait for it rather than dropping frames
+    while ( !pipe_frames.produce( _pixels, 100 ) ) {
+        if ( !pipe_thread.joinable() ) {
+            std::cerr << "Can't add new frame - FFmpeg pipe is not being written." << std::endl;
+            return 0;
+        }
+    }
     pipe_lastFrame = Clock::now();
+    pipe_counter++;
+
+    // how far behind the encoder is
+    size_t queue = pipe_frames.size();
+    if ( queue > pipe_maxQueue.load() )
+        pipe_maxQueue = queue;
 
     size_t written              = 0;
 
@@ -257,15 +484,36 @@ size_t recordingPipeFrame( std::unique_ptr<unsigned char[]>&& _pixels ) {
     return written;
 }
 
+void recordingPipeEnd() {
+    pipe_isCapturing = false;
+    pipe_isRecording = false;
+}
+
 void recordingPipeClose() {
     frame = false;
     sec = false;
+    recordingPipeEnd();
+    _recordingPipeJoin();
 
-    if ( pipe_thread.joinable() ) 
-        pipe_thread.join();
+    // no frame ever arrived to start the encoding thread
+    if ( pipe_encoderOpen.exchange(false) )
+        pipe_encoder.close();
 
-    if ( pipe != nullptr )
-        P_CLOSE( pipe );
+    _recordingPipeCloseFile();
+}
+
+void recordingStreamClose() {
+    // the last frames are still arriving
+    while ( pipe_isRecording.load() )
+        std::this_thread::sleep_for( std::chrono::milliseconds(10) );
+
+    // once the writer is joined nobody else writes to stdout
+    _recordingPipeJoin();
+
+    if ( pipe_cout ) {
+        std::cout.rdbuf( pipe_cout );
+        pipe_cout = nullptr;
+    }
 }
 
 #else
@@ -275,43 +523,82 @@ bool    recordingPipe() { return false; };
 
 // ---------------------------------------------------------------------------
 
+void recordingSetShard(size_t _index, size_t _total) {
+    shard_total = std::max((size_t)1, _total);
+    shard_index = std::min(_index, shard_total - 1);
+}
+
+size_t getRecordingShardIndex() { return shard_index; }
+size_t getRecordingShardTotal() { return shard_total; }
+
+void recordingSetFrameFormat(const std::string& _format) { frame_format = _format; }
+std::string getRecordingFrameFormat() { return frame_format; }
+
 void recordingStartSecs(float _start, float _end, float _fps) {
     fdelta = 1.0/_fps;
-    counter = 0;
+    rendered = 0;
+    rec_start = std::chrono::steady_clock::now();
+
+    // A shard starts on its own frame and then jumps over the ones rendered by the others
+    counter = shard_index;
 
     sec_start = _start;
-    sec_head = _start;
+    sec_head = sec_start + counter * fdelta;
     sec_end = _end;
-    sec = true;
+    sec = (counter == 0 || sec_head < sec_end);
 }
 
 void recordingStartFrames(int _start, int _end, float _fps) {
     fdelta = 1.0/_fps;
-    counter = 0;
+    rendered = 0;
+    rec_start = std::chrono::steady_clock::now();
+
+    counter = shard_index;
 
     frame_start = _start;
-    frame_head = _start;
+    frame_head = frame_start + counter;
     frame_end = _end;
-    frame = true;
+    frame = (counter == 0 || frame_head < frame_end);
+}
+
+size_t recordingCountSecs(float _start, float _end, float _fps) {
+    float delta = 1.0/_fps;
+    size_t total = 1;
+    while (_start + total * delta < _end)
+        total++;
+    return total;
+}
+
+size_t recordingCountFrames(int _start, int _end) {
+    return (_end > _start) ? _end - _start : 1;
+}
+
+std::string recordingFrameFile(size_t _index) {
+    return ada::toString( (int)_index, 0, 5, '0') + "." + frame_format;
 }
 
 void recordingFrameAdded() {
-    counter++;
+    rendered++;
 
     if (sec) {
-        sec_head += fdelta;
+        // Time is computed from the frame index and not accumulated, so every shard lands on the same values
+        counter += shard_total;
+        sec_head = sec_start + counter * fdelta;
         if (sec_head >= sec_end)
             sec = false;
     }
-    #if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
+    #if defined(SUPPORT_RECORDING_PIPE)
     else if (recordingPipe()) {
-        sec_head += fdelta;
+        counter++;
+        sec_head = sec_start + counter * fdelta;
+        // Stop capturing, but keep the pipe open until the pending frames are added and recordingPipeEnd() is called
         if (sec_head >= sec_end)
-            pipe_isRecording = false;
+            pipe_isCapturing = false;
     }
     #endif
     else if (frame) {
-        frame_head++;
+        counter += shard_total;
+        frame_head = frame_start + counter;
         if (frame_head >= frame_end)
             frame = false;
     }
@@ -320,6 +607,8 @@ void recordingFrameAdded() {
 bool isRecording() { return sec || frame || recordingPipe(); }
 
 int getRecordingCount() { return counter; }
+int getRecordingRendered() { return rendered; }
+float getRecordingElapsed() { return std::chrono::duration<float>(std::chrono::steady_clock::now() - rec_start).count(); }
 float getRecordingDelta() { return fdelta; }
 
 float getRecordingPercentage() {
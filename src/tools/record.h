@@ -3,7 +3,16 @@
 #include <string>
 #include <memory>
 
-#if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
+#include "pixelsPool.h"
+
+class Tracker;
+
+// Frames handed to a thread that pipes them into ffmpeg, encodes them or streams them
+#if !defined(__EMSCRIPTEN__)
+#define SUPPORT_RECORDING_PIPE
+#endif
+
+#if defined(SUPPORT_RECORDING_PIPE)
 struct RecordingSettings {
     std::string ffmpegPath      = "ffmpeg";
     std::string src_args        = "";
@@ -12,29 +21,70 @@ struct RecordingSettings {
     size_t      src_channels    = 3;
     float       src_fps         = 24.0f;
 
+    // 0 reads back RGB. 601 or 709 converts to planar yuv420p on the GPU with that matrix before reading back
+    int         src_yuv         = 0;
+    bool        src_yuv_full    = false;    // full (pc) or limited (tv) range
+
     size_t      trg_width       = 512;
     size_t      trg_height      = 512;
     float       trg_fps         = 24.0f;
 
     std::string trg_args        = "-pix_fmt yuv420p -vsync 1 -g 1";  // -crf 0 -preset ultrafast -tune zerolatency setpts='(RTCTIME - RTCSTART) / (TB * 1000000)'
     std::string trg_path        = "output.mp4";
+
+    // In-process encoder (libavcodec). When trg_codec is empty, or the file can't be encoded
+    // in-process, frames are piped into ffmpegPath using the args above
+    std::string trg_codec       = "";
+    std::string trg_pix_fmt     = "yuv420p";
+    size_t      trg_bitrate     = 0;    // kbits/s, 0 = codec default
+    int         trg_crf         = -1;   // -1 = codec default
+    int         trg_gop         = 1;
 };
 
 bool    recordingPipeOpen(const RecordingSettings& _settings, float _start, float _end);
-size_t  recordingPipeFrame( std::unique_ptr<unsigned char[]>&& _pixels );
+
+// Writes uncompressed frames to trg_path ("-" for stdout, a named pipe or a file) as a
+// YUV4MPEG2 stream when it ends on .y4m, or as raw rgba/yuv420p frames otherwise
+bool    recordingStreamOpen(const RecordingSettings& _settings, float _start, float _end);
+// Waits for the stream to be written and gives stdout back to std::cout, call it from the thread that opened it
+void    recordingStreamClose();
+
+const RecordingSettings& recordingPipeSettings();
+size_t  recordingPipeFrameSize();
+size_t  recordingPipeFrame( Pixels&& _pixels );
+void    recordingPipeEnd();
 void    recordingPipeClose();
+
+// The thread that writes or encodes the frames reports each one to it as "record:write"
+void    recordingSetTracker(Tracker* _tracker);
 #endif
 bool    recordingPipe();
 
+// Renders only the frames i, i+N, i+2N... of the next sequences, so N processes can split them
+void    recordingSetShard(size_t _index, size_t _total);
+size_t  getRecordingShardIndex();
+size_t  getRecordingShardTotal();
+
+// png (default), hdr or exr
+void    recordingSetFrameFormat(const std::string& _format);
+std::string getRecordingFrameFormat();
+
 void    recordingStartSecs(float _start, float _end, float _fps);
 void    recordingStartFrames(int _start, int _end, float _fps);
 
+// How many frames a full (not sharded) sequence has and the name of each one
+size_t  recordingCountSecs(float _start, float _end, float _fps);
+size_t  recordingCountFrames(int _start, int _end);
+std::string recordingFrameFile(size_t _index);
+
 void    recordingFrameAdded();
 
 bool    isRecording();
 
 float   getRecordingPercentage();
 int     getRecordingCount();
+int     getRecordingRendered();
+float   getRecordingElapsed();  // wall clock seconds since the recording started
 float   getRecordingDelta();
 int     getRecordingFrame();
 float   getRecordingTime();
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "replay.h"
+
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+namespace {
+
+const char      replay_magic[8] = { 'G', 'V', 'R', 'E', 'P', 'L', 'A', 'Y' };
+const uint32_t  replay_version = 1;
+const uint32_t  replay_maxCommand = 1 << 20;    // a console line, anything longer is a corrupt size
+
+std::mutex                  replay_mutex;
+
+// Recording
+std::ofstream               rec_file;
+std::atomic<bool>           rec_isRecording(false);
+uint32_t                    rec_frame = 0;      // the next one to be rendered
+size_t                      rec_frames = 0;
+
+// Playback
+std::vector<ReplayEvent>    play_events;
+size_t                      play_head = 0;
+size_t                      play_frames = 0;
+size_t                      play_played = 0;
+std::atomic<bool>           play_isReplaying(false);
+ReplayEvent                 play_current;
+
+template <typename T>
+void write(const T& _value) {
+    rec_file.write((const char*)&_value, sizeof(T));
+}
+
+template <typename T>
+bool read(std::ifstream& _file, T& _value) {
+    return (bool)_file.read((char*)&_value, sizeof(T));
+}
+
+void writeHeader(ReplayEventType _type) {
+    write<uint8_t>((uint8_t)_type);
+    write<uint32_t>(rec_frame);
+}
+
+}
+
+bool replayRecordStart(const std::string& _file, size_t _frame) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (rec_isRecording.load() || play_isReplaying.load())
+        return false;
+
+    rec_file.open(_file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!rec_file.is_open())
+        return false;
+
+    rec_file.write(replay_magic, sizeof(replay_magic));
+    write<uint32_t>(replay_version);
+
+    rec_frame = (uint32_t)_frame;
+    rec_frames = 0;
+    rec_isRecording.store(true);
+    return true;
+}
+
+void replayRecordFrame(size_t _frame, float _time, float _delta, float _mouseX, float _mouseY) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!rec_isRecording.load())
+        return;
+
+    rec_frame = (uint32_t)_frame;
+    writeHeader(REPLAY_FRAME);
+    write<float>(_time);
+    write<float>(_delta);
+    write<float>(_mouseX);
+    write<float>(_mouseY);
+
+    // what comes in while this one renders applies to the next
+    rec_frame++;
+    rec_frames++;
+}
+
+void replayRecordCommand(const std::string& _command) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!rec_isRecording.load())
+        return;
+
+    writeHeader(REPLAY_COMMAND);
+    write<uint32_t>((uint32_t)_command.size());
+    rec_file.write(_command.c_str(), _command.size());
+}
+
+void replayRecordMouseDrag(float _x, float _y, float _velX, float _velY, int _button) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!rec_isRecording.load())
+        return;
+
+    writeHeader(REPLAY_MOUSE_DRAG);
+    write<float>(_x);
+    write<float>(_y);
+    write<float>(_velX);
+    write<float>(_velY);
+    write<int32_t>(_button);
+}
+
+void replayRecordScroll(float _offset) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!rec_isRecording.load())
+        return;
+
+    writeHeader(REPLAY_SCROLL);
+    write<float>(_offset);
+}
+
+void replayRecordResize(int _width, int _height) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!rec_isRecording.load())
+        return;
+
+    writeHeader(REPLAY_RESIZE);
+    write<int32_t>(_width);
+    write<int32_t>(_height);
+}
+
+size_t replayRecordStop() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!rec_isRecording.load())
+        return 0;
+
+    rec_isRecording.store(false);
+    rec_file.close();
+    return rec_frames;
+}
+
+bool isReplayRecording() { return rec_isRecording.load(); }
+
+bool replayPlayStart(const std::string& _file) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (rec_isRecording.load() || play_isReplaying.load())
+        return false;
+
+    std::ifstream file(_file.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[sizeof(replay_magic)];
+    uint32_t version = 0;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, replay_magic, sizeof(magic)) != 0 ||
+        !read(file, version) || version != replay_version) {
+        std::cerr << "// " << _file << " is not a replay log" << std::endl;
+        return false;
+    }
+
+    // sizes read from the file are checked against what's left of it
+    std::streampos start = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streampos end = file.tellg();
+    file.seekg(start);
+
+    play_events.clear();
+    play_frames = 0;
+
+    uint8_t type;
+    while (read(file, type)) {
+        ReplayEvent event;
+        event.type = (ReplayEventType)type;
+        bool ok = read(file, event.frame);
+
+        if (event.type == REPLAY_FRAME) {
+            for (size_t i = 0; i < 4 && ok; i++)
+                ok = read(file, event.values[i]);
+            play_frames++;
+        }
+        else if (event.type == REPLAY_COMMAND) {
+            uint32_t size = 0;
+            ok = ok && read(file, size) && size <= replay_maxCommand && (std::streamoff)size <= end - file.tellg();
+            if (ok) {
+                event.command.resize(size);
+                ok = size == 0 || (bool)file.read(&event.command[0], size);
+            }
+        }
+        else if (event.type == REPLAY_MOUSE_DRAG) {
+            for (size_t i = 0; i < 4 && ok; i++)
+                ok = read(file, event.values[i]);
+            ok = ok && read(file, event.ints[0]);
+        }
+        else if (event.type == REPLAY_SCROLL)
+            ok = ok && read(file, event.values[0]);
+        else if (event.type == REPLAY_RESIZE)
+            ok = ok && read(file, event.ints[0]) && read(file, event.ints[1]);
+        else
+            ok = false;
+
+        // a log cut short (the process was killed while recording) or corrupt plays up to the last complete event
+        if (!ok) {
+            if (event.type == REPLAY_FRAME)
+                play_frames--;
+            break;
+        }
+
+        play_events.push_back(event);
+    }
+
+    play_head = 0;
+    play_played = 0;
+    play_current = ReplayEvent();
+    play_isReplaying.store(play_frames > 0);
+    return play_frames > 0;
+}
+
+bool replayPlayFrame(std::vector<ReplayEvent>& _events) {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!play_isReplaying.load())
+        return false;
+
+    while (play_head < play_events.size()) {
+        const ReplayEvent& event = play_events[play_head++];
+        if (event.type == REPLAY_FRAME) {
+            play_current = event;
+            play_played++;
+            return true;
+        }
+        _events.push_back(event);
+    }
+
+    // what came after the last frame was never rendered
+    return false;
+}
+
+void replayPlayStop() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    play_isReplaying.store(false);
+    play_events.clear();
+    play_head = 0;
+}
+
+bool isReplaying() { return play_isReplaying.load(); }
+
+float getReplayPercentage() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (!play_isReplaying.load() || play_frames == 0)
+        return 1.0f;
+    return (float)play_played / (float)play_frames;
+}
+
+int getReplayFrame() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    return (int)play_current.frame;
+}
+
+float getReplayTime() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    return play_current.values[0];
+}
+
+float getReplayDelta() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    return play_current.values[1];
+}
+
+float getReplayMouseX() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    return play_current.values[2];
+}
+
+float getReplayMouseY() {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    return play_current.values[3];
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/** Captures everything that changes what a frame looks like (commands, mouse drags, scrolls,
+ *  resizes and the time of each frame) so a session can be played back frame by frame, offline.
+ *  The log is binary, in the byte order of the machine that wrote it:
+ *
+ *      "GVREPLAY" uint32 version
+ *      then events of uint8 type, uint32 frame and their payload:
+ *          REPLAY_FRAME        float time, delta, mouseX, mouseY
+ *          REPLAY_COMMAND      uint32 size, chars
+ *          REPLAY_MOUSE_DRAG   float x, y, velX, velY, int32 button
+ *          REPLAY_SCROLL       float offset
+ *          REPLAY_RESIZE       int32 width, height
+ *
+ *  Events are applied right before the frame they were recorded on. **/
+
+enum ReplayEventType {
+    REPLAY_FRAME = 0,
+    REPLAY_COMMAND,
+    REPLAY_MOUSE_DRAG,
+    REPLAY_SCROLL,
+    REPLAY_RESIZE
+};
+
+struct ReplayEvent {
+    ReplayEventType type    = REPLAY_FRAME;
+    uint32_t        frame   = 0;
+    float           values[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    int32_t         ints[2] = {0, 0};
+    std::string     command = "";
+};
+
+// Recording. Can be fed from any thread
+bool    replayRecordStart(const std::string& _file, size_t _frame);
+void    replayRecordFrame(size_t _frame, float _time, float _delta, float _mouseX, float _mouseY);
+void    replayRecordCommand(const std::string& _command);
+void    replayRecordMouseDrag(float _x, float _y, float _velX, float _velY, int _button);
+void    replayRecordScroll(float _offset);
+void    replayRecordResize(int _width, int _height);
+size_t  replayRecordStop();     // returns the frames recorded
+bool    isReplayRecording();
+
+// Playback. The whole log is loaded up front so reading it doesn't add to the frames
+bool    replayPlayStart(const std::string& _file);
+
+// Hands the events to apply before the next frame, and makes its time current.
+// Returns false once there are no frames left
+bool    replayPlayFrame(std::vector<ReplayEvent>& _events);
+void    replayPlayStop();
+bool    isReplaying();
+
+float   getReplayPercentage();
+int     getReplayFrame();
+float   getReplayTime();
+float   getReplayDelta();
+float   getReplayMouseX();
+float   getReplayMouseY();
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <condition_variable>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/** Fixed capacity single-producer / single-consumer ring. produce() and consume() don't allocate
+ *  and don't lock: the producer only writes the tail, the consumer only writes the head, and each
+ *  lives on its own cache line so they don't bounce between cores. The mutex and condition variable
+ *  are only used by a side that has to sleep because the ring is empty (or full), and by the other
+ *  side to wake it up, so nobody spins on size() **/
+template<typename T>
+class RingBuffer {
+public:
+    RingBuffer(size_t _capacity) : m_buffer(_capacity > 0 ? _capacity : 1), m_head(0), m_tail(0), m_waiting(0) { }
+
+    // Producer thread only. Returns false (leaving _value untouched) when the ring is full
+    bool produce( T& _value ) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_buffer.size())
+            return false;
+
+        m_buffer[tail % m_buffer.size()] = std::move(_value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        _notify();
+        return true;
+    }
+
+    // Producer thread only. Sleeps while the ring is full, up to _timeoutMs
+    bool produce( T& _value, int _timeoutMs ) {
+        if (produce(_value))
+            return true;
+
+        _wait(_timeoutMs, [this]{ return !full(); });
+        return produce(_value);
+    }
+
+    // Consumer thread only. Returns false when the ring is empty
+    bool consume( T& _value ) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        _value = std::move(m_buffer[head % m_buffer.size()]);
+        m_head.store(head + 1, std::memory_order_release);
+        _notify();
+        return true;
+    }
+
+    // Consumer thread only. Sleeps while the ring is empty, up to _timeoutMs
+    bool consume( T& _value, int _timeoutMs ) {
+        if (consume(_value))
+            return true;
+
+        _wait(_timeoutMs, [this]{ return !empty(); });
+        return consume(_value);
+    }
+
+    // Approximated when called while the other thread is working on the ring
+    size_t  size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    size_t  capacity() const { return m_buffer.size(); }
+    bool    empty() const { return size() == 0; }
+    bool    full() const { return size() >= m_buffer.size(); }
+
+private:
+    template<typename Predicate>
+    void _wait( int _timeoutMs, Predicate _ready ) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_waiting.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_changed.wait_for(lock, std::chrono::milliseconds(_timeoutMs), _ready);
+        m_waiting.fetch_sub(1);
+    }
+
+    void _notify() {
+        // pairs with the fence on _wait(), either the waiter sees the new head/tail or we see the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiting.load(std::memory_order_relaxed) == 0)
+            return;
+
+        // taking the lock makes sure the waiter is not between checking and sleeping
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_changed.notify_one();
+    }
+
+    std::vector<T>                              m_buffer;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+    alignas(CACHE_LINE_SIZE) std::atomic<int>    m_waiting;
+    std::mutex                                  m_mutex;
+    std::condition_variable                     m_changed;
+};
@@ -0,0 +1,120 @@
+#include "shaderCompiler.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+
+bool haveExtension(const std::string& _name) {
+    const GLubyte* extensions = glGetString(GL_EXTENSIONS);
+    if (extensions)
+        return (" " + std::string((const char*)extensions) + " ").find(" " + _name + " ") != std::string::npos;
+
+    // core profiles only list them one by one
+    glGetError();
+    #if defined(GL_NUM_EXTENSIONS) && !defined(__EMSCRIPTEN__)
+    GLint total = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &total);
+    for (GLint i = 0; i < total; i++) {
+        const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+        if (extension && _name == (const char*)extension)
+            return true;
+    }
+    #endif
+    return false;
+}
+
+// Hands the source to the driver without asking how it went, that would wait for it
+GLuint compileStage(GLenum _type, const std::string& _source) {
+    GLuint shader = glCreateShader(_type);
+    const GLchar* source = _source.c_str();
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+}
+
+ShaderCompiler::ShaderCompiler(): m_parallel(-1) {
+}
+
+ShaderCompiler::~ShaderCompiler() {
+    clear();
+}
+
+bool ShaderCompiler::isParallel() {
+    if (m_parallel < 0)
+        m_parallel = (haveExtension("GL_KHR_parallel_shader_compile") || haveExtension("GL_ARB_parallel_shader_compile")) ? 1 : 0;
+    return m_parallel > 0;
+}
+
+bool ShaderCompiler::start(ProgramCache& _cache, const std::map<std::string, std::string>& _defines, const std::vector<CompileSource>& _programs) {
+    clear();
+
+    #if defined(SUPPORT_PROGRAM_BINARY)
+    // without it glCompileShader and glLinkProgram do the work right there
+    if (!isParallel())
+        return false;
+
+    // All the sources are ready before the first compile, so the stubs of prepare() don't wait behind them
+    std::vector<std::string> fragSrcs(_programs.size());
+    std::vector<std::string> vertSrcs(_programs.size());
+    std::vector<std::string> keys(_programs.size());
+    std::vector<bool> ready(_programs.size(), false);
+    for (size_t i = 0; i < _programs.size(); i++)
+        ready[i] = _cache.prepare(_defines, _programs[i].defines, _programs[i].fragSrc, _programs[i].vertSrc, fragSrcs[i], vertSrcs[i], keys[i]);
+
+    for (size_t i = 0; i < _programs.size(); i++) {
+        if (!ready[i])
+            continue;
+
+        Program program;
+        program.pass = _programs[i].pass;
+        program.key = keys[i];
+        program.vertex = compileStage(GL_VERTEX_SHADER, vertSrcs[i]);
+        program.fragment = compileStage(GL_FRAGMENT_SHADER, fragSrcs[i]);
+        program.program = glCreateProgram();
+        glAttachShader(program.program, program.vertex);
+        glAttachShader(program.program, program.fragment);
+
+        // only a program that asked for it before linking is sure to give its binary back
+        glProgramParameteri(program.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program.program);
+        m_programs.push_back(program);
+    }
+    #endif
+
+    return !m_programs.empty();
+}
+
+bool ShaderCompiler::update(ProgramCache& _cache) {
+    if (m_programs.empty())
+        return true;
+
+    for (size_t i = 0; i < m_programs.size(); i++) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(m_programs[i].program, GL_COMPLETION_STATUS_KHR, &done);
+        if (done != GL_TRUE)
+            return false;
+    }
+
+    for (size_t i = 0; i < m_programs.size(); i++) {
+        GLint linked = GL_FALSE;
+        glGetProgramiv(m_programs[i].program, GL_LINK_STATUS, &linked);
+        if (linked == GL_TRUE)
+            _cache.save(m_programs[i].program, m_programs[i].key);
+    }
+
+    clear();
+    return true;
+}
+
+void ShaderCompiler::clear() {
+    for (size_t i = 0; i < m_programs.size(); i++) {
+        glDeleteProgram(m_programs[i].program);
+        glDeleteShader(m_programs[i].fragment);
+        glDeleteShader(m_programs[i].vertex);
+    }
+    m_programs.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "programCache.h"
+
+// A program to compile: the sources of a pass and the defines only that pass has (space separated NAME or NAME=value)
+struct CompileSource {
+    std::string pass;
+    std::string defines;
+    std::string fragSrc;
+    std::string vertSrc;
+};
+
+/** Compiles and links programs without making the render thread wait for them, while the current
+ *  ones keep rendering. Only with GL_KHR/ARB_parallel_shader_compile: the driver does it on its own
+ *  threads and is asked every frame if it's done. Other drivers compile on the calling thread, so
+ *  there start() does nothing and the shaders are reloaded as usual. Once every program is done, the
+ *  binaries of the ones that linked go to the program cache, so loading them through ada right after
+ *  (at a frame boundary) takes no compile. The ones that didn't link are left for ada, which reports
+ *  their errors as usual **/
+class ShaderCompiler {
+public:
+    ShaderCompiler();
+    virtual ~ShaderCompiler();
+
+    // Needs parallel compiling, program binaries, and sources without their own #version. False if nothing could be started
+    bool    start(ProgramCache& _cache, const std::map<std::string, std::string>& _defines, const std::vector<CompileSource>& _programs);
+
+    // Call once per frame, true once every program is done and the linked ones are on _cache
+    bool    update(ProgramCache& _cache);
+
+    // Forgets the programs in flight
+    void    clear();
+
+    bool    isCompiling() const { return !m_programs.empty(); }
+    bool    isParallel();
+
+protected:
+    struct Program {
+        std::string pass;
+        std::string key;
+        GLuint      program;
+        GLuint      fragment;
+        GLuint      vertex;
+    };
+
+    std::vector<Program>    m_programs;
+    int                     m_parallel;     // -1 not checked yet, 0 no GL_KHR_parallel_shader_compile, 1 there is
+};
@@ -0,0 +1,232 @@
+#include "shaderStats.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "ada/string.h"
+
+#include "text.h"
+
+namespace {
+
+std::string toHex(size_t _value) {
+    static const char* digits = "0123456789abcdef";
+    std::string rta(sizeof(size_t) * 2, '0');
+    for (size_t i = 0; i < rta.size(); i++)
+        rta[rta.size() - 1 - i] = digits[(_value >> (i * 4)) & 0xF];
+    return rta;
+}
+
+double msSince(const std::chrono::time_point<std::chrono::high_resolution_clock>& _start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - _start).count() * 0.001;
+}
+
+}
+
+ShaderStats::ShaderStats():
+    m_cache(nullptr), m_reloading(false), m_reloadMs(0.0), m_reloads(0), m_compiles(0), m_redundant(0), m_unchanged(0), m_cached(0), m_skipped(0), m_reloadSkipped(0), m_compileMs(0.0) {
+    m_slowest.ms = 0.0;
+}
+
+void ShaderStats::beginReload() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_programs.clear();
+    m_reloadSkipped = 0;
+    m_reloadStart = std::chrono::high_resolution_clock::now();
+    m_reloading = true;
+}
+
+void ShaderStats::endReload() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_reloading)
+        return;
+
+    m_reloadMs = msSince(m_reloadStart);
+    m_reloads++;
+    m_reloading = false;
+}
+
+bool ShaderStats::load( ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                        const std::string& _fragSrc, const std::string& _vertSrc, bool _verbose) {
+    return _load(_shader, _pass, _defines, _fragSrc, _vertSrc, [&]() { return _shader.load(_fragSrc, _vertSrc, _verbose); });
+}
+
+bool ShaderStats::load( ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                        const std::string& _fragSrc, const std::string& _vertSrc, bool _verbose, bool _errorScreen) {
+    return _load(_shader, _pass, _defines, _fragSrc, _vertSrc, [&]() { return _shader.load(_fragSrc, _vertSrc, _verbose, _errorScreen); });
+}
+
+bool ShaderStats::skip( ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                        const std::string& _fragSrc, const std::string& _vertSrc) {
+    if (!isCurrent(_shader, _pass, _defines, _fragSrc, _vertSrc))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_skipped++;
+    m_reloadSkipped++;
+    return true;
+}
+
+bool ShaderStats::isCurrent(ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                            const std::string& _fragSrc, const std::string& _vertSrc) {
+    if (!_shader.isLoaded())
+        return false;
+
+    size_t hash = _passHash(_pass, _defines, _fragSrc, _vertSrc);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<const ada::Shader*, size_t>::iterator it = m_loaded.find(&_shader);
+    return it != m_loaded.end() && it->second == hash;
+}
+
+// Global defines are part of it, they change what every pass compiles
+size_t ShaderStats::_passHash(const std::string& _pass, const std::string& _defines, const std::string& _fragSrc, const std::string& _vertSrc) {
+    std::string defines = _defines;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_definesString.empty())
+            defines += (_defines.empty() ? "" : " ") + m_definesString;
+    }
+
+    return std::hash<std::string>()(_pass + '\0' + defines + '\0' + passSource(_fragSrc, defines) + '\0' + passSource(_vertSrc, defines));
+}
+
+// The time of a program loaded from the cache is what it took to find it and hand it to the driver
+bool ShaderStats::_load(ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                        const std::string& _fragSrc, const std::string& _vertSrc, const std::function<bool()>& _compile) {
+    auto start = std::chrono::high_resolution_clock::now();
+    bool cached = false;
+    bool ok = m_cache ? m_cache->load(_shader, _fragSrc, _vertSrc, _compile, cached) : _compile();
+    add(_pass, _defines, _fragSrc, _vertSrc, msSince(start), ok, cached);
+
+    // what a failed load leaves on the shader (like the error screen) is never skipped
+    size_t hash = ok ? _passHash(_pass, _defines, _fragSrc, _vertSrc) : 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (ok)
+        m_loaded[&_shader] = hash;
+    else
+        m_loaded.erase(&_shader);
+    return ok;
+}
+
+void ShaderStats::add(const std::string& _pass, const std::string& _defines, const std::string& _fragSrc, const std::string& _vertSrc, double _ms, bool _ok, bool _cached) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ShaderProgram program;
+    program.pass = _pass;
+    program.defines = _defines;
+    if (!m_definesString.empty())
+        program.defines += (_defines.empty() ? "" : " ") + m_definesString;
+    program.hash = std::hash<std::string>()(_fragSrc + '\0' + _vertSrc + '\0' + program.defines);
+    program.bytes = _fragSrc.size() + _vertSrc.size();
+    program.ms = _ms;
+    program.ok = _ok;
+    program.cached = _cached;
+    _add(program);
+}
+
+void ShaderStats::_add(ShaderProgram& _program) {
+    _program.redundant = false;
+    for (size_t i = 0; i < m_programs.size() && m_reloading; i++)
+        if (m_programs[i].hash == _program.hash) {
+            _program.redundant = true;
+            break;
+        }
+
+    std::map<std::string, size_t>::iterator it = m_lastHash.find(_program.pass);
+    _program.unchanged = (it != m_lastHash.end() && it->second == _program.hash);
+    m_lastHash[_program.pass] = _program.hash;
+
+    // the ones loaded outside a reload (like the default floor) only count on the totals
+    if (m_reloading)
+        m_programs.push_back(_program);
+    m_compiles++;
+    m_compileMs += _program.ms;
+    if (_program.redundant)
+        m_redundant++;
+    if (_program.unchanged)
+        m_unchanged++;
+    if (_program.cached)
+        m_cached++;
+    if (_program.ms > m_slowest.ms)
+        m_slowest = _program;
+}
+
+void ShaderStats::setDefine(const std::string& _define, const std::string& _value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_defines[_define] = _value;
+    _updateDefines();
+}
+
+void ShaderStats::delDefine(const std::string& _define) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_defines.erase(_define);
+    _updateDefines();
+}
+
+std::map<std::string, std::string> ShaderStats::getDefines() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_defines;
+}
+
+// Sorted and space separated, commas would break the CSV
+void ShaderStats::_updateDefines() {
+    m_definesString = "";
+    for (std::map<std::string, std::string>::iterator it = m_defines.begin(); it != m_defines.end(); ++it)
+        m_definesString += (m_definesString.empty() ? "" : " ") + it->first + (it->second.empty() ? "" : "=" + it->second);
+    std::replace(m_definesString.begin(), m_definesString.end(), ',', ';');
+}
+
+std::string ShaderStats::logStats() {
+    std::string log = "";
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        double compileMs = 0.0;
+        size_t redundant = 0;
+        size_t unchanged = 0;
+        size_t cached = 0;
+        const ShaderProgram* slowest = nullptr;
+        for (size_t i = 0; i < m_programs.size(); i++) {
+            compileMs += m_programs[i].ms;
+            redundant += m_programs[i].redundant ? 1 : 0;
+            unchanged += m_programs[i].unchanged ? 1 : 0;
+            cached += m_programs[i].cached ? 1 : 0;
+            if (!slowest || m_programs[i].ms > slowest->ms)
+                slowest = &m_programs[i];
+        }
+
+        log += "reloads," + ada::toString(m_reloads) + "\n";
+        log += "reloadMs," + ada::toString(m_reloadMs) + "\n";
+        log += "programs," + ada::toString(m_programs.size()) + "," + ada::toString(m_compiles) + "\n";
+        log += "compileMs," + ada::toString(compileMs) + "," + ada::toString(m_compileMs) + "\n";
+        log += "redundant," + ada::toString(redundant) + "," + ada::toString(m_redundant) + "\n";
+        log += "unchanged," + ada::toString(unchanged) + "," + ada::toString(m_unchanged) + "\n";
+        log += "cached," + ada::toString(cached) + "," + ada::toString(m_cached) + "\n";
+        log += "skipped," + ada::toString(m_reloadSkipped) + "," + ada::toString(m_skipped) + "\n";
+        if (slowest)
+            log += "slowest," + slowest->pass + "," + ada::toString(slowest->ms) + "," + m_slowest.pass + "," + ada::toString(m_slowest.ms) + "\n";
+    }
+
+    return log + logPrograms();
+}
+
+std::string ShaderStats::logPrograms() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string log = "";
+
+    for (size_t i = 0; i < m_programs.size(); i++) {
+        const ShaderProgram& program = m_programs[i];
+        log +=  program.pass + "," +
+                program.defines + "," +
+                toHex(program.hash) + "," +
+                ada::toString(program.bytes) + "," +
+                ada::toString(program.ms) + "," +
+                (program.ok ? "ok" : "error") + "," +
+                (program.redundant ? "redundant" : "-") + "," +
+                (program.unchanged ? "unchanged" : "-") + "," +
+                (program.cached ? "cached" : "-") + "\n";
+    }
+
+    return log;
+}
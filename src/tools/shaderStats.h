@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+
+#include "ada/gl/shader.h"
+
+#include "programCache.h"
+
+struct ShaderProgram {
+    std::string pass;           // canvas, u_buffer0, postprocessing, model:<name>, ...
+    std::string defines;        // the ones of the pass followed by the ones set on every shader
+    size_t      hash;           // of the sources and the defines
+    size_t      bytes;          // of both sources after the #includes were expanded
+    double      ms;             // compile and link
+    bool        ok;
+    bool        redundant;      // an identical program was already compiled on the same reload
+    bool        unchanged;      // same as the last time this pass was compiled
+    bool        cached;         // its binary came from the program cache instead
+};
+
+/** Times every shader program compiled and linked, attributing it to the pass it belongs to, so
+ *  it's clear where the latency of a hot reload goes. Used from the render thread, read from any **/
+class ShaderStats {
+public:
+    ShaderStats();
+
+    // Everything loaded in between counts as one reload
+    void    beginReload();
+    void    endReload();
+
+    // Programs are looked up on _cache before being compiled, nullptr compiles them all
+    void    setCache(ProgramCache* _cache) { m_cache = _cache; }
+
+    // Loads _shader through ada, timing it. _defines are the ones added to _shader for this pass
+    bool    load(   ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                    const std::string& _fragSrc, const std::string& _vertSrc, bool _verbose = false);
+    bool    load(   ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                    const std::string& _fragSrc, const std::string& _vertSrc, bool _verbose, bool _errorScreen);
+
+    // True, counting it as skipped, when loading these sources on _shader would give back the program it
+    // already has: it's loaded, and the last time it was for this pass with the same defines and the same
+    // code once the #if blocks of the other passes are left out
+    bool    skip(   ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                    const std::string& _fragSrc, const std::string& _vertSrc);
+    // The same check, without counting
+    bool    isCurrent(  ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                        const std::string& _fragSrc, const std::string& _vertSrc);
+
+    // Programs that compile themselves (like the materials of the models) report here once done
+    void    add(const std::string& _pass, const std::string& _defines, const std::string& _fragSrc, const std::string& _vertSrc, double _ms, bool _ok, bool _cached = false);
+
+    // Defines set on every shader, part of the identity of each program
+    void    setDefine(const std::string& _define, const std::string& _value);
+    void    delDefine(const std::string& _define);
+    std::map<std::string, std::string> getDefines();
+
+    // reloads and reloadMs, then programs, compileMs, redundant, unchanged, cached and skipped of the last
+    // reload and of all time, and the slowest program of both. Followed by the programs of the last reload
+    std::string logStats();
+    // pass,defines,hash,bytes,ms,ok,redundant,unchanged,cached of every program of the last reload
+    std::string logPrograms();
+
+protected:
+    bool    _load(  ada::Shader& _shader, const std::string& _pass, const std::string& _defines,
+                    const std::string& _fragSrc, const std::string& _vertSrc, const std::function<bool()>& _compile);
+    void    _add(ShaderProgram& _program);
+    void    _updateDefines();
+    size_t  _passHash(const std::string& _pass, const std::string& _defines, const std::string& _fragSrc, const std::string& _vertSrc);
+
+    std::mutex                      m_mutex;
+    ProgramCache*                   m_cache;
+    std::map<std::string, std::string> m_defines;
+    std::string                     m_definesString;
+
+    std::vector<ShaderProgram>      m_programs;     // of the current or last reload
+    std::map<std::string, size_t>   m_lastHash;     // per pass
+    std::map<const ada::Shader*, size_t> m_loaded;  // _passHash() of what each shader holds
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_reloadStart;
+    bool                            m_reloading;
+
+    double                          m_reloadMs;     // wall time of the last reload
+    size_t                          m_reloads;
+    size_t                          m_compiles;
+    size_t                          m_redundant;
+    size_t                          m_unchanged;
+    size_t                          m_cached;
+    size_t                          m_skipped;
+    size_t                          m_reloadSkipped;
+    double                          m_compileMs;
+    ShaderProgram                   m_slowest;
+};
@@ -1,201 +1,562 @@
 #include "text.h"
 
 #include <algorithm>
-#include <array>
-#include <functional>
-#include <regex>
-#include <tuple>
+#include <cstdlib>
 #include <cstring>
+#include <cctype>
 #include "ada/string.h"
 
-namespace {
+std::string getUniformName(const std::string& _str) {
+    std::vector<std::string> values = ada::split(_str, '.');
+    return "u_" + ada::toLower( ada::toUnderscore( ada::purifyString( values[0] ) ) );
+}
 
-template<typename T1> // Helper operator shorthand: [enum_t] -> [size_t].
-constexpr size_t operator+(T1 some_enum) {
-    return static_cast<size_t>(some_enum);
+bool checkPattern(const std::string& _str) {
+    return  (_str.find('*') != std::string::npos) ||
+            (_str.find('?') != std::string::npos);
 }
 
-template<typename T1>
-std::string create_regex_term(T1 regex_piece, const std::string& keyword) {
-    std::ostringstream os;
-    for(size_t i = 0; i < regex_piece.size()-1; ++i) {
-        os << std::begin(regex_piece)[i] << keyword;
+namespace {
+
+// Where the header of a shader ends: #version, #extension, precision and whatever else comes before
+// the first line of code, on a line outside any #if. So #ifdef GL_ES / precision / #endif stays whole
+size_t headerEnd(const std::string& _source) {
+    size_t end = 0;
+    size_t pos = 0;
+    int depth = 0;
+    bool comment = false;
+
+    while (pos < _source.size()) {
+        size_t eol = _source.find('\n', pos);
+        size_t next = (eol == std::string::npos) ? _source.size() : eol + 1;
+
+        size_t start = pos;
+        while (start < next && isspace((unsigned char)_source[start]))
+            start++;
+
+        if (comment)
+            comment = _source.find("*/", start) >= next;
+        else if (start == next || _source.compare(start, 2, "//") == 0) {
+        }
+        else if (_source.compare(start, 2, "/*") == 0)
+            comment = _source.find("*/", start + 2) >= next;
+        else if (_source[start] == '#') {
+            size_t directive = start + 1;
+            while (directive < next && (_source[directive] == ' ' || _source[directive] == '\t'))
+                directive++;
+            if (_source.compare(directive, 2, "if") == 0)
+                depth++;
+            else if (_source.compare(directive, 5, "endif") == 0)
+                depth--;
+        }
+        else if (_source.compare(start, 10, "precision ") != 0)
+            break;
+
+        pos = next;
+        if (!comment && depth == 0)
+            end = pos;
     }
-    os << std::begin(regex_piece)[regex_piece.size()-1];
-    return os.str();
-};
 
-template<typename T1, typename T2>
-std::regex make_regex(T1 regex_pattern_check, T2 listings_keyword) {
-    return std::regex{create_regex_term(regex_pattern_check, std::get<1>(listings_keyword))};
-};
+    return end;
+}
 
-std::tuple<bool, std::smatch> does_any_of_the_regex_exist(const std::string& _source, std::regex re) {
-    // Split Source code in lines
-    const auto lines = ada::split(_source, '\n');
-    std::smatch match;
-    const auto match_found = std::any_of(std::begin(lines), std::end(lines)
-                                         , [&](const std::string& line) { return std::regex_search(line, match, re); });
-    return { match_found, match };
 }
 
-using regex_stringdata_t = const char * const;
+std::string offsetFragCoord(const std::string& _source, const std::string& _offsetUniform) {
+    const std::string id = "gl_FragCoord";
+    const std::string replacement = "(gl_FragCoord + vec4(" + _offsetUniform + ", 0.0, 0.0))";
 
-template<typename T1>
-using regex_string_t = std::tuple<T1, regex_stringdata_t>;
+    size_t declaration = headerEnd(_source);
+    std::string uniform = "uniform vec2 " + _offsetUniform + ";\n";
+    if (declaration > 0 && _source[declaration - 1] != '\n')
+        uniform = "\n" + uniform;
 
-enum class regex_check_t {
-    Convolution_Pyramid,
-    Floor,
-    Background,
-    Post_Processing,
-    MAX_KEYWORDS_CHECK_IDS
-};
-using regex_check_string_t = regex_string_t<regex_check_t>;
-const auto valid_check_keyword_ids = std::array<regex_check_string_t, +(regex_check_t::MAX_KEYWORDS_CHECK_IDS)> {{
-    {regex_check_t::Convolution_Pyramid, "CONVOLUTION_PYRAMID_ALGORITHM"}
-    , {regex_check_t::Floor,"FLOOR"}
-    , {regex_check_t::Background, "BACKGROUND"}
-    , {regex_check_t::Post_Processing, "POSTPROCESSING"}
-}};
-
-bool generic_search_check(const std::string& _source, regex_check_t keyword_id ) {
-    const auto regex_pattern_check = {
-        R"((?:^\s*#if|^\s*#elif)(?:\s+)(defined\s*\(\s*)"
-        , R"()(?:\s*\))|(?:^\s*#ifdef\s+)"
-        , R"()|(?:^\s*#ifndef\s+)"
-        , R"())"
-    };
-    const auto re = make_regex(regex_pattern_check, valid_check_keyword_ids[+(keyword_id)]);
-    return std::get<0>(does_any_of_the_regex_exist(_source, re));   //return only the "result" boolean.
-}
-
-enum class regex_count_t {
-    Buffers,
-    Double_Buffers,
-    Convolution_Pyramid,
-    MAX_KEYWORDS_COUNT_IDS
-};
-using regex_count_string_t = regex_string_t<regex_count_t>;
-const auto valid_count_keyword_ids = std::array<regex_count_string_t, +(regex_count_t::MAX_KEYWORDS_COUNT_IDS)> {{
-    {regex_count_t::Buffers, "BUFFER"}
-    , {regex_count_t::Double_Buffers, "DOUBLE_BUFFER"}
-    , {regex_count_t::Convolution_Pyramid, "CONVOLUTION_PYRAMID"}
-}};
-
-struct is_not_duplicate_number_predicate {
-    // Group results in a vector to check for duplicates
-    std::vector<std::string> results = {};
-    bool operator()(const std::string &line, const std::regex &re) {
-        std::smatch match;
-        // if there are matches
-        if (std::regex_search(line, match, re)) {
-            // Depending the case can be in the 2nd or 3rd group
-            const auto case_group = [&](size_t index){return std::ssub_match(match[index]).str();};
-            const auto number = (case_group(2).size() == 0)
-                    ? case_group(3)
-                    : case_group(2);
-            // Check if it's already defined
-            // If it's not add it
-            if (!std::any_of(std::begin(results), std::end(results)
-                             , [&](const std::string& index){ return index == number; })) {
-                results.push_back(number);
-                return true;
-            }
+    std::string rta;
+    size_t pos = 0;
+    while (pos < _source.size()) {
+        if (pos == declaration)
+            rta += uniform;
+
+        if (_source.compare(pos, id.size(), id) == 0 &&
+            (pos == 0 || !(isalnum(_source[pos-1]) || _source[pos-1] == '_')) &&
+            (pos + id.size() == _source.size() || !(isalnum(_source[pos + id.size()]) || _source[pos + id.size()] == '_')) ) {
+            rta += replacement;
+            pos += id.size();
         }
-        return false;
+        else
+            rta += _source[pos++];
     }
-};
 
-int generic_search_count(const std::string& _source, regex_count_t keyword_id ) {
-    const auto regex_pattern_count  = {
-        R"((?:^\s*#if|^\s*#elif)(?:\s+)(defined\s*\(\s*)"
-        , R"(_)(\d+)(?:\s*\))|(?:^\s*#ifdef\s+)"
-        , R"(_)(\d+))"
-    };
-    // Split Source code in lines
-    const auto lines = ada::split(_source, '\n');
-    // Regext to search for #ifdef BUFFER_[NUMBER], #if defined( BUFFER_[NUMBER] ) and #elif defined( BUFFER_[NUMBER] ) occurences
-    const auto re = make_regex(regex_pattern_count, valid_count_keyword_ids[+(keyword_id)]);
-    // return the number of results
-    auto predicate_op = is_not_duplicate_number_predicate{};
-    return std::count_if(std::begin(lines), std::end(lines), [&](const std::string& line) {
-        return std::ref(predicate_op)(line, re);
-    });
-}
-
-enum class regex_get_t {
-    BufferSize,
-    MAX_KEYWORDS_GET_IDS
-};
+    if (declaration >= _source.size())
+        rta += uniform;
+    return rta;
+}
 
-using regex_get_string_t = regex_string_t<regex_get_t>;
-const auto valid_get_keyword_ids = std::array<regex_get_string_t, +(regex_get_t::MAX_KEYWORDS_GET_IDS)> {{
-    {regex_get_t::BufferSize, R"(uniform\s*sampler2D\s*(\w*)\;\s*\/\/*\s(\d+)x(\d+))"}
-}};
+namespace {
 
-bool generic_search_get(const std::string& _source, const std::string& _name, glm::vec2& _size, regex_get_t keyword_id ) {
-    bool result;
-    std::smatch match;
-    const auto re = std::regex{std::get<1>(valid_get_keyword_ids[+(keyword_id)])};
-    std::tie(result, match) = does_any_of_the_regex_exist(_source, re); // capture both the "result" and the "match" info.
-    if(result) {
-        if (match[1] == _name) {    // regex-match result data is valid to spec.
-            _size = {ada::toFloat(match[2]), ada::toFloat(match[3])};
-        }
+enum class condition_t { False, True, Unknown };
+
+// The defines glslViewer sets on one pass and not on the others
+bool isPassDefine(const std::string& _name) {
+    if (_name == "POSTPROCESSING" || _name == "CONVOLUTION_PYRAMID_ALGORITHM" || _name == "BACKGROUND" || _name == "FLOOR")
+        return true;
+
+    const char* prefixes[] = { "BUFFER_", "DOUBLE_BUFFER_", "CONVOLUTION_PYRAMID_" };
+    for (size_t i = 0; i < 3; i++) {
+        size_t length = strlen(prefixes[i]);
+        if (_name.size() > length && _name.compare(0, length, prefixes[i]) == 0 &&
+            std::all_of(_name.begin() + length, _name.end(), [](char _c) { return isdigit(_c) != 0; }))
+            return true;
     }
-    return result;
+    return false;
 }
-}  // Namespace {}
 
-// Quickly determine if a shader program contains the specified identifier.
-bool findId(const std::string& program, const char* id) {
-    return std::strstr(program.c_str(), id) != 0;
+void skipSpaces(const std::string& _line, size_t& _pos) {
+    while (_pos < _line.size() && (_line[_pos] == ' ' || _line[_pos] == '\t'))
+        _pos++;
 }
 
-// Count how many BUFFERS are in the shader
-int countBuffers(const std::string& _source) {
-    return generic_search_count(_source, regex_count_t::Buffers);
+std::string readName(const std::string& _line, size_t& _pos) {
+    skipSpaces(_line, _pos);
+    size_t start = _pos;
+    while (_pos < _line.size() && (isalnum(_line[_pos]) || _line[_pos] == '_'))
+        _pos++;
+    return _line.substr(start, _pos - start);
 }
 
-bool getBufferSize(const std::string& _source, const std::string& _name, glm::vec2& _size) {
-    return generic_search_get(_source, _name, _size, regex_get_t::BufferSize);
+struct PassDefines {
+    std::vector<std::string> defined;
+    std::vector<std::string> redefined;     // by the source itself, with #define or #undef
+
+    condition_t isDefined(const std::string& _name) const {
+        if (!isPassDefine(_name) || std::find(redefined.begin(), redefined.end(), _name) != redefined.end())
+            return condition_t::Unknown;
+        return std::find(defined.begin(), defined.end(), _name) != defined.end() ? condition_t::True : condition_t::False;
+    }
+};
+
+condition_t negate(condition_t _condition) {
+    if (_condition == condition_t::Unknown)
+        return _condition;
+    return _condition == condition_t::True ? condition_t::False : condition_t::True;
+}
+
+// Expressions of defined(NAME) terms, negated or not, joined only by || or only by &&. Anything else is unknown
+condition_t evalCondition(const std::string& _expr, const PassDefines& _defines) {
+    std::vector<condition_t> terms;
+    std::string op = "";
+    size_t pos = 0;
+
+    while (true) {
+        skipSpaces(_expr, pos);
+        bool negated = false;
+        while (pos < _expr.size() && _expr[pos] == '!') {
+            negated = !negated;
+            pos++;
+            skipSpaces(_expr, pos);
+        }
+
+        if (readName(_expr, pos) != "defined")
+            return condition_t::Unknown;
+
+        skipSpaces(_expr, pos);
+        bool parenthesis = (pos < _expr.size() && _expr[pos] == '(');
+        if (parenthesis)
+            pos++;
+
+        std::string name = readName(_expr, pos);
+        skipSpaces(_expr, pos);
+        if (name.empty() || (parenthesis && (pos >= _expr.size() || _expr[pos++] != ')')))
+            return condition_t::Unknown;
+
+        condition_t term = _defines.isDefined(name);
+        terms.push_back(negated ? negate(term) : term);
+
+        skipSpaces(_expr, pos);
+        if (pos >= _expr.size())
+            break;
+
+        std::string next = _expr.substr(pos, 2);
+        if ((next != "||" && next != "&&") || (!op.empty() && next != op))
+            return condition_t::Unknown;
+        op = next;
+        pos += 2;
+    }
+
+    // a single term is an || of one
+    condition_t decisive = (op == "&&") ? condition_t::False : condition_t::True;
+    bool unknown = false;
+    for (size_t i = 0; i < terms.size(); i++) {
+        if (terms[i] == decisive)
+            return decisive;
+        unknown = unknown || terms[i] == condition_t::Unknown;
+    }
+    return unknown ? condition_t::Unknown : negate(decisive);
 }
 
-// Count how many BUFFERS are in the shader
-int countDoubleBuffers(const std::string& _source) {
-    return generic_search_count(_source, regex_count_t::Double_Buffers);
+struct ConditionalBlock {
+    bool    parentLive;
+    bool    live;
+    bool    taken;      // a branch of it is known to be the one compiled, the ones after it are not
+};
+
 }
 
-// Count how many BUFFERS are in the shader
-bool checkBackground(const std::string& _source) {
-    return generic_search_check(_source, regex_check_t::Background);
+std::string passSource(const std::string& _source, const std::string& _defines) {
+    PassDefines defines;
+    std::vector<std::string> values = ada::split(_defines, ' ');
+    for (size_t i = 0; i < values.size(); i++)
+        if (!values[i].empty())
+            defines.defined.push_back(values[i].substr(0, values[i].find('=')));
+
+    // Split in lines, and find the directive of each one not inside a /* */ comment
+    std::vector<std::string> lines = ada::split(_source, '\n', true);
+    std::vector<std::string> keywords(lines.size());
+    std::vector<std::string> arguments(lines.size());
+    bool comment = false;
+    for (size_t l = 0; l < lines.size(); l++) {
+        const std::string& line = lines[l];
+        size_t pos = 0;
+        skipSpaces(line, pos);
+        if (!comment && pos < line.size() && line[pos] == '#') {
+            pos++;
+            keywords[l] = readName(line, pos);
+            arguments[l] = line.substr(pos);
+            size_t cut = std::min(arguments[l].find("//"), arguments[l].find("/*"));
+            if (cut != std::string::npos)
+                arguments[l] = arguments[l].substr(0, cut);
+
+            if (keywords[l] == "define" || keywords[l] == "undef") {
+                size_t start = 0;
+                defines.redefined.push_back(readName(arguments[l], start));
+            }
+        }
+
+        for (size_t i = 0; i + 1 < line.size(); i++) {
+            if (!comment && line[i] == '/' && line[i + 1] == '/')
+                break;
+            if (!comment && line[i] == '/' && line[i + 1] == '*') {
+                comment = true;
+                i++;
+            }
+            else if (comment && line[i] == '*' && line[i + 1] == '/') {
+                comment = false;
+                i++;
+            }
+        }
+    }
+
+    std::string rta;
+    rta.reserve(_source.size());
+    std::vector<ConditionalBlock> blocks;
+    bool live = true;
+    for (size_t l = 0; l < lines.size(); l++) {
+        const std::string& keyword = keywords[l];
+        bool keep = live;
+
+        if (keyword == "if" || keyword == "ifdef" || keyword == "ifndef") {
+            condition_t condition;
+            if (keyword == "if")
+                condition = evalCondition(arguments[l], defines);
+            else {
+                size_t start = 0;
+                condition = defines.isDefined(readName(arguments[l], start));
+                if (keyword == "ifndef")
+                    condition = negate(condition);
+            }
+
+            ConditionalBlock block;
+            block.parentLive = live;
+            block.taken = (condition == condition_t::True);
+            block.live = live && condition != condition_t::False;
+            blocks.push_back(block);
+            live = block.live;
+        }
+        else if (keyword == "elif" || keyword == "else" || keyword == "endif") {
+            // unbalanced, better to compare the whole thing
+            if (blocks.empty())
+                return _source;
+
+            ConditionalBlock& block = blocks.back();
+            keep = block.parentLive;
+            if (keyword == "endif") {
+                live = block.parentLive;
+                blocks.pop_back();
+            }
+            else {
+                condition_t condition = condition_t::True;
+                if (block.taken)
+                    condition = condition_t::False;
+                else if (keyword == "elif")
+                    condition = evalCondition(arguments[l], defines);
+
+                block.taken = block.taken || condition == condition_t::True;
+                block.live = block.parentLive && condition != condition_t::False;
+                live = block.live;
+            }
+        }
+
+        if (keep)
+            rta += lines[l] + '\n';
+    }
+
+    if (!blocks.empty())
+        return _source;
+
+    return rta;
 }
 
-// Count how many BUFFERS are in the shader
-bool checkFloor(const std::string& _source) {
-    return generic_search_check(_source, regex_check_t::Floor);
+bool ShaderMetadata::getBufferSize(const std::string& _name, glm::vec2& _size) const {
+    std::map<std::string, glm::vec2>::const_iterator it = bufferSizes.find(_name);
+    if (it == bufferSizes.end())
+        return false;
+
+    _size = it->second;
+    return true;
 }
 
-bool checkPostprocessing(const std::string& _source) {
-    return generic_search_check(_source, regex_check_t::Post_Processing);
+namespace {
+
+bool isNameChar(char _c) {
+    return isalnum((unsigned char)_c) || _c == '_';
 }
 
-// Count how many CONVOLUTION_PYRAMID_ are in the shader
-int countConvolutionPyramid(const std::string& _source) {
-    return generic_search_count(_source, regex_count_t::Convolution_Pyramid);
+// N of a NAME_N define, -1 for any other name
+int passIndex(const std::string& _name, const char* _prefix) {
+    size_t length = strlen(_prefix);
+    if (_name.size() <= length || _name.compare(0, length, _prefix) != 0 ||
+        !std::all_of(_name.begin() + length, _name.end(), [](char _c) { return isdigit(_c) != 0; }))
+        return -1;
+    return atoi(_name.c_str() + length);
 }
 
-bool checkConvolutionPyramid(const std::string& _source) {
-    return generic_search_check(_source, regex_check_t::Convolution_Pyramid);
+// Only a plain number can be known, #if 0 or #if 1
+condition_t literalCondition(const std::string& _expr) {
+    size_t pos = 0;
+    skipSpaces(_expr, pos);
+    size_t start = pos;
+    while (pos < _expr.size() && isdigit(_expr[pos]))
+        pos++;
+    size_t end = pos;
+    skipSpaces(_expr, pos);
+    if (end == start || pos != _expr.size())
+        return condition_t::Unknown;
+    return (_expr.find_first_not_of('0', start) < end) ? condition_t::True : condition_t::False;
 }
 
-std::string getUniformName(const std::string& _str) {
-    std::vector<std::string> values = ada::split(_str, '.');
-    return "u_" + ada::toLower( ada::toUnderscore( ada::purifyString( values[0] ) ) );
+struct MetadataScan {
+    ShaderMetadata  metadata;
+    std::set<int>   buffers;
+    std::set<int>   doubleBuffers;
+    std::set<int>   convolutionPyramids;
+
+    // A define asked for on a directive. Passes only count when they ask for it being defined
+    void define(const std::string& _name, bool _pass) {
+        if (_name == "CONVOLUTION_PYRAMID_ALGORITHM")
+            metadata.convolutionPyramid = true;
+        else if (_name == "POSTPROCESSING")
+            metadata.postprocessing = true;
+        else if (_name == "BACKGROUND")
+            metadata.background = true;
+        else if (_name == "FLOOR")
+            metadata.floor = true;
+        else if (_pass) {
+            int index;
+            if ((index = passIndex(_name, "BUFFER_")) >= 0)
+                buffers.insert(index);
+            else if ((index = passIndex(_name, "DOUBLE_BUFFER_")) >= 0)
+                doubleBuffers.insert(index);
+            else if ((index = passIndex(_name, "CONVOLUTION_PYRAMID_")) >= 0)
+                convolutionPyramids.insert(index);
+        }
+    }
+
+    // Every defined(NAME) or defined NAME of an #if/#elif expression
+    void condition(const std::string& _expr) {
+        size_t pos = 0;
+        while (pos < _expr.size()) {
+            if (!isNameChar(_expr[pos])) {
+                pos++;
+                continue;
+            }
+
+            std::string name = readName(_expr, pos);
+            if (name != "defined")
+                continue;
+
+            skipSpaces(_expr, pos);
+            if (pos < _expr.size() && _expr[pos] == '(')
+                pos++;
+            name = readName(_expr, pos);
+            if (!name.empty())
+                define(name, true);
+        }
+    }
+};
+
 }
 
-bool checkPattern(const std::string& _str) {
-    return  (_str.find('*') != std::string::npos) ||
-            (_str.find('?') != std::string::npos);
+ShaderMetadata scanShader(const std::string& _source) {
+    MetadataScan scan;
+    std::vector<ConditionalBlock> blocks;
+    bool live = true;
+    bool lineStart = true;      // nothing but spaces since the last new line, where a directive can start
+
+    std::string name;           // the identifier right before, empty when it was something else
+    int sampler = 0;            // how much of "uniform sampler2D NAME" came right before
+    std::string samplerName;
+
+    const size_t size = _source.size();
+    size_t i = 0;
+    while (i < size) {
+        char c = _source[i];
+
+        if (c == '\n') {
+            lineStart = true;
+            i++;
+            continue;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r') {
+            i++;
+            continue;
+        }
+        else if (c == '/' && i + 1 < size && _source[i + 1] == '/') {
+            i = _source.find('\n', i);
+            if (i == std::string::npos)
+                i = size;
+            continue;
+        }
+        else if (c == '/' && i + 1 < size && _source[i + 1] == '*') {
+            i = _source.find("*/", i + 2);
+            i = (i == std::string::npos) ? size : i + 2;
+            continue;
+        }
+        else if (c == '#' && lineStart) {
+            // The directive up to the end of the line (or of the last one ending in \), without comments
+            std::string line;
+            i++;
+            while (i < size && _source[i] != '\n') {
+                size_t next = _source.find_first_not_of('\r', i + 1);
+                if (_source[i] == '\\' && next < size && _source[next] == '\n') {
+                    i = next + 1;
+                    line += ' ';
+                }
+                else if (_source.compare(i, 2, "//") == 0)
+                    i = std::min(_source.find('\n', i), size);
+                else if (_source.compare(i, 2, "/*") == 0) {
+                    i = _source.find("*/", i + 2);
+                    i = (i == std::string::npos) ? size : i + 2;
+                    line += ' ';
+                }
+                else
+                    line += _source[i++];
+            }
+
+            size_t pos = 0;
+            std::string keyword = readName(line, pos);
+            std::string argument = line.substr(pos);
+
+            if (keyword == "if" || keyword == "ifdef" || keyword == "ifndef") {
+                condition_t condition = condition_t::Unknown;
+                if (live) {
+                    if (keyword == "if") {
+                        scan.condition(argument);
+                        condition = literalCondition(argument);
+                    }
+                    else {
+                        size_t start = 0;
+                        scan.define(readName(argument, start), keyword == "ifdef");
+                    }
+                }
+
+                ConditionalBlock block;
+                block.parentLive = live;
+                block.taken = (condition == condition_t::True);
+                block.live = live && condition != condition_t::False;
+                blocks.push_back(block);
+                live = block.live;
+            }
+            else if ((keyword == "elif" || keyword == "else" || keyword == "endif") && !blocks.empty()) {
+                ConditionalBlock& block = blocks.back();
+                if (keyword == "endif") {
+                    live = block.parentLive;
+                    blocks.pop_back();
+                }
+                else {
+                    condition_t condition = condition_t::Unknown;
+                    if (block.taken || !block.parentLive)
+                        condition = condition_t::False;
+                    else if (keyword == "elif") {
+                        scan.condition(argument);
+                        condition = literalCondition(argument);
+                    }
+
+                    block.taken = block.taken || condition == condition_t::True;
+                    block.live = block.parentLive && condition != condition_t::False;
+                    live = block.live;
+                }
+            }
+
+            name.clear();
+            sampler = 0;
+            continue;
+        }
+
+        lineStart = false;
+
+        if (isalpha((unsigned char)c) || c == '_') {
+            size_t start = i;
+            while (i < size && isNameChar(_source[i]))
+                i++;
+            name = _source.substr(start, i - start);
+
+            if (name == "uniform")
+                sampler = 1;
+            else if (sampler == 1 && (name == "lowp" || name == "mediump" || name == "highp"))
+                sampler = 1;
+            else if (sampler == 1 && name == "sampler2D")
+                sampler = 2;
+            else if (sampler == 2) {
+                samplerName = name;
+                sampler = 3;
+            }
+            else
+                sampler = 0;
+            continue;
+        }
+        else if (isdigit((unsigned char)c)) {
+            while (i < size && (isNameChar(_source[i]) || _source[i] == '.'))
+                i++;
+        }
+        else {
+            if (c == ';' && live && !name.empty()) {
+                scan.metadata.declared.insert(name);
+
+                // A size on a comment right after it: uniform sampler2D u_buffer0; // 512x512
+                if (sampler == 3) {
+                    size_t pos = i + 1;
+                    skipSpaces(_source, pos);
+                    if (_source.compare(pos, 2, "//") == 0) {
+                        pos = _source.find_first_not_of('/', pos);
+                        skipSpaces(_source, pos);
+                        std::string dimensions = readName(_source, pos);
+                        size_t x = dimensions.find('x');
+                        if (x != std::string::npos && x > 0 && x + 1 < dimensions.size() &&
+                            std::all_of(dimensions.begin(), dimensions.begin() + x, [](char _c) { return isdigit(_c) != 0; }) &&
+                            std::all_of(dimensions.begin() + x + 1, dimensions.end(), [](char _c) { return isdigit(_c) != 0; }))
+                            scan.metadata.bufferSizes.insert(std::make_pair(samplerName, glm::vec2(ada::toFloat(dimensions.substr(0, x)), ada::toFloat(dimensions.substr(x + 1)))));
+                    }
+                }
+            }
+            i++;
+        }
+
+        name.clear();
+        sampler = 0;
+    }
+
+    scan.metadata.buffers = (int)scan.buffers.size();
+    scan.metadata.doubleBuffers = (int)scan.doubleBuffers.size();
+    scan.metadata.convolutionPyramids = (int)scan.convolutionPyramids.size();
+    return scan.metadata;
 }
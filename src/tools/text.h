@@ -1,23 +1,47 @@
 #pragma once
 
+#include <map>
+#include <set>
 #include <string>
 #include "glm/glm.hpp"
 
-// Search for one apearance
-bool findId(const std::string& program, const char* id);
+// What glslViewer needs to know about a shader before loading it
+struct ShaderMetadata {
+    ShaderMetadata(): buffers(0), doubleBuffers(0), convolutionPyramids(0), convolutionPyramid(false), postprocessing(false), background(false), floor(false) {}
 
-bool getBufferSize(const std::string& _source, const std::string& _name, glm::vec2& _size);
+    // How many different N are asked for with #ifdef NAME_N or defined(NAME_N) on an #if/#elif
+    int     buffers;
+    int     doubleBuffers;
+    int     convolutionPyramids;
 
-int  countBuffers(const std::string& _source);
-int  countDoubleBuffers(const std::string& _source);
-int  countConvolutionPyramid(const std::string& _source);
+    // CONVOLUTION_PYRAMID_ALGORITHM, POSTPROCESSING, ... asked for with #ifdef, #ifndef or defined() on an #if/#elif
+    bool    convolutionPyramid;
+    bool    postprocessing;
+    bool    background;
+    bool    floor;
 
-bool checkConvolutionPyramid(const std::string& _source);
+    // Fixed sizes of samplers, from their declarations: uniform sampler2D u_buffer0; // 512x512
+    std::map<std::string, glm::vec2> bufferSizes;
 
-bool checkFloor(const std::string& _source);
-bool checkBackground(const std::string& _source);
+    // Identifiers right before a ';', like the name of every uniform declared
+    std::set<std::string> declared;
+
+    bool    getBufferSize(const std::string& _name, glm::vec2& _size) const;
+    bool    isDeclared(const std::string& _name) const { return declared.find(_name) != declared.end(); }
+};
+
+// Reads the metadata of _source in one pass, leaving out comments and the branches of #if 0 (or the #else of an #if 1)
+ShaderMetadata scanShader(const std::string& _source);
 
-bool checkPostprocessing(const std::string& _source);
 bool checkPattern(const std::string& _str);
 
-std::string getUniformName(const std::string& _str);
\ No newline at end of file
+std::string getUniformName(const std::string& _str);
+
+// The part of _source a pass compiles: the #ifdef/#if defined() blocks of the pass defines (BUFFER_N, DOUBLE_BUFFER_N,
+// CONVOLUTION_PYRAMID_N, POSTPROCESSING, ...) that _defines (space separated, like "BUFFER_0 DEBUG=1") rules out are
+// left out. Conditions on any other define can't be known from here and keep all their branches
+std::string passSource(const std::string& _source, const std::string& _defines);
+
+// Replaces gl_FragCoord with gl_FragCoord + _offsetUniform and declares that uniform right after the #version/precision
+// header, so the shader can render a tile of a bigger image
+std::string offsetFragCoord(const std::string& _source, const std::string& _offsetUniform);
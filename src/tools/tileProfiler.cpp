@@ -0,0 +1,230 @@
+#include "tileProfiler.h"
+
+#include "ada/string.h"
+
+#if defined(SUPPORT_GPU_TIMERS)
+// A few frames of a fine grid, results that never come back shouldn't grow the queue forever
+const size_t TILE_QUERIES_MAX_PENDING = 8192;
+#endif
+
+TileProfiler::TileProfiler(): m_gpu(-1), m_generation(0), m_target("canvas"), m_columns(16), m_rows(9), m_width(0), m_height(0) {
+}
+
+// Sandbox::clear() already did it while the context was there, this way nothing is left
+TileProfiler::~TileProfiler() {
+    clear();
+}
+
+void TileProfiler::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    if (!m_queryPool.empty())
+        glDeleteQueries(m_queryPool.size(), m_queryPool.data());
+    m_queryPool.clear();
+
+    for (size_t i = 0; i < m_queryPending.size(); i++) {
+        GLuint queries[2] = { m_queryPending[i].start, m_queryPending[i].end };
+        glDeleteQueries(2, queries);
+    }
+    m_queryPending.clear();
+    #endif
+}
+
+void TileProfiler::start(size_t _columns, size_t _rows, const std::string& _target) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_columns = std::max((size_t)1, _columns);
+    m_rows = std::max((size_t)1, _rows);
+    m_target = _target;
+    _reset();
+    m_running = true;
+}
+
+void TileProfiler::stop() {
+    m_running = false;
+}
+
+bool TileProfiler::isTarget(const std::string& _target) {
+    if (!m_running)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_target == _target;
+}
+
+size_t TileProfiler::getColumns() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_columns;
+}
+
+size_t TileProfiler::getRows() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rows;
+}
+
+std::string TileProfiler::getTarget() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_target;
+}
+
+// Results of the queries still in flight belong to the previous grid
+void TileProfiler::_reset() {
+    m_sumMs.assign(m_columns * m_rows, 0.0);
+    m_samples.assign(m_columns * m_rows, 0);
+    m_generation++;
+}
+
+void TileProfiler::render(int _width, int _height, const std::function<void()>& _pass) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (_width != m_width || _height != m_height) {
+        m_width = _width;
+        m_height = _height;
+        _reset();
+    }
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    if (m_gpu < 0) {
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        m_gpu = (bits > 0) ? 1 : 0;
+    }
+    _collect();
+    #else
+    m_gpu = 0;
+    #endif
+
+    GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+    glEnable(GL_SCISSOR_TEST);
+
+    for (size_t row = 0; row < m_rows; row++) {
+        int y0 = (int)(row * m_height / m_rows);
+        int y1 = (int)((row + 1) * m_height / m_rows);
+
+        for (size_t column = 0; column < m_columns; column++) {
+            int x0 = (int)(column * m_width / m_columns);
+            int x1 = (int)((column + 1) * m_width / m_columns);
+            size_t tile = row * m_columns + column;
+
+            glScissor(x0, y0, x1 - x0, y1 - y0);
+
+            #if defined(SUPPORT_GPU_TIMERS)
+            if (m_gpu > 0) {
+                if (m_queryPending.size() >= TILE_QUERIES_MAX_PENDING) {
+                    _pass();
+                    continue;
+                }
+
+                TileQuery query;
+                query.tile = tile;
+                query.generation = m_generation;
+                query.start = _queryTimestamp();
+                _pass();
+                query.end = _queryTimestamp();
+                m_queryPending.push_back(query);
+                continue;
+            }
+            #endif
+
+            glFinish();
+            StatPoint start = std::chrono::high_resolution_clock::now();
+            _pass();
+            glFinish();
+            m_sumMs[tile] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() * 0.001;
+            m_samples[tile]++;
+        }
+    }
+
+    if (!scissor)
+        glDisable(GL_SCISSOR_TEST);
+}
+
+#if defined(SUPPORT_GPU_TIMERS)
+GLuint TileProfiler::_queryTimestamp() {
+    if (m_queryPool.empty()) {
+        m_queryPool.resize(256);
+        glGenQueries(m_queryPool.size(), m_queryPool.data());
+    }
+
+    GLuint query = m_queryPool.back();
+    m_queryPool.pop_back();
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+}
+#endif
+
+// Like the tracker, it takes what the GPU is done with and never waits for the rest
+void TileProfiler::_collect() {
+    #if defined(SUPPORT_GPU_TIMERS)
+    while (!m_queryPending.empty()) {
+        const TileQuery& query = m_queryPending.front();
+
+        GLint available = 0;
+        glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(query.start, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+
+        if (query.generation == m_generation && query.tile < m_sumMs.size() && end >= start) {
+            m_sumMs[query.tile] += (end - start) * 0.000001;
+            m_samples[query.tile]++;
+        }
+
+        m_queryPool.push_back(query.start);
+        m_queryPool.push_back(query.end);
+        m_queryPending.pop_front();
+    }
+    #endif
+}
+
+double TileProfiler::getHeatmap(std::vector<float>& _rgba) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    double maxMs = 0.0;
+    for (size_t i = 0; i < m_sumMs.size(); i++)
+        if (m_samples[i] > 0)
+            maxMs = std::max(maxMs, m_sumMs[i] / m_samples[i]);
+
+    _rgba.assign(m_sumMs.size() * 4, 0.0f);
+    for (size_t i = 0; i < m_sumMs.size(); i++) {
+        if (m_samples[i] > 0 && maxMs > 0.0)
+            _rgba[i * 4] = (float)(m_sumMs[i] / m_samples[i] / maxMs);
+        _rgba[i * 4 + 3] = 1.0f;
+    }
+
+    return maxMs;
+}
+
+std::string TileProfiler::logTiles() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string log = "";
+
+    for (size_t row = 0; row < m_rows; row++) {
+        for (size_t column = 0; column < m_columns; column++) {
+            size_t tile = row * m_columns + column;
+            if (tile >= m_sumMs.size())
+                continue;
+
+            int x0 = (int)(column * m_width / m_columns);
+            int y0 = (int)(row * m_height / m_rows);
+            int x1 = (int)((column + 1) * m_width / m_columns);
+            int y1 = (int)((row + 1) * m_height / m_rows);
+
+            log +=  ada::toString(column) + "," +
+                    ada::toString(row) + "," +
+                    ada::toString(x0) + "," +
+                    ada::toString(y0) + "," +
+                    ada::toString(x1 - x0) + "," +
+                    ada::toString(y1 - y0) + "," +
+                    ada::toString(m_samples[tile]) + "," +
+                    (m_samples[tile] > 0 ? ada::toString(m_sumMs[tile] / m_samples[tile]) : "-") + "\n";
+        }
+    }
+
+    return log;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "tracker.h"
+
+/** Finds where on screen a pass spends its time: the pass is drawn once per tile of a grid,
+ *  each with the scissor test limiting it to that tile and bracketed by timestamp queries.
+ *  Results are collected without waiting on the GPU and averaged since start(). Where there
+ *  are no timer queries every tile is timed on the CPU between glFinish() calls instead.
+ *  start(), stop() and the logs can be called from any thread, render() only from the render one **/
+class TileProfiler {
+public:
+    TileProfiler();
+    virtual ~TileProfiler();
+
+    // _target is the pass to split: canvas or u_bufferN
+    void    start(size_t _columns, size_t _rows, const std::string& _target);
+    void    stop();
+
+    bool    isRunning() const { return m_running.load(); }
+    bool    isTarget(const std::string& _target);
+    size_t  getColumns();
+    size_t  getRows();
+    std::string getTarget();
+
+    // Draws _pass once per tile of a _width x _height viewport
+    void    render(int _width, int _height, const std::function<void()>& _pass);
+
+    // Deletes the timer queries, from the render thread while there is still a GL context
+    void    clear();
+
+    // Average ms of each tile divided by the most expensive one, as RGBA floats (the cost on red)
+    // row by row from the bottom, ready to load on a columns x rows texture. Returns the highest ms
+    double  getHeatmap(std::vector<float>& _rgba);
+
+    // column,row,x,y,width,height,samples,meanMs of every tile
+    std::string logTiles();
+
+protected:
+    void    _collect();
+    void    _reset();
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    struct TileQuery {
+        size_t      tile;
+        size_t      generation;
+        GLuint      start;
+        GLuint      end;
+    };
+
+    GLuint  _queryTimestamp();
+
+    std::vector<GLuint>     m_queryPool;
+    std::deque<TileQuery>   m_queryPending;
+    #endif
+    int                     m_gpu;      // -1 not checked yet, 0 no timer queries, 1 timing
+    size_t                  m_generation;
+
+    std::mutex              m_mutex;
+    std::string             m_target;
+    size_t                  m_columns;
+    size_t                  m_rows;
+    int                     m_width;
+    int                     m_height;
+    std::vector<double>     m_sumMs;
+    std::vector<size_t>     m_samples;
+
+    std::atomic<bool>       m_running {false};
+};
@@ -1,67 +1,396 @@
 #include "tracker.h"
 
+#include <math.h>
+
 #include "ada/string.h"
 
-Tracker::Tracker() {
+#if defined(SUPPORT_GPU_TIMERS)
+// Results that never come back shouldn't grow the queue forever
+const size_t GPU_QUERIES_MAX_PENDING = 4096;
+#endif
+
+// A bit more than a minute at 60fps
+const size_t TRACK_DEFAULT_CAPACITY = 4096;
+
+// One frame at 60fps
+const double TRACK_DEFAULT_BUDGET = 1000.0 / 60.0;
+
+// Values under HISTOGRAM_LINEAR us get a bucket each, above every power of two is split in
+// HISTOGRAM_LINEAR/2 buckets, up to 2^HISTOGRAM_OCTAVES us (more than a day)
+const size_t HISTOGRAM_LINEAR = 256;
+const size_t HISTOGRAM_OCTAVES = 37;
+const size_t HISTOGRAM_BUCKETS = HISTOGRAM_LINEAR + (HISTOGRAM_OCTAVES - 8) * HISTOGRAM_LINEAR / 2;
+
+void StatHistogram::add(double _ms) {
+    if (buckets.empty())
+        buckets.assign(HISTOGRAM_BUCKETS, 0);
+
+    uint64_t us = (_ms > 0.0) ? (uint64_t)(_ms * 1000.0) : 0;
+    size_t index = 0;
+    if (us < HISTOGRAM_LINEAR)
+        index = (size_t)us;
+    else {
+        size_t octave = 0;
+        while (us >= HISTOGRAM_LINEAR) {
+            us >>= 1;
+            octave++;
+        }
+        index = HISTOGRAM_LINEAR + (octave - 1) * HISTOGRAM_LINEAR / 2 + ((size_t)us - HISTOGRAM_LINEAR / 2);
+    }
+    buckets[std::min(index, HISTOGRAM_BUCKETS - 1)]++;
+
+    count++;
+    if (count == 1 || _ms < min)
+        min = _ms;
+    if (count == 1 || _ms > max)
+        max = _ms;
+    double delta = _ms - mean;
+    mean += delta / (double)count;
+    m2 += delta * (_ms - mean);
+}
 
+void StatHistogram::clear() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    count = 0;
+    min = max = mean = m2 = 0.0;
 }
 
-Tracker::~Tracker() {
+double StatHistogram::stddev() const {
+    return (count > 1) ? sqrt(m2 / (double)(count - 1)) : 0.0;
+}
+
+double StatHistogram::percentile(double _percent) const {
+    if (count == 0)
+        return 0.0;
+
+    uint64_t target = (uint64_t)ceil(_percent * 0.01 * (double)count);
+    target = std::max((uint64_t)1, std::min(target, (uint64_t)count));
+
+    uint64_t seen = 0;
+    size_t index = 0;
+    for (; index < buckets.size(); index++) {
+        seen += buckets[index];
+        if (seen >= target)
+            break;
+    }
 
+    // middle of the bucket, which can't be further than what was actually seen
+    double us = 0.0;
+    if (index < HISTOGRAM_LINEAR)
+        us = index + 0.5;
+    else {
+        size_t octave = (index - HISTOGRAM_LINEAR) / (HISTOGRAM_LINEAR / 2) + 1;
+        size_t sub = (index - HISTOGRAM_LINEAR) % (HISTOGRAM_LINEAR / 2) + HISTOGRAM_LINEAR / 2;
+        us = ((double)sub + 0.5) * (double)((uint64_t)1 << octave);
+    }
+    return std::max(min, std::min(max, us * 0.001));
+}
+
+Tracker::Tracker(): m_trackerStart(0.0), m_capacity(TRACK_DEFAULT_CAPACITY), m_budget(TRACK_DEFAULT_BUDGET) {
+
+}
+
+Tracker::~Tracker() {
+    if (m_spill.is_open())
+        m_spill.close();
 }
 
 void Tracker::start() {
-    m_data.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Tracks keep their ids, only their samples go away
+    for (size_t i = 0; i < m_data.size(); i++) {
+        m_data[i].total = 0;
+        m_data[i].durationAverage = 0.0;
+        m_data[i].histogram.clear();
+        m_data[i].overBudget = 0;
+    }
+    m_counters.clear();
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    // queries still on their way belong to the previous run
+    m_generation++;
+    #endif
 
     auto start = std::chrono::high_resolution_clock::now();
     m_trackerStart = std::chrono::time_point_cast<std::chrono::microseconds>(start).time_since_epoch().count() * 0.001;
     m_running = true;
 }
 
-void Tracker::begin(const std::string& _track) {
+size_t Tracker::getId(const std::string& _track) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return _getId(_track);
+}
+
+size_t Tracker::_getId(const std::string& _track) {
+    std::map<std::string, size_t>::iterator it = m_ids.find(_track);
+    if (it != m_ids.end())
+        return it->second;
+
+    size_t id = m_data.size();
+    m_ids[_track] = id;
+    m_data.push_back(StatTrack());
+    m_data[id].name = _track;
+    return id;
+}
+
+void Tracker::getIds(const std::string& _prefix, size_t _count, std::vector<size_t>& _ids) {
+    if (_ids.size() == _count)
+        return;
+
+    _ids.resize(_count);
+    for (size_t i = 0; i < _count; i++)
+        _ids[i] = getId(_prefix + ada::toString(i));
+}
+
+void Tracker::setCapacity(size_t _samples) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = std::max((size_t)1, _samples);
+    for (size_t i = 0; i < m_data.size(); i++) {
+        m_data[i].samples.clear();
+        m_data[i].total = 0;
+        m_data[i].histogram.clear();
+        m_data[i].overBudget = 0;
+    }
+    m_counters.clear();
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    m_generation++;
+    #endif
+}
+
+bool Tracker::setSpill(const std::string& _file) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spill.is_open())
+        m_spill.close();
+
+    m_spillFile = _file;
+    if (m_spillFile.empty())
+        return true;
+
+    m_spill.open(m_spillFile, std::ios::out | std::ios::app);
+    if (!m_spill.is_open()) {
+        m_spillFile = "";
+        return false;
+    }
+
+    if (m_spill.tellp() == 0)
+        m_spill << "track,timeStampMs,durationMs,gpuDurationMs\n";
+    return true;
+}
+
+void Tracker::setBudget(double _ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = _ms;
+}
+
+size_t Tracker::getThreadId() {
+    static std::atomic<size_t> next(1);
+    thread_local size_t id = next++;
+    return id;
+}
+
+void Tracker::setThreadName(const std::string& _name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threadNames[getThreadId()] = _name;
+}
+
+void Tracker::begin(size_t _id) {
     if (!m_running)
         return;
 
-    if ( m_data.find(_track) == m_data.end() )
-        m_tracks.push_back(_track);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (_id >= m_data.size())
+        return;
+
+    StatTrack& track = m_data[_id];
+    track.start = std::chrono::high_resolution_clock::now();
 
-    m_data[_track].start = std::chrono::high_resolution_clock::now();
+    #if defined(SUPPORT_GPU_TIMERS)
+    if (m_gpu < 0) {
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        m_gpu = (bits > 0) ? 1 : 0;
+    }
+
+    if (m_gpu > 0) {
+        if (track.gpuStart)
+            m_queryPool.push_back(track.gpuStart);
+        track.gpuStart = _queryTimestamp();
+    }
+    #endif
 }
 
-void Tracker::end(const std::string& _track) {
+void Tracker::end(size_t _id) {
     if (!m_running)
         return;
 
-    auto sample_end = std::chrono::high_resolution_clock::now();
+    StatPoint sample_end = std::chrono::high_resolution_clock::now();
 
-    if ( m_data.find(_track) == m_data.end() )
-        m_tracks.push_back(_track);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (_id >= m_data.size())
+        return;
+
+    StatTrack& track = m_data[_id];
+    bool added = _push(track, track.start, sample_end);
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    if (m_gpu > 0 && track.gpuStart) {
+        if (added && m_queryPending.size() < GPU_QUERIES_MAX_PENDING) {
+            GpuQuery query;
+            query.track = _id;
+            query.sample = track.total - 1;
+            query.generation = m_generation;
+            query.start = track.gpuStart;
+            query.end = _queryTimestamp();
+            m_queryPending.push_back(query);
+        }
+        else
+            m_queryPool.push_back(track.gpuStart);
+        track.gpuStart = 0;
+    }
+
+    _collectQueries();
+    #endif
+}
+
+void Tracker::sample(size_t _id, const StatPoint& _start, const StatPoint& _end) {
+    if (!m_running)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (_id < m_data.size())
+        _push(m_data[_id], _start, _end);
+}
+
+void Tracker::counter(const std::string& _name, double _value) {
+    if (!m_running)
+        return;
+
+    auto now = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now()).time_since_epoch();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    StatCounter& counter = m_counters[_name];
+    if (counter.total > 0 && counter.value == _value)
+        return;
+
+    if (counter.total == 0)
+        counter.name = _name;
+    counter.value = _value;
+    counter.peak = (counter.total == 0) ? _value : std::max(counter.peak, _value);
+
+    if (counter.changes.size() != m_capacity)
+        counter.changes.resize(m_capacity);
+    counter.changes[counter.total % m_capacity] = std::make_pair(now.count() * 0.001 - m_trackerStart, _value);
+    counter.total++;
+}
+
+bool Tracker::_push(StatTrack& _track, const StatPoint& _start, const StatPoint& _end) {
+    auto start = std::chrono::time_point_cast<std::chrono::microseconds>(_start).time_since_epoch();
+    auto end = std::chrono::time_point_cast<std::chrono::microseconds>(_end).time_since_epoch();
 
-    auto start = std::chrono::time_point_cast<std::chrono::microseconds>(m_data[_track].start).time_since_epoch();
-    auto end = std::chrono::time_point_cast<std::chrono::microseconds>(sample_end).time_since_epoch();
-    
     StatSample stat;
     stat.startMs = start.count() * 0.001 - m_trackerStart;
     stat.endMs = end.count() * 0.001 - m_trackerStart;
     stat.durationMs = stat.endMs - stat.startMs;
+    stat.gpuDurationMs = -1.0;
+    stat.thread = getThreadId();
+
+    if (stat.startMs < 0.0)
+        return false;
+
+    if (_track.samples.size() != m_capacity)
+        _track.samples.resize(m_capacity);
+
+    StatSample& slot = _track.samples[_track.total % m_capacity];
+    if (_track.total >= m_capacity)
+        _spill(_track, slot);
+    slot = stat;
+    _track.total++;
 
-    if (stat.startMs > 0)
-        m_data[_track].samples.push_back( stat );
+    _track.histogram.add(stat.durationMs);
+    if (stat.durationMs > m_budget)
+        _track.overBudget++;
+    return true;
 }
 
+void Tracker::_spill(const StatTrack& _track, const StatSample& _sample) {
+    if (!m_spill.is_open())
+        return;
+
+    m_spill <<  _track.name + "," +
+                ada::toString(_sample.startMs) + "," +
+                ada::toString(_sample.durationMs) + "," +
+                (_sample.gpuDurationMs >= 0.0 ? ada::toString(_sample.gpuDurationMs) : "-") + "\n";
+}
+
+#if defined(SUPPORT_GPU_TIMERS)
+GLuint Tracker::_queryTimestamp() {
+    if (m_queryPool.empty()) {
+        m_queryPool.resize(64);
+        glGenQueries(m_queryPool.size(), m_queryPool.data());
+    }
+
+    GLuint query = m_queryPool.back();
+    m_queryPool.pop_back();
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+}
+
+/** Reads the results of the queries the GPU is already done with, which usually are the ones
+ *  issued a couple of frames ago. It never waits: queries finish in the order they were issued,
+ *  so it stops on the first one that is not available yet. **/
+void Tracker::_collectQueries() {
+    while (!m_queryPending.empty()) {
+        const GpuQuery& query = m_queryPending.front();
+
+        GLint available = 0;
+        glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(query.start, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+
+        // unless the sample was already pushed out of the ring
+        if (query.generation == m_generation) {
+            StatTrack& track = m_data[query.track];
+            if (query.sample < track.total && query.sample + track.samples.size() >= track.total)
+                track.samples[query.sample % track.samples.size()].gpuDurationMs = (end - start) * 0.000001;
+        }
+
+        m_queryPool.push_back(query.start);
+        m_queryPool.push_back(query.end);
+        m_queryPending.pop_front();
+    }
+}
+#endif
+
 void Tracker::stop() {
     m_running = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spill.is_open())
+        m_spill.flush();
 }
 
 double  Tracker::getFramerate() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     double frm = 0.0;
     int count = 0;
-    for (std::map<std::string, StatTrack>::iterator it = m_data.begin() ; it != m_data.end(); ++it) {   
+    for (size_t t = 0; t < m_data.size(); t++) {
+        const StatTrack& track = m_data[t];
+        if (track.size() < 2)
+            continue;
+
         double delta = 0.0;
-        for (size_t i = 1; i < it->second.samples.size(); i++) 
-            delta += (it->second.samples[i].startMs - it->second.samples[i-1].startMs);
-        
-        delta /= (double) (it->second.samples.size() - 1);
+        for (size_t i = 1; i < track.size(); i++)
+            delta += (track.at(i).startMs - track.at(i-1).startMs);
+
+        delta /= (double) (track.size() - 1);
         frm += delta;
         count++;
     }
@@ -74,63 +403,226 @@ std::string Tracker::logFramerate() {
             // "fps," + ada::toString( (1./getFramerate()) * 1000.0 ) ;
 }
 
+std::string Tracker::logCounters() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string log = "";
+
+    for (std::map<std::string, StatCounter>::iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+        log += it->first + "," + ada::toString(it->second.value) + "," + ada::toString(it->second.peak) + "\n";
+
+    return log;
+}
+
 std::string Tracker::logSamples() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::string log = "";
 
-    for (size_t t = 0; t < m_tracks.size(); t++)
-        log += logSamples(m_tracks[t]);
+    for (size_t t = 0; t < m_data.size(); t++)
+        log += _logSamples(m_data[t]);
 
     return log;
 }
 
 std::string Tracker::logSamples(const std::string& _track) {
-    std::map<std::string, StatTrack>::iterator it = m_data.find(_track);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, size_t>::iterator it = m_ids.find(_track);
 
-    if ( it == m_data.end() )
+    if ( it == m_ids.end() )
         return "";
 
+    return _logSamples(m_data[it->second]);
+}
+
+std::string Tracker::_logSamples(const StatTrack& _track) {
     std::string log = "";
-    std::string track_name = it->first;
-    
-    for (size_t i = 0; i < it->second.samples.size(); i++)
-        log +=  track_name + "," + 
-                ada::toString(it->second.samples[i].startMs) + "," + 
-                ada::toString(it->second.samples[i].durationMs) + "\n";
+
+    for (size_t i = 0; i < _track.size(); i++)
+        log +=  _track.name + "," +
+                ada::toString(_track.at(i).startMs) + "," +
+                ada::toString(_track.at(i).durationMs) + "," +
+                (_track.at(i).gpuDurationMs >= 0.0 ? ada::toString(_track.at(i).gpuDurationMs) : "-") + "\n";
 
     return log;
 }
 
 std::string Tracker::logAverage() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::string log = "";
 
-    for (size_t t = 0; t < m_tracks.size(); t++)
-        log += logAverage(m_tracks[t]);
+    for (size_t t = 0; t < m_data.size(); t++)
+        log += _logAverage(m_data[t]);
 
     return log;
 }
 
 std::string Tracker::logAverage(const std::string& _track) {
-    std::map<std::string, StatTrack>::iterator it = m_data.find(_track);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, size_t>::iterator it = m_ids.find(_track);
+
+    if ( it == m_ids.end() )
+        return "";
+
+    return _logAverage(m_data[it->second]);
+}
 
-    if ( it == m_data.end() )
+std::string Tracker::_logAverage(StatTrack& _track) {
+    if (_track.size() == 0)
         return "";
 
     std::string log = "";
-    std::string track_name = it->first;
 
     double average = 0.0;
+    double gpuAverage = 0.0;
+    size_t gpuCount = 0;
     double delta = 0.0;
-    for (size_t i = 0; i < it->second.samples.size(); i++) {
-        average += it->second.samples[i].durationMs;
+    for (size_t i = 0; i < _track.size(); i++) {
+        const StatSample& sample = _track.at(i);
+        average += sample.durationMs;
+        if (sample.gpuDurationMs >= 0.0) {
+            gpuAverage += sample.gpuDurationMs;
+            gpuCount++;
+        }
         if (i > 0)
-            delta += it->second.samples[i].startMs - it->second.samples[i-1].startMs;
+            delta += sample.startMs - _track.at(i-1).startMs;
     }
 
-    average /= (double)it->second.samples.size();
-    delta /= (double)it->second.samples.size() - 1.0;
-    it->second.durationAverage = average;
-    
-    log += track_name + "," + ada::toString(average) + "," + ada::toString( (average/delta) * 100.0) + "," + ada::toString(delta) +  "\n";
+    average /= (double)_track.size();
+    _track.durationAverage = average;
+
+    // a single sample has no delta, its percent and delta columns print "-"
+    bool hasDelta = _track.size() > 1 && delta > 0.0;
+    if (hasDelta)
+        delta /= (double)_track.size() - 1.0;
+
+    log += _track.name + "," + ada::toString(average) + "," + (gpuCount > 0 ? ada::toString(gpuAverage / gpuCount) : "-") + "," + (hasDelta ? ada::toString( (average/delta) * 100.0) : "-") + "," + (hasDelta ? ada::toString(delta) : "-") +  "\n";
 
     return log;
 }
+
+std::vector<std::string> Tracker::getTracks() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> tracks;
+
+    for (size_t t = 0; t < m_data.size(); t++)
+        if (m_data[t].histogram.count > 0)
+            tracks.push_back(m_data[t].name);
+
+    return tracks;
+}
+
+bool Tracker::getStats(const std::string& _track, StatHistogram& _histogram, double& _gpuAverage, size_t& _overBudget) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, size_t>::iterator it = m_ids.find(_track);
+
+    if ( it == m_ids.end() )
+        return false;
+
+    const StatTrack& track = m_data[it->second];
+    _histogram = track.histogram;
+    _overBudget = track.overBudget;
+
+    double gpu = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < track.size(); i++)
+        if (track.at(i).gpuDurationMs >= 0.0) {
+            gpu += track.at(i).gpuDurationMs;
+            count++;
+        }
+    _gpuAverage = (count > 0) ? gpu / (double)count : -1.0;
+
+    return true;
+}
+
+std::string Tracker::logStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string log = "";
+
+    for (size_t t = 0; t < m_data.size(); t++)
+        log += _logStats(m_data[t]);
+
+    return log;
+}
+
+std::string Tracker::logStats(const std::string& _track) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<std::string, size_t>::iterator it = m_ids.find(_track);
+
+    if ( it == m_ids.end() )
+        return "";
+
+    return _logStats(m_data[it->second]);
+}
+
+std::string Tracker::_logStats(const StatTrack& _track) {
+    const StatHistogram& hist = _track.histogram;
+    if (hist.count == 0)
+        return "";
+
+    return  _track.name + "," +
+            ada::toString(hist.count) + "," +
+            ada::toString(hist.min) + "," +
+            ada::toString(hist.max) + "," +
+            ada::toString(hist.mean) + "," +
+            ada::toString(hist.stddev()) + "," +
+            ada::toString(hist.percentile(50.0)) + "," +
+            ada::toString(hist.percentile(90.0)) + "," +
+            ada::toString(hist.percentile(99.0)) + "," +
+            ada::toString(hist.percentile(99.9)) + "," +
+            ada::toString(_track.overBudget) + "\n";
+}
+
+namespace {
+
+std::string jsonString(const std::string& _str) {
+    std::string rta = "\"";
+    for (size_t i = 0; i < _str.size(); i++) {
+        if (_str[i] == '"' || _str[i] == '\\')
+            rta += '\\';
+        rta += _str[i];
+    }
+    return rta + "\"";
+}
+
+}
+
+std::string Tracker::logTrace() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::string log = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    std::string sep = "";
+
+    for (std::map<size_t, std::string>::iterator it = m_threadNames.begin(); it != m_threadNames.end(); ++it) {
+        log += sep + "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + ada::toString(it->first) + ",\"args\":{\"name\":" + jsonString(it->second) + "}}";
+        sep = ",\n";
+    }
+
+    // Complete events, nesting comes from the timestamps of each thread
+    for (size_t t = 0; t < m_data.size(); t++) {
+        const StatTrack& track = m_data[t];
+        std::string name = jsonString(track.name);
+        for (size_t i = 0; i < track.size(); i++) {
+            const StatSample& sample = track.at(i);
+            log +=  sep + "{\"name\":" + name + ",\"cat\":\"glslViewer\",\"ph\":\"X\",\"pid\":1,\"tid\":" + ada::toString(sample.thread) +
+                    ",\"ts\":" + ada::toString(sample.startMs * 1000.0, 3) + ",\"dur\":" + ada::toString(sample.durationMs * 1000.0, 3);
+            if (sample.gpuDurationMs >= 0.0)
+                log += ",\"args\":{\"gpuMs\":" + ada::toString(sample.gpuDurationMs, 4) + "}";
+            log += "}";
+            sep = ",\n";
+        }
+    }
+
+    // Counter events draw as a graph over the threads
+    for (std::map<std::string, StatCounter>::iterator it = m_counters.begin(); it != m_counters.end(); ++it) {
+        const StatCounter& counter = it->second;
+        std::string name = jsonString(counter.name);
+        size_t size = std::min(counter.total, counter.changes.size());
+        for (size_t i = 0; i < size; i++) {
+            const std::pair<double, double>& change = counter.changes[(counter.total - size + i) % counter.changes.size()];
+            log +=  sep + "{\"name\":" + name + ",\"ph\":\"C\",\"pid\":1,\"ts\":" + ada::toString(change.first * 1000.0, 3) +
+                    ",\"args\":{\"value\":" + ada::toString(change.second, 3) + "}}";
+            sep = ",\n";
+        }
+    }
+
+    return log + "\n]}\n";
+}
@@ -1,26 +1,82 @@
 #pragma once
 
 #include <map>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <algorithm>
 #include <vector>
 #include <string>
+#include <stdint.h>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 
+#include "ada/gl/gl.h"
+
+#if defined(GL_TIMESTAMP) && !defined(__EMSCRIPTEN__)
+#define SUPPORT_GPU_TIMERS
+#endif
+
 typedef std::chrono::time_point<std::chrono::high_resolution_clock> StatPoint;
 
 struct StatSample {
     double       startMs;
     double       endMs;
     double       durationMs;
+    double       gpuDurationMs;     // negative until the GPU result arrives, or if there is none
+    size_t       thread;
 };
 
+/** Log-linear histogram of durations in microseconds, HDR histogram style: exact under 256us,
+ *  then 128 buckets per power of two. Any value is kept within 0.8% and memory stays constant
+ *  no matter how many samples go in **/
+struct StatHistogram {
+    std::vector<uint32_t>   buckets;
+    size_t                  count = 0;
+    double                  min = 0.0;
+    double                  max = 0.0;
+    double                  mean = 0.0;
+    double                  m2 = 0.0;       // sum of squared differences to the mean (Welford)
+
+    void    add(double _ms);
+    void    clear();
+    double  stddev() const;
+    // Duration under which _percent of the samples are, in ms
+    double  percentile(double _percent) const;
+};
+
+/** Samples of one track live on a fixed ring, once it's full every new sample
+ *  takes the place of the oldest one, which goes to the spill file if there is one **/
 struct StatTrack {
-    std::string             stack;
+    std::string             name;
     StatPoint               start;
     std::vector<StatSample> samples;
-    double                  durationAverage;
+    size_t                  total = 0;      // samples taken since start(), the last one is at (total - 1) % capacity
+    double                  durationAverage = 0.0;
+    StatHistogram           histogram;      // every sample since start(), not only the ones on the ring
+    size_t                  overBudget = 0; // samples that took longer than the budget
+    #if defined(SUPPORT_GPU_TIMERS)
+    GLuint                  gpuStart = 0;
+    #endif
+
+    size_t  size() const { return std::min(total, samples.size()); }
+    // i-th oldest sample still on the ring
+    const StatSample& at(size_t _i) const { return samples[(total - size() + _i) % samples.size()]; }
+};
+
+/** A value that changes over time (like the memory in use) rather than a duration. Only the
+ *  changes are kept, on a ring like the samples **/
+struct StatCounter {
+    std::string             name;
+    double                  value = 0.0;
+    double                  peak = 0.0;     // high-water mark since start()
+    std::vector< std::pair<double, double> > changes;   // timeStampMs, value
+    size_t                  total = 0;
 };
 
+/** Every method can be called from any thread. begin() and end() are meant for the render
+ *  thread, other threads time their work with sample() or a TrackerScope **/
 class Tracker {
 public:
     Tracker();
@@ -29,26 +85,127 @@ public:
     void    start();
     void    stop();
 
-    void    begin(const std::string& _track);
-    void    end(const std::string& _track);
+    // Tracks are registered once and then referred by their id, which never changes
+    size_t  getId(const std::string& _track);
+    // Ids of _prefix0, _prefix1, ... _prefix<_count - 1>, only looked up when _count changes
+    void    getIds(const std::string& _prefix, size_t _count, std::vector<size_t>& _ids);
+
+    // Both must be called from the thread that owns the GL context, between the two the GPU
+    // time is measured with timestamp queries, which unlike GL_TIME_ELAPSED can be nested
+    void    begin(size_t _id);
+    void    end(size_t _id);
+    void    begin(const std::string& _track) { begin( getId(_track) ); }
+    void    end(const std::string& _track) { end( getId(_track) ); }
+
+    // Adds a sample measured by the calling thread
+    void    sample(size_t _id, const StatPoint& _start, const StatPoint& _end);
+
+    // Sets the current value of a counter, only its changes are recorded
+    void    counter(const std::string& _name, double _value);
+
+    // Small number that identifies the calling thread on the samples, and the name it gets on traces
+    static size_t getThreadId();
+    void    setThreadName(const std::string& _name);
+
+    // Samples kept in memory per track, changing it drops the current ones
+    void    setCapacity(size_t _samples);
+    size_t  getCapacity() const { return m_capacity; }
+
+    // Samples pushed out of the rings are appended to this CSV file, empty to stop
+    bool    setSpill(const std::string& _file);
+    const std::string& getSpill() const { return m_spillFile; }
+
+    // Samples longer than this (in ms) count as janky on the stats
+    void    setBudget(double _ms);
+    double  getBudget() const { return m_budget; }
 
     double  getFramerate();
 
+    // Names of the tracks with samples, in the order they were registered
+    std::vector<std::string> getTracks();
+    // Copy of the histogram of _track and the average GPU time of the samples on its ring (negative if none)
+    bool    getStats(const std::string& _track, StatHistogram& _histogram, double& _gpuAverage, size_t& _overBudget);
+
     std::string logSamples();
     std::string logSamples(const std::string& _track);
     std::string logAverage();
     std::string logAverage(const std::string& _track);
     std::string logFramerate();
+    // name, current value and peak of every counter
+    std::string logCounters();
+    // count, min, max, mean, stddev, p50, p90, p99, p99.9 and samples over budget of each track
+    std::string logStats();
+    std::string logStats(const std::string& _track);
 
-    bool    isRunning() const { return m_running; }
+    // Chrome Trace Event JSON, loads on chrome://tracing or ui.perfetto.dev
+    std::string logTrace();
+
+    bool    isRunning() const { return m_running.load(); }
+    bool    isTimingGPU() const { return m_gpu > 0; }
 
 protected:
+    size_t  _getId(const std::string& _track);
+    bool    _push(StatTrack& _track, const StatPoint& _start, const StatPoint& _end);
+    std::string _logSamples(const StatTrack& _track);
+    std::string _logAverage(StatTrack& _track);
+    std::string _logStats(const StatTrack& _track);
+    void    _spill(const StatTrack& _track, const StatSample& _sample);
+
+    #if defined(SUPPORT_GPU_TIMERS)
+    struct GpuQuery {
+        size_t      track;
+        size_t      sample;
+        size_t      generation;
+        GLuint      start;
+        GLuint      end;
+    };
+
+    GLuint  _queryTimestamp();
+    void    _collectQueries();
+
+    std::vector<GLuint>     m_queryPool;
+    std::deque<GpuQuery>    m_queryPending;
+    size_t                  m_generation = 0;
+    #endif
+    int                     m_gpu = -1;     // -1 not checked yet, 0 no timer queries, 1 timing
 
     double                  m_trackerStart;
 
-    std::vector<std::string>            m_tracks;
-    std::map<std::string, StatTrack>    m_data;
+    std::mutex                      m_mutex;
+    std::map<std::string, size_t>   m_ids;
+    std::vector<StatTrack>          m_data;
+    size_t                          m_capacity;
+    double                          m_budget;
+
+    std::string             m_spillFile;
+    std::ofstream           m_spill;
 
-    bool                    m_running = false;
+    std::map<size_t, std::string>   m_threadNames;
+    std::map<std::string, StatCounter> m_counters;
 
-};
\ No newline at end of file
+    std::atomic<bool>       m_running {false};
+
+};
+
+/** Times the scope it lives in as one sample of _track, on whatever thread it runs.
+ *  Does nothing if there is no tracker or it's not running **/
+class TrackerScope {
+public:
+    TrackerScope(Tracker* _tracker, const std::string& _track) :
+        m_tracker( (_tracker && _tracker->isRunning()) ? _tracker : nullptr), m_id(0) {
+        if (m_tracker) {
+            m_id = m_tracker->getId(_track);
+            m_start = std::chrono::high_resolution_clock::now();
+        }
+    }
+
+    ~TrackerScope() {
+        if (m_tracker)
+            m_tracker->sample(m_id, m_start, std::chrono::high_resolution_clock::now());
+    }
+
+private:
+    Tracker*    m_tracker;
+    size_t      m_id;
+    StatPoint   m_start;
+};
@@ -0,0 +1,250 @@
+#include "videoEncoder.h"
+
+#if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
+
+#include <chrono>
+#include <iostream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+VideoEncoder::VideoEncoder():
+    m_format(nullptr), m_codec(nullptr), m_stream(nullptr), m_frame(nullptr), m_packet(nullptr), m_sws(nullptr),
+    m_pts(0), m_srcFrames(0), m_frames(0), m_totalMs(0.0), m_maxMs(0.0) {
+}
+
+VideoEncoder::~VideoEncoder() {
+    close();
+}
+
+bool VideoEncoder::open(const RecordingSettings& _settings) {
+    close();
+
+    m_settings = _settings;
+    m_pts = 0;
+    m_srcFrames = 0;
+    m_frames = 0;
+    m_totalMs = 0.0;
+    m_maxMs = 0.0;
+
+    if (avformat_alloc_output_context2(&m_format, NULL, NULL, m_settings.trg_path.c_str()) < 0 || !m_format) {
+        std::cerr << "VideoEncoder: unknown container for " << m_settings.trg_path << std::endl;
+        _free();
+        return false;
+    }
+
+    // Use the requested encoder, or the default one of the container if it's not available on this build
+    const AVCodec* codec = NULL;
+    if (!m_settings.trg_codec.empty())
+        codec = avcodec_find_encoder_by_name(m_settings.trg_codec.c_str());
+    if (!codec)
+        codec = avcodec_find_encoder(m_format->oformat->video_codec);
+    if (!codec) {
+        std::cerr << "VideoEncoder: no encoder found for " << m_settings.trg_path << std::endl;
+        _free();
+        return false;
+    }
+    m_codecName = codec->name;
+
+    m_stream = avformat_new_stream(m_format, NULL);
+    m_codec = avcodec_alloc_context3(codec);
+    if (!m_stream || !m_codec) {
+        _free();
+        return false;
+    }
+
+    AVPixelFormat pix_fmt = av_get_pix_fmt(m_settings.trg_pix_fmt.c_str());
+    if (pix_fmt == AV_PIX_FMT_NONE)
+        pix_fmt = AV_PIX_FMT_YUV420P;
+
+    m_codec->codec_id = codec->id;
+    m_codec->width = (int)m_settings.trg_width;
+    m_codec->height = (int)m_settings.trg_height;
+    m_codec->pix_fmt = pix_fmt;
+    m_codec->framerate = av_d2q(m_settings.trg_fps, 100000);
+    m_codec->time_base = av_inv_q(m_codec->framerate);
+    m_codec->gop_size = m_settings.trg_gop;
+    if (m_settings.trg_bitrate > 0)
+        m_codec->bit_rate = (int64_t)m_settings.trg_bitrate * 1000;
+    if (m_format->oformat->flags & AVFMT_GLOBALHEADER)
+        m_codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (m_settings.src_yuv) {
+        m_codec->colorspace = (m_settings.src_yuv == 709) ? AVCOL_SPC_BT709 : AVCOL_SPC_SMPTE170M;
+        m_codec->color_range = m_settings.src_yuv_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+    }
+
+    // Private options that the codec doesn't know about are left on the dictionary and ignored
+    AVDictionary* options = NULL;
+    if (m_settings.trg_crf >= 0)
+        av_dict_set_int(&options, "crf", m_settings.trg_crf, 0);
+
+    int err = avcodec_open2(m_codec, codec, &options);
+    av_dict_free(&options);
+    if (err < 0) {
+        std::cerr << "VideoEncoder: can't open " << m_codecName << " encoder" << std::endl;
+        _free();
+        return false;
+    }
+
+    avcodec_parameters_from_context(m_stream->codecpar, m_codec);
+    m_stream->time_base = m_codec->time_base;
+
+    if ( !(m_format->oformat->flags & AVFMT_NOFILE) &&
+         avio_open(&m_format->pb, m_settings.trg_path.c_str(), AVIO_FLAG_WRITE) < 0 ) {
+        std::cerr << "VideoEncoder: can't write " << m_settings.trg_path << std::endl;
+        _free();
+        return false;
+    }
+
+    if (avformat_write_header(m_format, NULL) < 0) {
+        std::cerr << "VideoEncoder: can't write the header of " << m_settings.trg_path << std::endl;
+        _free();
+        return false;
+    }
+
+    m_frame = av_frame_alloc();
+    m_packet = av_packet_alloc();
+    if (!m_frame || !m_packet) {
+        _free();
+        return false;
+    }
+    m_frame->format = m_codec->pix_fmt;
+    m_frame->width = m_codec->width;
+    m_frame->height = m_codec->height;
+    if (av_frame_get_buffer(m_frame, 0) < 0) {
+        _free();
+        return false;
+    }
+
+    AVPixelFormat src_fmt = (m_settings.src_channels == 4) ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+    if (m_settings.src_yuv)
+        src_fmt = AV_PIX_FMT_YUV420P;
+
+    m_sws = sws_getContext( (int)m_settings.src_width, (int)m_settings.src_height, src_fmt,
+                            m_codec->width, m_codec->height, m_codec->pix_fmt,
+                            SWS_LANCZOS, NULL, NULL, NULL);
+    if (!m_sws) {
+        _free();
+        return false;
+    }
+
+    // Frames converted on the GPU keep their matrix and range, so swscale only has to copy (or scale) them
+    if (m_settings.src_yuv) {
+        const int* coefs = sws_getCoefficients( (m_settings.src_yuv == 709) ? SWS_CS_ITU709 : SWS_CS_ITU601 );
+        int range = m_settings.src_yuv_full ? 1 : 0;
+        sws_setColorspaceDetails(m_sws, coefs, range, coefs, range, 0, 1 << 16, 1 << 16);
+    }
+
+    return true;
+}
+
+bool VideoEncoder::encode(const unsigned char* _pixels) {
+    if (!isOpen() || !_pixels)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (av_frame_make_writable(m_frame) < 0)
+        return false;
+
+    // OpenGL rows go bottom up, reading them with a negative stride flips the image for free
+    const int width = (int)m_settings.src_width;
+    const int height = (int)m_settings.src_height;
+    if (m_settings.src_yuv) {
+        const unsigned char* y = _pixels;
+        const unsigned char* u = y + width * height;
+        const unsigned char* v = u + (width / 2) * (height / 2);
+        const uint8_t* src[3] = {   y + (height - 1) * width,
+                                    u + (height / 2 - 1) * (width / 2),
+                                    v + (height / 2 - 1) * (width / 2) };
+        const int srcStride[3] = { -width, -width / 2, -width / 2 };
+        sws_scale(m_sws, src, srcStride, 0, height, m_frame->data, m_frame->linesize);
+    }
+    else {
+        const int stride = width * (int)m_settings.src_channels;
+        const uint8_t* src[1] = { _pixels + (height - 1) * stride };
+        const int srcStride[1] = { -stride };
+        sws_scale(m_sws, src, srcStride, 0, height, m_frame->data, m_frame->linesize);
+    }
+
+    // Drop or repeat the frame so the output keeps trg_fps
+    m_srcFrames++;
+    bool ok = true;
+    while (ok && m_pts < (long long)(m_srcFrames * m_settings.trg_fps / m_settings.src_fps + 0.5)) {
+        m_frame->pts = m_pts++;
+        ok = _send(m_frame);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_frames++;
+    m_totalMs += ms;
+    if (ms > m_maxMs)
+        m_maxMs = ms;
+
+    return ok;
+}
+
+bool VideoEncoder::_send(AVFrame* _frame) {
+    int err = avcodec_send_frame(m_codec, _frame);
+    if (err < 0)
+        return false;
+
+    while (err >= 0) {
+        err = avcodec_receive_packet(m_codec, m_packet);
+        if (err == AVERROR(EAGAIN) || err == AVERROR_EOF)
+            return true;
+        else if (err < 0)
+            return false;
+
+        av_packet_rescale_ts(m_packet, m_codec->time_base, m_stream->time_base);
+        m_packet->stream_index = m_stream->index;
+        err = av_interleaved_write_frame(m_format, m_packet);
+        av_packet_unref(m_packet);
+    }
+
+    return err >= 0;
+}
+
+bool VideoEncoder::close() {
+    if (!isOpen())
+        return false;
+
+    // Drain the frames the encoder is still holding
+    _send(NULL);
+    bool ok = av_write_trailer(m_format) >= 0;
+
+    _free();
+    return ok;
+}
+
+void VideoEncoder::_free() {
+    if (m_sws) {
+        sws_freeContext(m_sws);
+        m_sws = nullptr;
+    }
+
+    if (m_frame)
+        av_frame_free(&m_frame);
+
+    if (m_packet)
+        av_packet_free(&m_packet);
+
+    if (m_codec)
+        avcodec_free_context(&m_codec);
+
+    if (m_format) {
+        if ( !(m_format->oformat->flags & AVFMT_NOFILE) && m_format->pb)
+            avio_closep(&m_format->pb);
+        avformat_free_context(m_format);
+        m_format = nullptr;
+    }
+
+    m_stream = nullptr;
+}
+
+#endif
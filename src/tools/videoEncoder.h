@@ -0,0 +1,77 @@
+#pragma once
+
+#include "record.h"
+
+#if defined(SUPPORT_LIBAV) && !defined(PLATFORM_RPI)
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+/** Encodes RGB(A) frames straight into a video file through libavcodec/libavformat, without
+ *  piping them into a separate ffmpeg process. Frames come in at src_fps and are dropped or
+ *  repeated to match trg_fps, flipped vertically and converted to the target size and pixel
+ *  format with swscale. It's not thread safe, it's meant to be driven by one encoding thread **/
+class VideoEncoder {
+public:
+    VideoEncoder();
+    virtual ~VideoEncoder();
+
+    // Returns false if the container or the codec can't be open, so the caller can fall back to ffmpeg
+    bool    open(const RecordingSettings& _settings);
+    bool    isOpen() const { return m_format != nullptr; }
+
+    bool    encode(const unsigned char* _pixels);
+
+    // Flushes the delayed frames and writes the trailer
+    bool    close();
+
+    std::string getCodecName() const { return m_codecName; }
+
+    // Per frame time spent converting and encoding
+    size_t  getFrames() const { return m_frames; }
+    double  getAverageMs() const { return m_frames ? m_totalMs / m_frames : 0.0; }
+    double  getMaxMs() const { return m_maxMs; }
+
+private:
+    bool    _send(AVFrame* _frame);
+    void    _free();
+
+    RecordingSettings   m_settings;
+    std::string         m_codecName;
+
+    AVFormatContext*    m_format;
+    AVCodecContext*     m_codec;
+    AVStream*           m_stream;
+    AVFrame*            m_frame;
+    AVPacket*           m_packet;
+    SwsContext*         m_sws;
+
+    long long           m_pts;
+    size_t              m_srcFrames;
+
+    size_t              m_frames;
+    double              m_totalMs;
+    double              m_maxMs;
+};
+
+#elif defined(SUPPORT_RECORDING_PIPE)
+
+// Without libav there is nothing to encode with in-process, frames go through the ffmpeg pipe
+class VideoEncoder {
+public:
+    bool    open(const RecordingSettings& _settings) { return false; }
+    bool    isOpen() const { return false; }
+    bool    encode(const unsigned char* _pixels) { return false; }
+    bool    close() { return false; }
+
+    std::string getCodecName() const { return ""; }
+    size_t  getFrames() const { return 0; }
+    double  getAverageMs() const { return 0.0; }
+    double  getMaxMs() const { return 0.0; }
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "yuv420.h"
+
+#include "ada/geom/meshes.h"
+#include "ada/shaders/defaultShaders.h"
+
+namespace {
+
+// Each texel holds 4 consecutive bytes of the planes
+const std::string yuv420_frag = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+
+uniform sampler2D   u_tex0;
+uniform vec2        u_resolution;
+uniform vec2        u_krkb;
+uniform vec4        u_range;
+
+vec3 rgb(float x, float y) { return texture2D(u_tex0, vec2(x + 0.5, y + 0.5) / u_resolution).rgb; }
+vec3 block(float x, float y) { return (rgb(x, y) + rgb(x + 1.0, y) + rgb(x, y + 1.0) + rgb(x + 1.0, y + 1.0)) * 0.25; }
+
+float luma(vec3 c) { return dot(c, vec3(u_krkb.x, 1.0 - u_krkb.x - u_krkb.y, u_krkb.y)); }
+float Y(vec3 c) { return luma(c) * u_range.x + u_range.y; }
+
+float chroma(float x, float y, float plane) {
+    vec3 c = block(x * 2.0, y * 2.0);
+    float l = luma(c);
+    float cb = (c.b - l) / (2.0 * (1.0 - u_krkb.y));
+    float cr = (c.r - l) / (2.0 * (1.0 - u_krkb.x));
+    return mix(cb, cr, plane) * u_range.z + u_range.w;
+}
+
+void main() {
+    vec2 texel = floor(gl_FragCoord.xy);
+    float width = u_resolution.x;
+    float height = u_resolution.y;
+
+    if (texel.y < height) {
+        float x = texel.x * 4.0;
+        gl_FragColor = vec4(Y(rgb(x, texel.y)), Y(rgb(x + 1.0, texel.y)), Y(rgb(x + 2.0, texel.y)), Y(rgb(x + 3.0, texel.y)));
+    }
+    else {
+        // byte offset inside the chroma planes
+        float b = (texel.y - height) * width + texel.x * 4.0;
+        float plane = 0.0;
+        float planeSize = width * height * 0.25;
+        if (b >= planeSize) {
+            b -= planeSize;
+            plane = 1.0;
+        }
+        float w = width * 0.5;
+        float y = floor((b + 0.5) / w);
+        float x = b - y * w;
+        gl_FragColor = vec4(chroma(x, y, plane), chroma(x + 1.0, y, plane), chroma(x + 2.0, y, plane), chroma(x + 3.0, y, plane));
+    }
+}
+)";
+
+}
+
+Yuv420::Yuv420(): m_billboard(nullptr) {
+}
+
+Yuv420::~Yuv420() {
+    if (m_billboard)
+        delete m_billboard;
+}
+
+bool Yuv420::render(const ada::Fbo& _src, int _matrix, bool _fullRange) {
+    int width = _src.getWidth();
+    int height = _src.getHeight();
+
+    if (!m_shader.isLoaded())
+        m_shader.load(yuv420_frag, ada::getDefaultSrc(ada::VERT_BILLBOARD), false);
+
+    if (!m_billboard)
+        m_billboard = new ada::Vbo( ada::rectMesh(0.0,0.0,1.0,1.0) );
+
+    bool reallocated = false;
+    if (!m_fbo.isAllocated() || 
+        m_fbo.getWidth() != width / 4 || 
+        m_fbo.getHeight() != height * 3 / 2) {
+        m_fbo.allocate(width / 4, height * 3 / 2, ada::COLOR_TEXTURE);
+        reallocated = true;
+    }
+
+    // BT.601 or BT.709 luma coeficients
+    glm::vec2 krkb = (_matrix == 709) ? glm::vec2(0.2126f, 0.0722f) : glm::vec2(0.299f, 0.114f);
+
+    // the alpha channel carries data, it can't be blended
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_BLEND);
+
+    m_fbo.bind();
+    m_shader.use();
+    m_shader.setUniform("u_resolution", (float)width, (float)height);
+    m_shader.setUniform("u_krkb", krkb.x, krkb.y);
+    if (_fullRange)
+        m_shader.setUniform("u_range", 1.0f, 0.0f, 1.0f, 128.0f/255.0f);
+    else
+        m_shader.setUniform("u_range", 219.0f/255.0f, 16.0f/255.0f, 224.0f/255.0f, 128.0f/255.0f);
+    m_shader.setUniformTexture("u_tex0", &_src, 0);
+    m_billboard->render( &m_shader );
+
+    if (blend)
+        glEnable(GL_BLEND);
+
+    return reallocated;
+}
+
+void Yuv420::accountMemory(GpuAllocations& _list, const std::string& _owner) const {
+    addGpuAllocation(_list, _owner, m_fbo);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ada/gl/fbo.h"
+#include "ada/gl/vbo.h"
+#include "ada/gl/shader.h"
+
+#include "gpuMemory.h"
+
+/** Converts a framebuffer to planar YUV420 (I420) on the GPU, with the BT.601 or BT.709 matrix on
+ *  full (0-255) or limited (16-235 luma, 16-240 chroma) range. The planes are packed on an RGBA8
+ *  target of width/4 x height*3/2, so reading it back takes 1.5 bytes per pixel: first the Y plane,
+ *  followed by the U and V ones, with rows bottom up like any other glReadPixels. The width has to
+ *  be a multiple of 8 and the height a multiple of 2 **/
+class Yuv420 {
+public:
+    Yuv420();
+    virtual ~Yuv420();
+
+    // Leaves the target bound, ready to be read. True if it had to be (re)allocated
+    bool    render(const ada::Fbo& _src, int _matrix, bool _fullRange);
+    void    unbind() { m_fbo.unbind(); }
+
+    const ada::Fbo& getFbo() const { return m_fbo; }
+
+    void    accountMemory(GpuAllocations& _list, const std::string& _owner) const;
+
+protected:
+    ada::Fbo        m_fbo;
+    ada::Shader     m_shader;
+    ada::Vbo*       m_billboard;
+};
@@ -96,6 +96,8 @@ Uniforms::Uniforms(): cubemap(nullptr), m_streamsPrevs(0), m_streamsPrevsChange(
 
     cameras.push_back( ada::Camera() );
 
+    shaderStats.setCache(&programCache);
+
     functions["u_iblLuminance"] = UniformFunction("float", [this](ada::Shader& _shader) {
         _shader.setUniform("u_iblLuminance", 30000.0f * getCamera().getExposure());
     },
@@ -205,6 +207,7 @@ bool Uniforms::addTexture(const std::string& _name, const std::string& _path, Wa
         else {
 
             ada::Texture* tex = new ada::Texture();
+            TrackerScope track(&tracker, "load:" + _name);
             // load an image into the texture
             if (tex->load(_path, _flip)) {
                 
@@ -273,6 +276,7 @@ bool Uniforms::addBumpTexture(const std::string& _name, const std::string& _path
         // If we can lets proceed creating a texgure
         else {
             ada::TextureBump* tex = new ada::TextureBump();
+            TrackerScope track(&tracker, "load:" + _name);
 
             // load an image into the texture
             if (tex->load(_path, _flip)) {
@@ -692,11 +696,10 @@ void Uniforms::setCubeMap( const std::string& _filename, WatchFileList& _files,
     }
 }
 
-void Uniforms::checkPresenceIn( const std::string &_vert_src, const std::string &_frag_src ) {
+void Uniforms::checkPresenceIn( const ShaderMetadata &_vert, const ShaderMetadata &_frag ) {
     // Check active native uniforms
     for (UniformFunctionsList::iterator it = functions.begin(); it != functions.end(); ++it) {
-        std::string name = it->first + ";";
-        bool present = ( findId(_vert_src, name.c_str()) || findId(_frag_src, name.c_str()) );
+        bool present = ( _vert.isDeclared(it->first) || _frag.isDeclared(it->first) );
         if ( it->second.present != present) {
             it->second.present = present;
             m_change = true;
@@ -20,7 +20,9 @@
 
 #include "ada/gl/textureStreamAudio.h"
 #include "types/files.h"
+#include "tools/text.h"
 #include "tools/tracker.h"
+#include "tools/shaderStats.h"
 
 typedef std::array<float, 4> UniformValue;
 
@@ -109,7 +111,7 @@ public:
     void                    updateStreams(size_t _frame);
 
     // Check presence of uniforms on shaders
-    void                    checkPresenceIn( const std::string &_vert_src, const std::string &_frag_src );
+    void                    checkPresenceIn( const ShaderMetadata &_vert, const ShaderMetadata &_frag );
 
     // Feed uniforms to a specific shader
     bool                    feedTo( ada::Shader &_shader, bool _lights = true, bool _buffers = true);
@@ -156,6 +158,8 @@ public:
 
     // Tracker
     Tracker                     tracker;
+    ShaderStats                 shaderStats;
+    ProgramCache                programCache;
 
 protected:
     size_t                  m_streamsPrevs;
@@ -0,0 +1,198 @@
+// passSource() decides whether reloadShaders() can skip compiling a pass again: an edit that only
+// touches code another pass compiles leaves its source as it was. Leaving out a branch that the pass
+// does compile would keep a stale program without any error, so every case here checks both what is
+// left out and what has to stay. Lines of the sources are markers, looked up whole.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools/text.h"
+
+namespace {
+
+int failures = 0;
+
+bool hasLine(const std::string& _source, const std::string& _line) {
+    return ("\n" + _source).find("\n" + _line + "\n") != std::string::npos;
+}
+
+// _kept have to be on the source of the pass, _dropped must not
+void check( const std::string& _name, const std::string& _source, const std::string& _defines,
+            const std::vector<std::string>& _kept, const std::vector<std::string>& _dropped) {
+    std::string pass = passSource(_source, _defines);
+    bool ok = true;
+
+    for (size_t i = 0; i < _kept.size(); i++)
+        if (!hasLine(pass, _kept[i])) {
+            std::cerr << _name << " [" << _defines << "]: " << _kept[i] << " was left out" << std::endl;
+            ok = false;
+        }
+
+    for (size_t i = 0; i < _dropped.size(); i++)
+        if (hasLine(pass, _dropped[i])) {
+            std::cerr << _name << " [" << _defines << "]: " << _dropped[i] << " was kept" << std::endl;
+            ok = false;
+        }
+
+    if (!ok) {
+        std::cerr << "--- source of the pass:" << std::endl << pass << "---" << std::endl;
+        failures++;
+    }
+}
+
+// Sources it can't follow are compared whole
+void checkWhole(const std::string& _name, const std::string& _source, const std::string& _defines) {
+    if (passSource(_source, _defines) != _source) {
+        std::cerr << _name << " [" << _defines << "]: should be left as it is" << std::endl;
+        failures++;
+    }
+}
+
+}
+
+int main() {
+    const std::string ifdefElse =
+        "uniform float u_time;\n"
+        "#ifdef BUFFER_0\n"
+        "BUFFER_0_CODE\n"
+        "#else\n"
+        "MAIN_CODE\n"
+        "#endif\n"
+        "COMMON_CODE\n";
+    check("ifdef/else", ifdefElse, "BUFFER_0", {"BUFFER_0_CODE", "COMMON_CODE", "#ifdef BUFFER_0", "#else", "#endif"}, {"MAIN_CODE"});
+    check("ifdef/else", ifdefElse, "", {"MAIN_CODE", "COMMON_CODE"}, {"BUFFER_0_CODE"});
+    check("ifdef/else", ifdefElse, "BUFFER_1 DEBUG=1", {"MAIN_CODE", "COMMON_CODE"}, {"BUFFER_0_CODE"});
+
+    const std::string ifndef =
+        "#ifndef POSTPROCESSING\n"
+        "NOT_POSTPROCESSING\n"
+        "#endif\n";
+    check("ifndef", ifndef, "POSTPROCESSING", {}, {"NOT_POSTPROCESSING"});
+    check("ifndef", ifndef, "", {"NOT_POSTPROCESSING"}, {});
+
+    // A is not a pass define, the pass is only known when the one that is decides it
+    const std::string orMixed =
+        "#if defined(A) || defined(BUFFER_1)\n"
+        "A_OR_BUFFER_1\n"
+        "#else\n"
+        "NEITHER\n"
+        "#endif\n";
+    check("or", orMixed, "BUFFER_1", {"A_OR_BUFFER_1"}, {"NEITHER"});
+    check("or", orMixed, "BUFFER_0", {"A_OR_BUFFER_1", "NEITHER"}, {});
+    check("or", orMixed, "BUFFER_0 A", {"A_OR_BUFFER_1", "NEITHER"}, {});
+
+    const std::string andMixed =
+        "#if !defined(POSTPROCESSING) && defined(A)\n"
+        "NOT_POSTPROCESSING_AND_A\n"
+        "#endif\n";
+    check("and", andMixed, "POSTPROCESSING", {}, {"NOT_POSTPROCESSING_AND_A"});
+    check("and", andMixed, "", {"NOT_POSTPROCESSING_AND_A"}, {});
+
+    // defines that aren't of a pass can't be known from here, every branch stays
+    const std::string other =
+        "#ifdef DEBUG\n"
+        "DEBUG_CODE\n"
+        "#else\n"
+        "RELEASE_CODE\n"
+        "#endif\n"
+        "#if QUALITY > 1\n"
+        "HIGH_QUALITY\n"
+        "#elif defined(BUFFER_0)\n"
+        "BUFFER_0_LOW_QUALITY\n"
+        "#endif\n"
+        "#if defined(BUFFER_0) || QUALITY\n"
+        "BUFFER_0_OR_QUALITY\n"
+        "#endif\n";
+    check("other defines", other, "BUFFER_1 DEBUG=1", {"DEBUG_CODE", "RELEASE_CODE", "HIGH_QUALITY", "BUFFER_0_OR_QUALITY"}, {"BUFFER_0_LOW_QUALITY"});
+    check("other defines", other, "BUFFER_0 QUALITY=2", {"DEBUG_CODE", "RELEASE_CODE", "HIGH_QUALITY", "BUFFER_0_LOW_QUALITY", "BUFFER_0_OR_QUALITY"}, {});
+
+    // a pass define the source sets (or unsets) itself is not up to _defines anymore
+    const std::string redefined =
+        "#define BUFFER_0\n"
+        "#ifdef BUFFER_0\n"
+        "DEFINED_HERE\n"
+        "#else\n"
+        "NOT_DEFINED_HERE\n"
+        "#endif\n";
+    check("#define", redefined, "", {"DEFINED_HERE", "NOT_DEFINED_HERE"}, {});
+    check("#define", redefined, "BUFFER_1", {"DEFINED_HERE", "NOT_DEFINED_HERE"}, {});
+
+    const std::string undefined =
+        "#ifdef POSTPROCESSING\n"
+        "#undef POSTPROCESSING\n"
+        "#endif\n"
+        "#if defined(POSTPROCESSING)\n"
+        "STILL_POSTPROCESSING\n"
+        "#endif\n";
+    check("#undef", undefined, "POSTPROCESSING", {"#undef POSTPROCESSING", "STILL_POSTPROCESSING"}, {});
+
+    // the first branch known to be true closes the chain, one that can't be known doesn't
+    const std::string elif =
+        "#if defined(BUFFER_0)\n"
+        "CHAIN_BUFFER_0\n"
+        "#elif defined(BUFFER_1)\n"
+        "CHAIN_BUFFER_1\n"
+        "#elif defined( DOUBLE_BUFFER_0 ) // with a comment\n"
+        "CHAIN_DOUBLE_BUFFER_0\n"
+        "#elif defined(DEBUG)\n"
+        "CHAIN_DEBUG\n"
+        "#else\n"
+        "CHAIN_MAIN\n"
+        "#endif\n";
+    check("elif", elif, "BUFFER_0", {"CHAIN_BUFFER_0"}, {"CHAIN_BUFFER_1", "CHAIN_DOUBLE_BUFFER_0", "CHAIN_DEBUG", "CHAIN_MAIN"});
+    check("elif", elif, "BUFFER_1", {"CHAIN_BUFFER_1"}, {"CHAIN_BUFFER_0", "CHAIN_DOUBLE_BUFFER_0", "CHAIN_DEBUG", "CHAIN_MAIN"});
+    check("elif", elif, "DOUBLE_BUFFER_0", {"CHAIN_DOUBLE_BUFFER_0"}, {"CHAIN_BUFFER_0", "CHAIN_BUFFER_1", "CHAIN_DEBUG", "CHAIN_MAIN"});
+    check("elif", elif, "", {"CHAIN_DEBUG", "CHAIN_MAIN"}, {"CHAIN_BUFFER_0", "CHAIN_BUFFER_1", "CHAIN_DOUBLE_BUFFER_0"});
+
+    const std::string nested =
+        "#ifdef BUFFER_0\n"
+        "#ifdef DEBUG\n"
+        "BUFFER_0_DEBUG\n"
+        "#elif defined(BUFFER_1)\n"
+        "BUFFER_0_AND_1\n"
+        "#endif\n"
+        "#else\n"
+        "#ifdef DEBUG\n"
+        "MAIN_DEBUG\n"
+        "#endif\n"
+        "#endif\n";
+    check("nested", nested, "BUFFER_0", {"BUFFER_0_DEBUG"}, {"BUFFER_0_AND_1", "MAIN_DEBUG"});
+    check("nested", nested, "", {"MAIN_DEBUG"}, {"BUFFER_0_DEBUG", "BUFFER_0_AND_1"});
+
+    // directives commented out are just text
+    const std::string commented =
+        "/*\n"
+        "#ifdef BUFFER_0\n"
+        "*/\n"
+        "AFTER_COMMENTED_IFDEF\n"
+        "/* #endif\n"
+        "#endif */\n"
+        "#ifdef BUFFER_0 /* a real one */\n"
+        "REAL_BUFFER_0\n"
+        "#endif\n"
+        "// #ifdef BUFFER_1\n"
+        "AFTER_LINE_COMMENT\n";
+    check("comments", commented, "", {"AFTER_COMMENTED_IFDEF", "AFTER_LINE_COMMENT"}, {"REAL_BUFFER_0"});
+    check("comments", commented, "BUFFER_0", {"AFTER_COMMENTED_IFDEF", "REAL_BUFFER_0", "AFTER_LINE_COMMENT"}, {});
+
+    checkWhole("missing #endif", "#ifdef BUFFER_0\nX\n", "");
+    checkWhole("stray #endif", "X\n#endif\n#ifdef BUFFER_0\nY\n#endif\n", "");
+    checkWhole("stray #else", "#else\nX\n", "BUFFER_0");
+    checkWhole("stray #elif", "X\n#elif defined(BUFFER_0)\nY\n", "BUFFER_0");
+
+    // what reloadShaders() counts on: editing the code of another pass leaves this one as it was
+    const std::string before = "#ifdef BUFFER_0\nfloat a = 1.0;\n#else\nfloat b = 1.0;\n#endif\n";
+    const std::string after  = "#ifdef BUFFER_0\nfloat a = 2.0;\n#else\nfloat b = 1.0;\n#endif\n";
+    if (passSource(before, "") != passSource(after, "")) {
+        std::cerr << "an edit on BUFFER_0 changed the main pass" << std::endl;
+        failures++;
+    }
+    if (passSource(before, "BUFFER_0") == passSource(after, "BUFFER_0")) {
+        std::cerr << "an edit on BUFFER_0 didn't change the BUFFER_0 pass" << std::endl;
+        failures++;
+    }
+
+    std::cout << "passSource," << (failures == 0 ? "ok" : "FAIL") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// Stress test of RingBuffer: one producer and one consumer as fast as they can go, checking
+// that every item arrives once and in order, on rings of different capacity and with both the
+// non blocking and the sleeping produce()/consume().
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "tools/ringBuffer.h"
+
+namespace {
+
+bool run(size_t _capacity, size_t _items, bool _sleep) {
+    RingBuffer<uint64_t> ring(_capacity);
+    std::atomic<bool> failed(false);
+    size_t received = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < _items && !failed.load(std::memory_order_relaxed); i++) {
+            uint64_t value = i;
+            if (_sleep)
+                while (!ring.produce(value, 100) && !failed.load(std::memory_order_relaxed)) { }
+            else
+                while (!ring.produce(value) && !failed.load(std::memory_order_relaxed))
+                    std::this_thread::yield();
+        }
+    });
+
+    uint64_t expected = 0;
+    while (expected < _items) {
+        uint64_t value = 0;
+        bool got = _sleep ? ring.consume(value, 100) : ring.consume(value);
+        if (!got) {
+            // on a single core spinning only takes the time of the producer
+            if (!_sleep)
+                std::this_thread::yield();
+            continue;
+        }
+
+        if (value != expected) {
+            std::cerr << "capacity " << _capacity << ": got " << value << " instead of " << expected << std::endl;
+            failed = true;
+            break;
+        }
+        expected++;
+        received++;
+    }
+    producer.join();
+
+    if (!failed && (received != _items || !ring.empty())) {
+        std::cerr << "capacity " << _capacity << ": " << received << " of " << _items << " items, " << ring.size() << " left on the ring" << std::endl;
+        failed = true;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "capacity," << _capacity << "," << (_sleep ? "sleeping" : "spinning") << "," << _items << " items," << ms << "ms," << (failed ? "FAIL" : "ok") << std::endl;
+    return !failed;
+}
+
+// What the recording pipe moves through it: owning pointers that can't be copied
+bool runMoveOnly(size_t _capacity, size_t _items) {
+    RingBuffer< std::unique_ptr<uint64_t> > ring(_capacity);
+    bool ok = true;
+
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < _items; i++) {
+            std::unique_ptr<uint64_t> value(new uint64_t(i));
+            while (!ring.produce(value, 100)) { }
+        }
+    });
+
+    for (uint64_t expected = 0; expected < _items; ) {
+        std::unique_ptr<uint64_t> value;
+        if (!ring.consume(value, 100))
+            continue;
+
+        if (!value || *value != expected) {
+            std::cerr << "move only: wrong item at " << expected << std::endl;
+            ok = false;
+        }
+        expected++;
+    }
+    producer.join();
+
+    std::cout << "capacity," << _capacity << ",move only," << _items << " items," << (ok ? "ok" : "FAIL") << std::endl;
+    return ok;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t items = (argc > 1) ? (size_t)atol(argv[1]) : 1000000;
+
+    bool ok = true;
+    const size_t capacities[] = { 1, 2, 3, 7, 128, 1024 };
+    for (size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); i++) {
+        ok = run(capacities[i], items, false) && ok;
+        ok = run(capacities[i], items / 4, true) && ok;
+    }
+    ok = runMoveOnly(3, items / 4) && ok;
+    ok = runMoveOnly(128, items / 4) && ok;
+
+    return ok ? 0 : 1;
+}
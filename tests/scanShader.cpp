@@ -0,0 +1,394 @@
+// Compares scanShader() with the regular expressions it replaced on every shader it's given (the
+// examples/ folder from ctest), and times both. The regex code is kept here as it was.
+//
+//  test_scanShader [--bench <runs>] <files...>
+//
+// Known and wanted differences, not reported:
+//  - the regex side found "u_name;" anywhere, also commented out. Here it looks at the source without comments
+//  - the regex getBufferSize() said yes when any buffer had a size, even another one, without giving a size.
+//    Here a size only counts when it was given
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "ada/string.h"
+
+#include "tools/text.h"
+
+namespace regex {
+
+namespace {
+
+template<typename T1> // Helper operator shorthand: [enum_t] -> [size_t].
+constexpr size_t operator+(T1 some_enum) {
+    return static_cast<size_t>(some_enum);
+}
+
+template<typename T1>
+std::string create_regex_term(T1 regex_piece, const std::string& keyword) {
+    std::ostringstream os;
+    for(size_t i = 0; i < regex_piece.size()-1; ++i) {
+        os << std::begin(regex_piece)[i] << keyword;
+    }
+    os << std::begin(regex_piece)[regex_piece.size()-1];
+    return os.str();
+};
+
+template<typename T1, typename T2>
+std::regex make_regex(T1 regex_pattern_check, T2 listings_keyword) {
+    return std::regex{create_regex_term(regex_pattern_check, std::get<1>(listings_keyword))};
+};
+
+std::tuple<bool, std::smatch> does_any_of_the_regex_exist(const std::string& _source, std::regex re) {
+    // Split Source code in lines
+    const auto lines = ada::split(_source, '\n');
+    std::smatch match;
+    const auto match_found = std::any_of(std::begin(lines), std::end(lines)
+                                         , [&](const std::string& line) { return std::regex_search(line, match, re); });
+    return { match_found, match };
+}
+
+using regex_stringdata_t = const char * const;
+
+template<typename T1>
+using regex_string_t = std::tuple<T1, regex_stringdata_t>;
+
+enum class regex_check_t {
+    Convolution_Pyramid,
+    Floor,
+    Background,
+    Post_Processing,
+    MAX_KEYWORDS_CHECK_IDS
+};
+using regex_check_string_t = regex_string_t<regex_check_t>;
+const auto valid_check_keyword_ids = std::array<regex_check_string_t, +(regex_check_t::MAX_KEYWORDS_CHECK_IDS)> {{
+    {regex_check_t::Convolution_Pyramid, "CONVOLUTION_PYRAMID_ALGORITHM"}
+    , {regex_check_t::Floor,"FLOOR"}
+    , {regex_check_t::Background, "BACKGROUND"}
+    , {regex_check_t::Post_Processing, "POSTPROCESSING"}
+}};
+
+bool generic_search_check(const std::string& _source, regex_check_t keyword_id ) {
+    const auto regex_pattern_check = {
+        R"((?:^\s*#if|^\s*#elif)(?:\s+)(defined\s*\(\s*)"
+        , R"()(?:\s*\))|(?:^\s*#ifdef\s+)"
+        , R"()|(?:^\s*#ifndef\s+)"
+        , R"())"
+    };
+    const auto re = make_regex(regex_pattern_check, valid_check_keyword_ids[+(keyword_id)]);
+    return std::get<0>(does_any_of_the_regex_exist(_source, re));   //return only the "result" boolean.
+}
+
+enum class regex_count_t {
+    Buffers,
+    Double_Buffers,
+    Convolution_Pyramid,
+    MAX_KEYWORDS_COUNT_IDS
+};
+using regex_count_string_t = regex_string_t<regex_count_t>;
+const auto valid_count_keyword_ids = std::array<regex_count_string_t, +(regex_count_t::MAX_KEYWORDS_COUNT_IDS)> {{
+    {regex_count_t::Buffers, "BUFFER"}
+    , {regex_count_t::Double_Buffers, "DOUBLE_BUFFER"}
+    , {regex_count_t::Convolution_Pyramid, "CONVOLUTION_PYRAMID"}
+}};
+
+struct is_not_duplicate_number_predicate {
+    // Group results in a vector to check for duplicates
+    std::vector<std::string> results = {};
+    bool operator()(const std::string &line, const std::regex &re) {
+        std::smatch match;
+        // if there are matches
+        if (std::regex_search(line, match, re)) {
+            // Depending the case can be in the 2nd or 3rd group
+            const auto case_group = [&](size_t index){return std::ssub_match(match[index]).str();};
+            const auto number = (case_group(2).size() == 0)
+                    ? case_group(3)
+                    : case_group(2);
+            // Check if it's already defined
+            // If it's not add it
+            if (!std::any_of(std::begin(results), std::end(results)
+                             , [&](const std::string& index){ return index == number; })) {
+                results.push_back(number);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+int generic_search_count(const std::string& _source, regex_count_t keyword_id ) {
+    const auto regex_pattern_count  = {
+        R"((?:^\s*#if|^\s*#elif)(?:\s+)(defined\s*\(\s*)"
+        , R"(_)(\d+)(?:\s*\))|(?:^\s*#ifdef\s+)"
+        , R"(_)(\d+))"
+    };
+    // Split Source code in lines
+    const auto lines = ada::split(_source, '\n');
+    // Regext to search for #ifdef BUFFER_[NUMBER], #if defined( BUFFER_[NUMBER] ) and #elif defined( BUFFER_[NUMBER] ) occurences
+    const auto re = make_regex(regex_pattern_count, valid_count_keyword_ids[+(keyword_id)]);
+    // return the number of results
+    auto predicate_op = is_not_duplicate_number_predicate{};
+    return std::count_if(std::begin(lines), std::end(lines), [&](const std::string& line) {
+        return std::ref(predicate_op)(line, re);
+    });
+}
+
+enum class regex_get_t {
+    BufferSize,
+    MAX_KEYWORDS_GET_IDS
+};
+
+using regex_get_string_t = regex_string_t<regex_get_t>;
+const auto valid_get_keyword_ids = std::array<regex_get_string_t, +(regex_get_t::MAX_KEYWORDS_GET_IDS)> {{
+    {regex_get_t::BufferSize, R"(uniform\s*sampler2D\s*(\w*)\;\s*\/\/*\s(\d+)x(\d+))"}
+}};
+
+bool generic_search_get(const std::string& _source, const std::string& _name, glm::vec2& _size, regex_get_t keyword_id ) {
+    bool result;
+    std::smatch match;
+    const auto re = std::regex{std::get<1>(valid_get_keyword_ids[+(keyword_id)])};
+    std::tie(result, match) = does_any_of_the_regex_exist(_source, re); // capture both the "result" and the "match" info.
+    if(result) {
+        if (match[1] == _name) {    // regex-match result data is valid to spec.
+            _size = {ada::toFloat(match[2]), ada::toFloat(match[3])};
+        }
+    }
+    return result;
+}
+}  // Namespace {}
+
+// Quickly determine if a shader program contains the specified identifier.
+bool findId(const std::string& program, const char* id) {
+    return std::strstr(program.c_str(), id) != 0;
+}
+
+// Count how many BUFFERS are in the shader
+int countBuffers(const std::string& _source) {
+    return generic_search_count(_source, regex_count_t::Buffers);
+}
+
+bool getBufferSize(const std::string& _source, const std::string& _name, glm::vec2& _size) {
+    return generic_search_get(_source, _name, _size, regex_get_t::BufferSize);
+}
+
+// Count how many BUFFERS are in the shader
+int countDoubleBuffers(const std::string& _source) {
+    return generic_search_count(_source, regex_count_t::Double_Buffers);
+}
+
+// Count how many BUFFERS are in the shader
+bool checkBackground(const std::string& _source) {
+    return generic_search_check(_source, regex_check_t::Background);
+}
+
+// Count how many BUFFERS are in the shader
+bool checkFloor(const std::string& _source) {
+    return generic_search_check(_source, regex_check_t::Floor);
+}
+
+bool checkPostprocessing(const std::string& _source) {
+    return generic_search_check(_source, regex_check_t::Post_Processing);
+}
+
+// Count how many CONVOLUTION_PYRAMID_ are in the shader
+int countConvolutionPyramid(const std::string& _source) {
+    return generic_search_count(_source, regex_count_t::Convolution_Pyramid);
+}
+
+bool checkConvolutionPyramid(const std::string& _source) {
+    return generic_search_check(_source, regex_check_t::Convolution_Pyramid);
+}
+
+}
+
+namespace {
+
+// the uniforms glslViewer looks for in the shaders to know if it has to feed them
+const char* natives[] = {
+    "u_time", "u_delta", "u_date", "u_resolution", "u_mouse", "u_frame", "u_fps", "u_pixel",
+    "u_tex0", "u_tex0Resolution", "u_scene", "u_sceneDepth", "u_sceneNormal", "u_scenePosition", "u_sceneBuffer",
+    "u_buffer0", "u_doubleBuffer0", "u_convolutionPyramid0", "u_cubeMap", "u_SH", "u_iblLuminance",
+    "u_camera", "u_cameraPosition", "u_cameraNearClip", "u_cameraFarClip", "u_cameraDistance", "u_cameraExposure",
+    "u_cameraEv100", "u_cameraAperture", "u_cameraShutterSpeed", "u_cameraSensitivity",
+    "u_model", "u_modelMatrix", "u_viewMatrix", "u_projectionMatrix", "u_normalMatrix",
+    "u_light", "u_lightColor", "u_lightMatrix", "u_lightShadowMap", "u_lightIntensity", "u_lightDirection", "u_lightFalloff"
+};
+const size_t nativesTotal = sizeof(natives) / sizeof(natives[0]);
+
+const char* sizedBuffers[] = { "u_buffer0", "u_buffer1", "u_doubleBuffer0", "u_doubleBuffer1" };
+const size_t sizedBuffersTotal = sizeof(sizedBuffers) / sizeof(sizedBuffers[0]);
+
+std::string stripComments(const std::string& _source) {
+    std::string rta;
+    size_t pos = 0;
+    while (pos < _source.size()) {
+        if (_source.compare(pos, 2, "//") == 0) {
+            pos = _source.find('\n', pos);
+            if (pos == std::string::npos)
+                break;
+        }
+        else if (_source.compare(pos, 2, "/*") == 0) {
+            size_t end = _source.find("*/", pos + 2);
+            pos = (end == std::string::npos) ? _source.size() : end + 2;
+            rta += ' ';
+        }
+        else
+            rta += _source[pos++];
+    }
+    return rta;
+}
+
+struct Answers {
+    int     buffers, doubleBuffers, convolutionPyramids;
+    bool    convolutionPyramid, postprocessing, background, floor;
+    bool    sized[sizedBuffersTotal];
+    glm::vec2 sizes[sizedBuffersTotal];
+    bool    declared[nativesTotal];
+};
+
+Answers askRegex(const std::string& _source, const std::string& _uncommented) {
+    Answers a;
+    a.buffers = regex::countBuffers(_source);
+    a.doubleBuffers = regex::countDoubleBuffers(_source);
+    a.convolutionPyramids = regex::countConvolutionPyramid(_source);
+    a.convolutionPyramid = regex::checkConvolutionPyramid(_source);
+    a.postprocessing = regex::checkPostprocessing(_source);
+    a.background = regex::checkBackground(_source);
+    a.floor = regex::checkFloor(_source);
+    for (size_t i = 0; i < sizedBuffersTotal; i++) {
+        a.sizes[i] = glm::vec2(-1.0f);
+        a.sized[i] = regex::getBufferSize(_source, sizedBuffers[i], a.sizes[i]) && a.sizes[i].x >= 0.0f;
+    }
+    for (size_t i = 0; i < nativesTotal; i++)
+        a.declared[i] = regex::findId(_uncommented, (std::string(natives[i]) + ";").c_str());
+    return a;
+}
+
+Answers askScan(const std::string& _source) {
+    ShaderMetadata m = scanShader(_source);
+    Answers a;
+    a.buffers = m.buffers;
+    a.doubleBuffers = m.doubleBuffers;
+    a.convolutionPyramids = m.convolutionPyramids;
+    a.convolutionPyramid = m.convolutionPyramid;
+    a.postprocessing = m.postprocessing;
+    a.background = m.background;
+    a.floor = m.floor;
+    for (size_t i = 0; i < sizedBuffersTotal; i++) {
+        a.sizes[i] = glm::vec2(-1.0f);
+        a.sized[i] = m.getBufferSize(sizedBuffers[i], a.sizes[i]);
+    }
+    for (size_t i = 0; i < nativesTotal; i++)
+        a.declared[i] = m.isDeclared(natives[i]);
+    return a;
+}
+
+std::string compare(const Answers& _regex, const Answers& _scan) {
+    std::ostringstream d;
+    if (_regex.buffers != _scan.buffers)
+        d << " buffers " << _regex.buffers << "/" << _scan.buffers;
+    if (_regex.doubleBuffers != _scan.doubleBuffers)
+        d << " doubleBuffers " << _regex.doubleBuffers << "/" << _scan.doubleBuffers;
+    if (_regex.convolutionPyramids != _scan.convolutionPyramids)
+        d << " convolutionPyramids " << _regex.convolutionPyramids << "/" << _scan.convolutionPyramids;
+    if (_regex.convolutionPyramid != _scan.convolutionPyramid)
+        d << " CONVOLUTION_PYRAMID_ALGORITHM " << _regex.convolutionPyramid << "/" << _scan.convolutionPyramid;
+    if (_regex.postprocessing != _scan.postprocessing)
+        d << " POSTPROCESSING " << _regex.postprocessing << "/" << _scan.postprocessing;
+    if (_regex.background != _scan.background)
+        d << " BACKGROUND " << _regex.background << "/" << _scan.background;
+    if (_regex.floor != _scan.floor)
+        d << " FLOOR " << _regex.floor << "/" << _scan.floor;
+    for (size_t i = 0; i < sizedBuffersTotal; i++)
+        if (_regex.sized[i] != _scan.sized[i] || (_regex.sized[i] && (_regex.sizes[i].x != _scan.sizes[i].x || _regex.sizes[i].y != _scan.sizes[i].y)))
+            d << " " << sizedBuffers[i] << " " << _regex.sizes[i].x << "x" << _regex.sizes[i].y << "/" << _scan.sizes[i].x << "x" << _scan.sizes[i].y;
+    for (size_t i = 0; i < nativesTotal; i++)
+        if (_regex.declared[i] != _scan.declared[i])
+            d << " " << natives[i] << " " << _regex.declared[i] << "/" << _scan.declared[i];
+    return d.str();
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point _start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+    int runs = 0;
+    std::vector<std::string> sources;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+            continue;
+        }
+
+        std::ifstream in(argv[i]);
+        if (!in) {
+            std::cerr << "Can't read " << argv[i] << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        sources.push_back(buffer.str());
+        names.push_back(argv[i]);
+    }
+
+    if (sources.empty()) {
+        std::cerr << "Use: test_scanShader [--bench <runs>] <files...>" << std::endl;
+        return 1;
+    }
+
+    if (runs > 0) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < sources.size(); i++)
+            bytes += sources[i].size();
+
+        // what a reload used to ask, against what it asks now
+        int sink = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int r = 0; r < runs; r++)
+            for (size_t i = 0; i < sources.size(); i++)
+                sink += askRegex(sources[i], sources[i]).buffers;
+        double regexMs = elapsedMs(start) / runs;
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < runs; r++)
+            for (size_t i = 0; i < sources.size(); i++)
+                sink += askScan(sources[i]).buffers;
+        double scanMs = elapsedMs(start) / runs;
+
+        std::cout << "files," << sources.size() << "\nbytes," << bytes << "\nruns," << runs << std::endl;
+        std::cout << "regexMs," << regexMs << "\nscanMs," << scanMs << "\nspeedup," << (regexMs / scanMs) << std::endl;
+        if (sink < 0)
+            std::cout << sink << std::endl;
+
+        // a big margin, only a scanner slower than the regular expressions fails
+        return scanMs < regexMs ? 0 : 1;
+    }
+
+    int different = 0;
+    for (size_t i = 0; i < sources.size(); i++) {
+        std::string d = compare(askRegex(sources[i], stripComments(sources[i])), askScan(sources[i]));
+        if (!d.empty()) {
+            std::cout << names[i] << ":" << d << std::endl;
+            different++;
+        }
+    }
+    std::cout << sources.size() << " files, " << different << " with differences (regex/scan)" << std::endl;
+    return different == 0 ? 0 : 1;
+}
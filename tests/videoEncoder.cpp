@@ -0,0 +1,181 @@
+// Encodes a few synthetic frames with the in-process encoder (tools/videoEncoder) using software
+// codecs every libavcodec build has, mpeg4 and the lossless ffv1, then decodes the files back and
+// checks the amount of frames, their size, their order and that they still look like what went in
+// (rows come in bottom up like glReadPixels gives them, so they also have to come out flipped).
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools/videoEncoder.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+const int WIDTH = 64;
+const int HEIGHT = 48;
+const int FRAMES = 12;
+
+// bottom up RGBA, each frame with its own red so their order can be told apart, and a top half
+// brighter than the bottom one so a missing flip shows
+std::vector<unsigned char> frame(int _index) {
+    std::vector<unsigned char> rgba(WIDTH * HEIGHT * 4);
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) {
+            unsigned char* p = &rgba[(y * WIDTH + x) * 4];
+            p[0] = (unsigned char)(20 + _index * 18);
+            p[1] = (unsigned char)(x * 255 / (WIDTH - 1));
+            p[2] = (unsigned char)(y < HEIGHT / 2 ? 40 : 220);
+            p[3] = 255;
+        }
+    return rgba;
+}
+
+bool encode(const std::string& _path, const std::string& _codec) {
+    RecordingSettings settings;
+    settings.src_width = settings.trg_width = WIDTH;
+    settings.src_height = settings.trg_height = HEIGHT;
+    settings.src_channels = 4;
+    settings.src_fps = settings.trg_fps = 24.0f;
+    settings.trg_path = _path;
+    settings.trg_codec = _codec;
+    settings.trg_pix_fmt = "yuv420p";
+
+    VideoEncoder encoder;
+    if (!encoder.open(settings)) {
+        std::cerr << _path << ": can't open the encoder" << std::endl;
+        return false;
+    }
+
+    if (encoder.getCodecName() != _codec) {
+        std::cerr << _path << ": encoded with " << encoder.getCodecName() << " instead of " << _codec << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < FRAMES; i++) {
+        std::vector<unsigned char> pixels = frame(i);
+        if (!encoder.encode(&pixels[0])) {
+            std::cerr << _path << ": frame " << i << " didn't encode" << std::endl;
+            return false;
+        }
+    }
+
+    return encoder.close();
+}
+
+// mean absolute difference per channel between a decoded (top down) frame and the bottom up one that went in
+double difference(const unsigned char* _decoded, int _stride, const std::vector<unsigned char>& _original) {
+    double total = 0.0;
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            for (int c = 0; c < 3; c++)
+                total += abs((int)_decoded[y * _stride + x * 4 + c] - (int)_original[((HEIGHT - 1 - y) * WIDTH + x) * 4 + c]);
+    return total / (WIDTH * HEIGHT * 3);
+}
+
+bool decode(const std::string& _path, double _tolerance) {
+    AVFormatContext* format = NULL;
+    if (avformat_open_input(&format, _path.c_str(), NULL, NULL) < 0) {
+        std::cerr << _path << ": can't be open" << std::endl;
+        return false;
+    }
+    avformat_find_stream_info(format, NULL);
+
+    int stream = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    const AVCodec* codec = (stream >= 0) ? avcodec_find_decoder(format->streams[stream]->codecpar->codec_id) : NULL;
+    AVCodecContext* context = codec ? avcodec_alloc_context3(codec) : NULL;
+    if (!context ||
+        avcodec_parameters_to_context(context, format->streams[stream]->codecpar) < 0 ||
+        avcodec_open2(context, codec, NULL) < 0) {
+        std::cerr << _path << ": no video stream that can be decoded" << std::endl;
+        avcodec_free_context(&context);
+        avformat_close_input(&format);
+        return false;
+    }
+
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* decoded = av_frame_alloc();
+    std::vector<unsigned char> rgba(WIDTH * HEIGHT * 4);
+    SwsContext* sws = NULL;
+    int frames = 0;
+    double worst = 0.0;
+    bool ok = true;
+
+    // a NULL packet at the end drains the frames the decoder is holding
+    bool draining = false;
+    while (ok && !draining) {
+        if (av_read_frame(format, packet) < 0)
+            draining = true;
+        else if (packet->stream_index != stream) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        int err = avcodec_send_packet(context, draining ? NULL : packet);
+        av_packet_unref(packet);
+        if (err < 0 && err != AVERROR_EOF)
+            break;
+
+        while (ok && avcodec_receive_frame(context, decoded) >= 0) {
+            if (decoded->width != WIDTH || decoded->height != HEIGHT) {
+                std::cerr << _path << ": frame of " << decoded->width << "x" << decoded->height << std::endl;
+                ok = false;
+                break;
+            }
+
+            sws = sws_getCachedContext(sws, WIDTH, HEIGHT, (AVPixelFormat)decoded->format, WIDTH, HEIGHT, AV_PIX_FMT_RGBA, SWS_POINT, NULL, NULL, NULL);
+            uint8_t* dst[1] = { &rgba[0] };
+            int dstStride[1] = { WIDTH * 4 };
+            sws_scale(sws, decoded->data, decoded->linesize, 0, HEIGHT, dst, dstStride);
+
+            double d = (frames < FRAMES) ? difference(&rgba[0], WIDTH * 4, frame(frames)) : 255.0;
+            if (d > worst)
+                worst = d;
+            if (d > _tolerance) {
+                std::cerr << _path << ": frame " << frames << " is " << d << " levels away from the original" << std::endl;
+                ok = false;
+            }
+            frames++;
+        }
+    }
+
+    if (ok && frames != FRAMES) {
+        std::cerr << _path << ": " << frames << " frames decoded instead of " << FRAMES << std::endl;
+        ok = false;
+    }
+
+    std::cout << _path << "," << frames << " frames,max difference " << worst << "," << (ok ? "ok" : "FAIL") << std::endl;
+
+    sws_freeContext(sws);
+    av_frame_free(&decoded);
+    av_packet_free(&packet);
+    avcodec_free_context(&context);
+    avformat_close_input(&format);
+    return ok;
+}
+
+}
+
+int main() {
+    // both are built in unless libavcodec was configured without them
+    if (!avcodec_find_encoder_by_name("mpeg4") || !avcodec_find_encoder_by_name("ffv1")) {
+        std::cout << "no mpeg4 or ffv1 encoder, skipping" << std::endl;
+        return 77;
+    }
+
+    bool ok = true;
+
+    // lossy: close enough. ffv1 keeps the yuv420p it's given, only the chroma subsampling and rounding are lost
+    ok = (encode("test_videoEncoder.avi", "mpeg4") && decode("test_videoEncoder.avi", 12.0)) && ok;
+    ok = (encode("test_videoEncoder.mkv", "ffv1") && decode("test_videoEncoder.mkv", 3.0)) && ok;
+
+    return ok ? 0 : 1;
+}
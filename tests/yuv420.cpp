@@ -0,0 +1,158 @@
+// Checks the YUV420 conversion of the recording pipe (tools/yuv420) against a CPU conversion written
+// from the BT.601 / BT.709 definitions, on full and limited range, within +-1 of each 8 bit value.
+// Needs an OpenGL context (headless when the platform can), skips (77) without one.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ada/window.h"
+#include "ada/gl/gl.h"
+#include "ada/gl/fbo.h"
+
+#include "tools/yuv420.h"
+
+namespace {
+
+const int WIDTH = 64;
+const int HEIGHT = 32;
+
+unsigned char toByte(double _value) {
+    long v = lround(_value);
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// I420 of _rgba with the rows in the same order they come, chroma of each 2x2 block from its average color
+std::vector<unsigned char> reference(const std::vector<unsigned char>& _rgba, int _matrix, bool _fullRange) {
+    const double kr = (_matrix == 709) ? 0.2126 : 0.299;
+    const double kb = (_matrix == 709) ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+
+    // Y' = 16 + 219 E'y, Cb/Cr = 128 + 224 E'cb/cr on limited range, the whole 0-255 on full range
+    const double yScale = _fullRange ? 255.0 : 219.0;
+    const double yOffset = _fullRange ? 0.0 : 16.0;
+    const double cScale = _fullRange ? 255.0 : 224.0;
+
+    std::vector<unsigned char> yuv(WIDTH * HEIGHT * 3 / 2);
+    unsigned char* u = &yuv[WIDTH * HEIGHT];
+    unsigned char* v = u + WIDTH * HEIGHT / 4;
+
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) {
+            const unsigned char* p = &_rgba[(y * WIDTH + x) * 4];
+            double ey = (kr * p[0] + kg * p[1] + kb * p[2]) / 255.0;
+            yuv[y * WIDTH + x] = toByte(yOffset + yScale * ey);
+        }
+
+    for (int y = 0; y < HEIGHT / 2; y++)
+        for (int x = 0; x < WIDTH / 2; x++) {
+            double r = 0.0, g = 0.0, b = 0.0;
+            for (int i = 0; i < 4; i++) {
+                const unsigned char* p = &_rgba[((y * 2 + i / 2) * WIDTH + x * 2 + i % 2) * 4];
+                r += p[0] / (255.0 * 4.0);
+                g += p[1] / (255.0 * 4.0);
+                b += p[2] / (255.0 * 4.0);
+            }
+            double ey = kr * r + kg * g + kb * b;
+            u[y * WIDTH / 2 + x] = toByte(128.0 + cScale * (b - ey) / (2.0 * (1.0 - kb)));
+            v[y * WIDTH / 2 + x] = toByte(128.0 + cScale * (r - ey) / (2.0 * (1.0 - kr)));
+        }
+
+    return yuv;
+}
+
+// gradients on the left half, primaries and grays on the right, and some noise at the bottom
+std::vector<unsigned char> pattern() {
+    const unsigned char colors[8][3] = { {255,0,0}, {0,255,0}, {0,0,255}, {255,255,255}, {0,0,0}, {128,128,128}, {255,255,0}, {0,255,255} };
+
+    std::vector<unsigned char> rgba(WIDTH * HEIGHT * 4);
+    srand(1);
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++) {
+            unsigned char* p = &rgba[(y * WIDTH + x) * 4];
+            if (y < HEIGHT / 4)
+                for (int c = 0; c < 3; c++)
+                    p[c] = (unsigned char)(rand() % 256);
+            else if (x < WIDTH / 2) {
+                p[0] = (unsigned char)(x * 255 / (WIDTH / 2 - 1));
+                p[1] = (unsigned char)(y * 255 / (HEIGHT - 1));
+                p[2] = (unsigned char)(255 - p[0]);
+            }
+            else {
+                const unsigned char* c = colors[((x - WIDTH / 2) / 4 + (y / 4)) % 8];
+                p[0] = c[0];
+                p[1] = c[1];
+                p[2] = c[2];
+            }
+            p[3] = 255;
+        }
+    return rgba;
+}
+
+bool check(Yuv420& _yuv, const ada::Fbo& _src, const std::vector<unsigned char>& _rgba, int _matrix, bool _fullRange) {
+    _yuv.render(_src, _matrix, _fullRange);
+    std::vector<unsigned char> gpu(WIDTH * HEIGHT * 3 / 2);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, WIDTH / 4, HEIGHT * 3 / 2, GL_RGBA, GL_UNSIGNED_BYTE, &gpu[0]);
+    _yuv.unbind();
+
+    std::vector<unsigned char> cpu = reference(_rgba, _matrix, _fullRange);
+
+    const char* planes[] = { "Y", "U", "V" };
+    int worst = 0;
+    size_t wrong = 0;
+    for (size_t i = 0; i < cpu.size(); i++) {
+        int d = abs((int)gpu[i] - (int)cpu[i]);
+        if (d > worst)
+            worst = d;
+        if (d > 1) {
+            if (wrong < 8) {
+                size_t plane = (i < (size_t)WIDTH * HEIGHT) ? 0 : (i < (size_t)WIDTH * HEIGHT * 5 / 4 ? 1 : 2);
+                std::cerr << "BT." << _matrix << (_fullRange ? " full" : " limited") << ": " << planes[plane] << " byte " << i << " is " << (int)gpu[i] << " instead of " << (int)cpu[i] << std::endl;
+            }
+            wrong++;
+        }
+    }
+
+    std::cout << "BT." << _matrix << "," << (_fullRange ? "full" : "limited") << ",max difference " << worst << "," << (wrong ? "FAIL" : "ok") << std::endl;
+    return wrong == 0;
+}
+
+}
+
+int main() {
+    ada::WindowProperties properties;
+    properties.style = ada::HEADLESS;
+    properties.screen_width = WIDTH;
+    properties.screen_height = HEIGHT;
+    ada::initGL(properties);
+    if (!ada::isGL()) {
+        std::cout << "No OpenGL context, skipping" << std::endl;
+        return 77;
+    }
+
+    // the source goes straight into the texture of the framebuffer the recording would convert
+    std::vector<unsigned char> rgba = pattern();
+    ada::Fbo src;
+    src.allocate(WIDTH, HEIGHT, ada::COLOR_TEXTURE);
+    glBindTexture(GL_TEXTURE_2D, src.getTextureId());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    bool ok = true;
+    {
+        Yuv420 yuv;
+        const int matrices[] = { 601, 709 };
+        for (int m = 0; m < 2; m++) {
+            ok = check(yuv, src, rgba, matrices[m], true) && ok;
+            ok = check(yuv, src, rgba, matrices[m], false) && ok;
+        }
+    }
+
+    ada::closeGL();
+    return ok ? 0 : 1;
+}